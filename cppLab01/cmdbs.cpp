@@ -8,11 +8,32 @@
 #include <functional>
 #include <limits>
 #include <cctype>
+#include <chrono>
+#include <iomanip>
+#include <fstream>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <stdexcept>
+#include <cstring>
+#include <cstdio>
+#include <cstdint>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <deque>
+#include <set>
+#include <string_view>
+#include <random>
+#include <filesystem>
 #ifdef _WIN32
 #ifndef NOMINMAX
 #define NOMINMAX
 #endif
 #include <windows.h>
+#else
+#include <unistd.h>
 #endif
 
 using namespace std;
@@ -21,7 +42,10 @@ using namespace std;
 enum FieldType {
     FIELD_INT,
     FIELD_STRING,
-    FIELD_DOUBLE
+    FIELD_DOUBLE,
+    FIELD_INT64,      // 64 位整数
+    FIELD_TIMESTAMP,  // 时间戳：自 1970-01-01 00:00:00 UTC 起的秒数
+    FIELD_BOOL
 };
 
 // 运算符枚举
@@ -35,12 +59,199 @@ enum Operator {
     CONTAINS        // 字符串包含 (仅用于STRING类型)
 };
 
+// 访问路径枚举（explain/profile 输出使用）
+enum AccessPath {
+    ACCESS_FULL_SCAN,   // 全表扫描
+    ACCESS_INDEX,       // 索引查找
+    ACCESS_ZONE_MAP,    // 按块最值裁剪后扫描
+    ACCESS_SHARD_POINT, // 按分片键只访问一个分片
+    ACCESS_SKETCH       // 直接读取增量维护的列摘要，不访问记录
+};
+
 // 字段定义结构
 struct Field {
     string name;
     FieldType type;
+    bool nullable;  // 是否允许取 NULL
     
-    Field(string n = "", FieldType t = FIELD_STRING) : name(n), type(t) {}
+    Field(string n = "", FieldType t = FIELD_STRING, bool canBeNull = false)
+        : name(n), type(t), nullable(canBeNull) {}
+};
+
+// ==================== 时间戳辅助函数 ====================
+// 公历日期与自 1970-01-01 起天数的互相换算（proleptic Gregorian，UTC）
+inline long long daysFromCivil(long long y, unsigned m, unsigned d) {
+    y -= m <= 2;
+    const long long era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = static_cast<unsigned>(y - era * 400);
+    const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<long long>(doe) - 719468;
+}
+
+// 当月天数，闰年：能被 4 整除且不能被 100 整除，或能被 400 整除
+inline unsigned daysInMonth(long long y, unsigned m) {
+    static const unsigned days[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    bool leap = (y % 4 == 0 && y % 100 != 0) || y % 400 == 0;
+    return m == 2 && leap ? 29 : days[m - 1];
+}
+
+inline void civilFromDays(long long z, long long& y, unsigned& m, unsigned& d) {
+    z += 719468;
+    const long long era = (z >= 0 ? z : z - 146096) / 146097;
+    const unsigned doe = static_cast<unsigned>(z - era * 146097);
+    const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const unsigned mp = (5 * doy + 2) / 153;
+    d = doy - (153 * mp + 2) / 5 + 1;
+    m = mp < 10 ? mp + 3 : mp - 9;
+    y = static_cast<long long>(yoe) + era * 400 + (m <= 2);
+}
+
+// 将秒数格式化为 "YYYY-MM-DD HH:MM:SS"
+inline string formatTimestamp(long long seconds) {
+    long long days = seconds / 86400;
+    long long rest = seconds % 86400;
+    if (rest < 0) {
+        rest += 86400;
+        days--;
+    }
+    long long y;
+    unsigned m, d;
+    civilFromDays(days, y, m, d);
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), "%04lld-%02u-%02u %02lld:%02lld:%02lld",
+             y, m, d, rest / 3600, (rest / 60) % 60, rest % 60);
+    return buffer;
+}
+
+// ==================== 字符串驻留 ====================
+
+// 进程内的字符串池：相同内容只保存一份，每个字符串分配一个稳定的 id，所有数据库共用
+// 池只增不减；驻留需要加锁，读取已驻留的内容不需要加锁（内容存放在 deque 中，地址不会变化）
+class StringPool {
+private:
+    mutable mutex poolMutex;
+    deque<string> texts;                            // texts[i] 的 id 为 i + 1，id 0 保留给空串
+    unordered_map<string_view, uint32_t> idByText;  // 键指向 texts 中的内容
+    long long textBytes;
+
+    static const size_t ENTRY_OVERHEAD = sizeof(string) + sizeof(void*) * 2 + 8;
+
+    StringPool() : textBytes(0) {}
+
+public:
+    static StringPool& instance() {
+        static StringPool pool;
+        return pool;
+    }
+
+    static const string& emptyString() {
+        static const string empty;
+        return empty;
+    }
+
+    // 返回 text 的驻留副本及其 id
+    const string* intern(const string& text, uint32_t& id) {
+        if (text.empty()) {
+            id = 0;
+            return &emptyString();
+        }
+        lock_guard<mutex> lock(poolMutex);
+        auto it = idByText.find(string_view(text));
+        if (it != idByText.end()) {
+            id = it->second;
+            return &texts[it->second - 1];
+        }
+        texts.push_back(text);
+        id = static_cast<uint32_t>(texts.size());
+        idByText.emplace(string_view(texts.back()), id);
+        textBytes += static_cast<long long>(text.size());
+        return &texts.back();
+    }
+
+    // 查找已驻留的字符串，不存在时返回 0（不会加入池中）
+    uint32_t find(const string& text) const {
+        if (text.empty()) {
+            return 0;
+        }
+        lock_guard<mutex> lock(poolMutex);
+        auto it = idByText.find(string_view(text));
+        return it == idByText.end() ? 0 : it->second;
+    }
+
+    size_t size() const {
+        lock_guard<mutex> lock(poolMutex);
+        return texts.size();
+    }
+
+    // 单个字符串在池中的大致占用：内容加上 deque 中的 string 对象与哈希索引节点
+    static long long entryBytes(const string& text) {
+        return static_cast<long long>(text.size() + ENTRY_OVERHEAD);
+    }
+
+    // 池中字符串内容与索引的大致占用
+    long long memoryBytes() const {
+        lock_guard<mutex> lock(poolMutex);
+        return textBytes + static_cast<long long>(texts.size() * ENTRY_OVERHEAD);
+    }
+};
+
+// 驻留字符串：只保存指向池中内容的指针和 id
+// 相等比较只比较 id（整数比较，不访问字符串内容），大小比较按内容的字典序
+// 分页存储读出的字符串不进入池（池只增不减，扫描大表会让它无限增长），由值自己持有内容，
+// 这类值的 id 为 UNPOOLED，与其他值比较时退化为按内容比较
+class InternedString {
+private:
+    const string* text;
+    uint32_t id;
+    shared_ptr<const string> owned;  // 仅不驻留的值使用
+
+public:
+    static const uint32_t UNPOOLED = 0xFFFFFFFFu;
+
+    InternedString() : text(&StringPool::emptyString()), id(0) {}
+
+    explicit InternedString(const string& value) {
+        text = StringPool::instance().intern(value, id);
+    }
+
+    // 不加入字符串池、也不加锁的字符串值
+    static InternedString unpooled(string value) {
+        InternedString result;
+        if (!value.empty()) {
+            result.owned = make_shared<const string>(std::move(value));
+            result.text = result.owned.get();
+            result.id = UNPOOLED;
+        }
+        return result;
+    }
+
+    const string& str() const {
+        return *text;
+    }
+
+    bool isPooled() const {
+        return id != UNPOOLED;
+    }
+
+    // 池中的 id；不驻留的值在池中查找相同内容，池中没有时返回 0
+    uint32_t poolId() const {
+        return isPooled() ? id : StringPool::instance().find(*text);
+    }
+
+    int compare(const InternedString& other) const {
+        return id == other.id && isPooled() ? 0 : text->compare(*other.text);
+    }
+
+    bool operator==(const InternedString& other) const {
+        return isPooled() && other.isPooled() ? id == other.id : *text == *other.text;
+    }
+    bool operator!=(const InternedString& other) const { return !(*this == other); }
+    bool operator<(const InternedString& other) const { return compare(other) < 0; }
+    bool operator>(const InternedString& other) const { return compare(other) > 0; }
+    bool operator<=(const InternedString& other) const { return compare(other) <= 0; }
+    bool operator>=(const InternedString& other) const { return compare(other) >= 0; }
 };
 
 // 记录值
@@ -49,27 +260,86 @@ struct Value {
     union {
         int intVal;
         double doubleVal;
+        long long int64Val;  // FIELD_INT64 与 FIELD_TIMESTAMP 共用
+        bool boolVal;
     };
-    string strVal;
+    InternedString strVal;  // 字符串值驻留在进程级字符串池中（分页存储读出的值除外）
+    bool isNull;  // 为 true 时忽略上面的取值
     
-    Value() : type(FIELD_STRING), intVal(0) {}
+    Value() : type(FIELD_STRING), int64Val(0), isNull(false) {}
     
     string toString() const {
+        if (isNull) {
+            return "NULL";
+        }
         switch(type) {
             case FIELD_INT: return to_string(intVal);
             case FIELD_DOUBLE: return to_string(doubleVal);
-            case FIELD_STRING: return strVal;
+            case FIELD_STRING: return strVal.str();
+            case FIELD_INT64: return to_string(int64Val);
+            case FIELD_TIMESTAMP: return formatTimestamp(int64Val);
+            case FIELD_BOOL: return boolVal ? "true" : "false";
             default: return "";
         }
     }
 };
 
 // 记录节点（链表节点）
+typedef unsigned long long RowId;  // 行号：数据库内唯一，按插入顺序递增
+
 struct RecordNode {
     map<string, Value> data;  // 字段名 -> 值
     RecordNode* next;
+    RecordNode* prev;
+    RowId rowId;
     
-    RecordNode() : next(nullptr) {}
+    RecordNode() : next(nullptr), prev(nullptr), rowId(0) {}
+};
+
+// 单次查询的执行统计（profile 前缀时填充）
+struct QueryProfile {
+    AccessPath accessPath;
+    long long rowsScanned;
+    long long rowsMatched;
+    long long blocksTotal;
+    long long blocksSkipped;
+    long long bytesTouched;
+    vector<pair<string, double>> operatorMillis;  // 算子名 -> 耗时(毫秒)
+
+    QueryProfile()
+        : accessPath(ACCESS_FULL_SCAN), rowsScanned(0), rowsMatched(0),
+          blocksTotal(0), blocksSkipped(0), bytesTouched(0) {}
+};
+
+// 每个数据库的累计统计（show stats 输出）
+struct DatabaseStats {
+    long long adds;
+    long long locates;
+    long long deletes;
+    long long updates;
+    long long rowsScanned;
+    long long rowsMatched;
+    long long blocksSkipped;
+    long long bytesTouched;
+    long long expiredRows;  // TTL 到期删除的行数
+    double totalMillis;
+
+    DatabaseStats()
+        : adds(0), locates(0), deletes(0), updates(0), rowsScanned(0),
+          rowsMatched(0), blocksSkipped(0), bytesTouched(0), expiredRows(0), totalMillis(0.0) {}
+};
+
+// 简单计时器：构造时开始计时，elapsedMillis 返回经过的毫秒数
+class ScopedTimer {
+private:
+    chrono::steady_clock::time_point start;
+
+public:
+    ScopedTimer() : start(chrono::steady_clock::now()) {}
+
+    double elapsedMillis() const {
+        return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    }
 };
 
 // ==================== 工具类 ====================
@@ -95,348 +365,5407 @@ public:
     static Value makeStringValue(const string& val) {
         Value v;
         v.type = FIELD_STRING;
-        v.strVal = val;
+        v.strVal = InternedString(val);
         return v;
     }
 
-    // 通用判断函数：判断记录是否满足条件
-    // recordNode: 要判断的记录节点
-    // key: 字段名
-    // op: 运算符
-    // value: 用于比较的值
-    static bool evaluateCondition(const RecordNode* recordNode, const string& key, Operator op, const Value& value) {
-        // 检查记录是否包含该键
-        auto it = recordNode->data.find(key);
-        if (it == recordNode->data.end()) {
-            return false;  // 键不存在,返回false
+    // 创建不进入字符串池的 STRING 值（分页存储反序列化使用）
+    static Value makeUnpooledStringValue(string val) {
+        Value v;
+        v.type = FIELD_STRING;
+        v.strVal = InternedString::unpooled(std::move(val));
+        return v;
+    }
+
+    // 辅助函数：创建INT64类型的Value
+    static Value makeInt64Value(long long val) {
+        Value v;
+        v.type = FIELD_INT64;
+        v.int64Val = val;
+        return v;
+    }
+
+    // 辅助函数：创建TIMESTAMP类型的Value（自 1970-01-01 00:00:00 UTC 起的秒数）
+    static Value makeTimestampValue(long long seconds) {
+        Value v;
+        v.type = FIELD_TIMESTAMP;
+        v.int64Val = seconds;
+        return v;
+    }
+
+    // 辅助函数：创建BOOL类型的Value
+    static Value makeBoolValue(bool val) {
+        Value v;
+        v.type = FIELD_BOOL;
+        v.boolVal = val;
+        return v;
+    }
+
+    // 辅助函数：创建指定类型的NULL值
+    static Value makeNullValue(FieldType type) {
+        Value v;
+        v.type = type;
+        v.isNull = true;
+        return v;
+    }
+
+    static const char* fieldTypeName(FieldType type) {
+        switch (type) {
+            case FIELD_INT: return "INT";
+            case FIELD_DOUBLE: return "DOUBLE";
+            case FIELD_STRING: return "STRING";
+            case FIELD_INT64: return "INT64";
+            case FIELD_TIMESTAMP: return "TIMESTAMP";
+            case FIELD_BOOL: return "BOOL";
+            default: return "UNKNOWN";
         }
-        
-        const Value& recordValue = it->second;
-        
+    }
+
+    // 非字符串值转换为 double（聚合求和使用）
+    static double numericValue(const Value& v) {
+        switch (v.type) {
+            case FIELD_INT: return v.intVal;
+            case FIELD_INT64:
+            case FIELD_TIMESTAMP: return static_cast<double>(v.int64Val);
+            case FIELD_BOOL: return v.boolVal ? 1.0 : 0.0;
+            case FIELD_DOUBLE: return v.doubleVal;
+            default: return 0.0;
+        }
+    }
+
+    // 哈希表占用的字节数估算：每个元素一个链表节点，外加桶数组
+    template <typename HashMap>
+    static long long hashMapBytes(const HashMap& m) {
+        return static_cast<long long>(m.size() * (sizeof(typename HashMap::value_type) + 2 * sizeof(void*))
+                                      + m.bucket_count() * sizeof(void*));
+    }
+
+    // 字符串在堆上占用的字节数（短字符串存放在对象内部，不额外占用）
+    static long long stringHeapBytes(const string& text) {
+        return text.capacity() > string().capacity() ? static_cast<long long>(text.capacity()) + 1 : 0;
+    }
+
+    // 估算一条记录占用的字节数（节点 + 每个字段的键与值；字符串内容在字符串池中共享，不计入单条记录）
+    static long long estimateRecordBytes(const map<string, Value>& data) {
+        long long bytes = sizeof(RecordNode);
+        for (const auto& entry : data) {
+            // 红黑树节点大约额外携带 3 个指针与 1 个颜色位
+            bytes += sizeof(entry) + 4 * sizeof(void*);
+            bytes += stringHeapBytes(entry.first);
+        }
+        return bytes;
+    }
+
+    // 记录中的字符串在字符串池中的占用上限（不考虑已经驻留、可以共享的情况），写入前的内存限制检查使用
+    static long long pooledStringBytes(const map<string, Value>& data) {
+        long long bytes = 0;
+        for (const auto& entry : data) {
+            const Value& v = entry.second;
+            if (v.type == FIELD_STRING && !v.isNull && !v.strVal.str().empty()) {
+                bytes += StringPool::entryBytes(v.strVal.str());
+            }
+        }
+        return bytes;
+    }
+
+    static const char* accessPathName(AccessPath path) {
+        switch (path) {
+            case ACCESS_FULL_SCAN: return "全表扫描";
+            case ACCESS_INDEX: return "索引查找";
+            case ACCESS_ZONE_MAP: return "块裁剪扫描";
+            case ACCESS_SHARD_POINT: return "单分片定位";
+            case ACCESS_SKETCH: return "列摘要";
+            default: return "未知";
+        }
+    }
+
+    static const char* operatorSymbol(Operator op) {
+        switch (op) {
+            case EQUAL: return "==";
+            case NOT_EQUAL: return "!=";
+            case GREATER: return ">";
+            case LESS: return "<";
+            case GREATER_EQUAL: return ">=";
+            case LESS_EQUAL: return "<=";
+            case CONTAINS: return "contains";
+            default: return "?";
+        }
+    }
+
+    // 按运算符比较两个有序值，整型、时间戳、布尔与字符串各自实例化一份
+    template <typename T>
+    static bool compareOrdered(const T& lhs, Operator op, const T& rhs) {
+        switch (op) {
+            case EQUAL: return lhs == rhs;
+            case NOT_EQUAL: return lhs != rhs;
+            case GREATER: return lhs > rhs;
+            case LESS: return lhs < rhs;
+            case GREATER_EQUAL: return lhs >= rhs;
+            case LESS_EQUAL: return lhs <= rhs;
+            default: return false;
+        }
+    }
+
+    // 浮点数相等判断带 1e-9 的容差
+    static bool compareDouble(double lhs, Operator op, double rhs) {
+        switch (op) {
+            case EQUAL: return fabs(lhs - rhs) < 1e-9;
+            case NOT_EQUAL: return fabs(lhs - rhs) >= 1e-9;
+            default: return compareOrdered(lhs, op, rhs);
+        }
+    }
+
+    // 比较单个字段值
+    // NULL 语义：只有 "== null" 与 "!= null" 能判断 NULL，NULL 与普通值的任何比较均为 false
+    static bool evaluateValue(const Value& recordValue, Operator op, const Value& value) {
+        if (value.isNull) {
+            if (op == EQUAL) return recordValue.isNull;
+            if (op == NOT_EQUAL) return !recordValue.isNull;
+            return false;
+        }
+        if (recordValue.isNull) {
+            return false;
+        }
+
         // 类型必须匹配(除了CONTAINS运算符只能用于STRING)
         if (recordValue.type != value.type) {
             return false;
         }
-        
-        // 根据类型和运算符进行比较
+
+        // 根据类型选择对应的比较函数
         switch (recordValue.type) {
             case FIELD_INT:
-                switch (op) {
-                    case EQUAL: return recordValue.intVal == value.intVal;
-                    case NOT_EQUAL: return recordValue.intVal != value.intVal;
-                    case GREATER: return recordValue.intVal > value.intVal;
-                    case LESS: return recordValue.intVal < value.intVal;
-                    case GREATER_EQUAL: return recordValue.intVal >= value.intVal;
-                    case LESS_EQUAL: return recordValue.intVal <= value.intVal;
-                    default: return false;
-                }
-                
+                return compareOrdered(recordValue.intVal, op, value.intVal);
+            case FIELD_INT64:
+            case FIELD_TIMESTAMP:
+                return compareOrdered(recordValue.int64Val, op, value.int64Val);
+            case FIELD_BOOL:
+                return compareOrdered(recordValue.boolVal, op, value.boolVal);
             case FIELD_DOUBLE:
-                switch (op) {
-                    case EQUAL: return fabs(recordValue.doubleVal - value.doubleVal) < 1e-9;
-                    case NOT_EQUAL: return fabs(recordValue.doubleVal - value.doubleVal) >= 1e-9;
-                    case GREATER: return recordValue.doubleVal > value.doubleVal;
-                    case LESS: return recordValue.doubleVal < value.doubleVal;
-                    case GREATER_EQUAL: return recordValue.doubleVal >= value.doubleVal;
-                    case LESS_EQUAL: return recordValue.doubleVal <= value.doubleVal;
-                    default: return false;
-                }
-                
+                return compareDouble(recordValue.doubleVal, op, value.doubleVal);
             case FIELD_STRING:
-                switch (op) {
-                    case EQUAL: return recordValue.strVal == value.strVal;
-                    case NOT_EQUAL: return recordValue.strVal != value.strVal;
-                    case GREATER: return recordValue.strVal > value.strVal;
-                    case LESS: return recordValue.strVal < value.strVal;
-                    case GREATER_EQUAL: return recordValue.strVal >= value.strVal;
-                    case LESS_EQUAL: return recordValue.strVal <= value.strVal;
-                    case CONTAINS: return recordValue.strVal.find(value.strVal) != string::npos;
-                    default: return false;
+                if (op == CONTAINS) {
+                    return recordValue.strVal.str().find(value.strVal.str()) != string::npos;
                 }
-                
+                return compareOrdered(recordValue.strVal, op, value.strVal);
             default:
                 return false;
         }
     }
 
-    // 重载版本：直接接受RecordNode的data成员
+    // 三路比较两个同类型的非 NULL 值，返回负数/0/正数（块最值维护使用）
+    static int compareValues(const Value& a, const Value& b) {
+        switch (a.type) {
+            case FIELD_INT: return (a.intVal > b.intVal) - (a.intVal < b.intVal);
+            case FIELD_INT64:
+            case FIELD_TIMESTAMP: return (a.int64Val > b.int64Val) - (a.int64Val < b.int64Val);
+            case FIELD_BOOL: return static_cast<int>(a.boolVal) - static_cast<int>(b.boolVal);
+            case FIELD_DOUBLE: return (a.doubleVal > b.doubleVal) - (a.doubleVal < b.doubleVal);
+            case FIELD_STRING: return a.strVal.compare(b.strVal);  // 同一驻留 id 直接返回 0
+            default: return 0;
+        }
+    }
+
+    // 通用判断函数：判断记录是否满足条件
+    // data: 要判断的记录
+    // key: 字段名
+    // op: 运算符
+    // value: 用于比较的值
     static bool evaluateCondition(const map<string, Value>& data, const string& key, Operator op, const Value& value) {
-        RecordNode temp;
-        temp.data = data;
-        return evaluateCondition(&temp, key, op, value);
+        // 检查记录是否包含该键
+        auto it = data.find(key);
+        if (it == data.end()) {
+            return false;  // 键不存在,返回false
+        }
+        return evaluateValue(it->second, op, value);
+    }
+
+    // 重载版本：直接接受记录节点
+    static bool evaluateCondition(const RecordNode* recordNode, const string& key, Operator op, const Value& value) {
+        return evaluateCondition(recordNode->data, key, op, value);
     }
 };
 
-//数据库
+// 按 compareValues 排序的比较器，用于以同类型的 Value 作为有序容器的键
+struct ValueLess {
+    bool operator()(const Value& a, const Value& b) const {
+        return DatabaseUtils::compareValues(a, b) < 0;
+    }
+};
 
-class Database {
-private:
-    string name;
-    vector<Field> fields;  // 表结构，初始化后不可更改
-    RecordNode* RecordHead;
-    int recordCount;
-    
-    // 验证记录是否符合表结构
-    bool validateRecord(const map<string, Value>& record) const {
-        // 检查记录字段数量是否匹配
-        if (record.size() != fields.size()) {
-            cout << "错误：记录字段数量不匹配。期望 " << fields.size() 
-                 << " 个字段，实际 " << record.size() << " 个字段" << endl;
-            return false;
-        }
-        
-        // 检查每个必需字段是否存在且类型正确
-        for (const auto& field : fields) {
-            auto it = record.find(field.name);
-            
-            // 检查字段是否存在
-            if (it == record.end()) {
-                cout << "错误：缺少必需字段 \"" << field.name << "\"" << endl;
-                return false;
-            }
-            
-            // 检查字段类型是否匹配
-            if (it->second.type != field.type) {
-                cout << "错误：字段 \"" << field.name << "\" 类型不匹配。期望 ";
-                switch (field.type) {
-                    case FIELD_INT: cout << "INT"; break;
-                    case FIELD_DOUBLE: cout << "DOUBLE"; break;
-                    case FIELD_STRING: cout << "STRING"; break;
-                }
-                cout << "，实际 ";
-                switch (it->second.type) {
-                    case FIELD_INT: cout << "INT"; break;
-                    case FIELD_DOUBLE: cout << "DOUBLE"; break;
-                    case FIELD_STRING: cout << "STRING"; break;
-                }
-                cout << endl;
-                return false;
-            }
+// ==================== 存储层 ====================
+
+// 单个查询条件：字段 运算符 值（存储层可据此按块裁剪）
+struct Condition {
+    string fieldName;
+    Operator op;
+    Value value;
+};
+
+// 存储模式
+enum StorageMode {
+    STORAGE_MEMORY,  // 全部记录保存在内存链表中
+    STORAGE_PAGED,   // 记录按页保存在文件中，通过固定大小的缓冲池访问
+    STORAGE_SHARDED  // 按键哈希分片，每个分片由一个工作线程独占
+};
+
+// 创建数据库时的存储选项
+struct StorageOptions {
+    StorageMode mode;
+    size_t bufferPoolPages;  // 仅 STORAGE_PAGED 使用：缓冲池可容纳的页数
+    string shardKey;         // 仅 STORAGE_SHARDED 使用：分片键字段
+    size_t shardCount;       // 仅 STORAGE_SHARDED 使用：分片（工作线程）数
+
+    StorageOptions(StorageMode m = STORAGE_MEMORY, size_t pages = 256)
+        : mode(m), bufferPoolPages(pages), shardCount(4) {}
+};
+
+// 聚合函数
+enum AggregateFunction {
+    AGG_COUNT,
+    AGG_SUM,
+    AGG_MIN,
+    AGG_MAX,
+    AGG_AVG
+};
+
+// 聚合的中间状态：可以分别累加后再合并（分片并行聚合使用）
+struct AggregateState {
+    long long count;  // 参与聚合的非 NULL 值个数；count(*) 时为行数
+    double sum;
+    Value minVal;
+    Value maxVal;
+
+    AggregateState() : count(0), sum(0.0) {}
+
+    void add(const Value& v) {
+        if (v.isNull) {
+            return;
         }
-        
-        // 检查是否有未定义的字段
-        for (const auto& item : record) {
-            bool found = false;
-            for (const auto& field : fields) {
-                if (field.name == item.first) {
-                    found = true;
-                    break;
-                }
-            }
-            if (!found) {
-                cout << "错误：字段 \"" << item.first << "\" 未在表结构中定义" << endl;
-                return false;
-            }
+        if (count == 0 || DatabaseUtils::compareValues(v, minVal) < 0) minVal = v;
+        if (count == 0 || DatabaseUtils::compareValues(v, maxVal) > 0) maxVal = v;
+        if (v.type != FIELD_STRING) {
+            sum += DatabaseUtils::numericValue(v);
         }
-        
-        return true;
+        count++;
     }
-    
-public:
-    // 构造函数：必须提供数据库名称和表结构定义
-    Database(const string& name, const vector<Field>& schema) 
-        : name(name), fields(schema), RecordHead(nullptr), recordCount(0) {
-        if (fields.empty()) {
-            throw invalid_argument("错误：表结构不能为空");
+
+    // fieldName 为空表示 count(*)
+    void addRecord(const map<string, Value>& data, const string& fieldName) {
+        if (fieldName.empty()) {
+            count++;
+            return;
         }
-        cout << "数据库 \"" << name << "\" 创建成功，包含 " << fields.size() << " 个字段：";
-        for (size_t i = 0; i < fields.size(); i++) {
-            cout << fields[i].name;
-            if (i < fields.size() - 1) cout << ", ";
+        auto it = data.find(fieldName);
+        if (it != data.end()) {
+            add(it->second);
         }
-        cout << endl;
     }
-    
-    ~Database() {
-        RecordNode* current = RecordHead;
-        while (current != nullptr) {
-            RecordNode* toDelete = current;
-            current = current->next;
-            delete toDelete;
+
+    void merge(const AggregateState& other) {
+        if (other.count == 0) {
+            return;
         }
+        if (count == 0 || DatabaseUtils::compareValues(other.minVal, minVal) < 0) minVal = other.minVal;
+        if (count == 0 || DatabaseUtils::compareValues(other.maxVal, maxVal) > 0) maxVal = other.maxVal;
+        sum += other.sum;
+        count += other.count;
     }
-    
-    Database(const Database&) = delete;
-    Database& operator=(const Database&) = delete;
-    
-    // 显示表结构
-    void displaySchema() const {
-        cout << "========== 数据库表结构: " << name << " ==========" << endl;
-        for (const auto& field : fields) {
-            cout << "  字段名: " << field.name << " | 类型: ";
-            switch (field.type) {
-                case FIELD_INT: cout << "INT"; break;
-                case FIELD_DOUBLE: cout << "DOUBLE"; break;
-                case FIELD_STRING: cout << "STRING"; break;
-            }
-            cout << endl;
+
+    // 按聚合函数取结果，没有参与聚合的值时返回 NULL
+    Value result(AggregateFunction func) const {
+        switch (func) {
+            case AGG_COUNT: return DatabaseUtils::makeInt64Value(count);
+            case AGG_SUM: return count == 0 ? DatabaseUtils::makeNullValue(FIELD_DOUBLE)
+                                            : DatabaseUtils::makeDoubleValue(sum);
+            case AGG_AVG: return count == 0 ? DatabaseUtils::makeNullValue(FIELD_DOUBLE)
+                                            : DatabaseUtils::makeDoubleValue(sum / count);
+            case AGG_MIN: return count == 0 ? DatabaseUtils::makeNullValue(FIELD_INT) : minVal;
+            case AGG_MAX: return count == 0 ? DatabaseUtils::makeNullValue(FIELD_INT) : maxVal;
         }
-        cout << "============================================" << endl;
+        return DatabaseUtils::makeNullValue(FIELD_INT);
     }
+};
 
-    void add_element_to_database(const map<string, Value>& record){
-        if (record.empty()) {
-            cout << "错误：不能添加空记录" << endl;
-            return;
-        }
-        
-        if (!validateRecord(record)) {
-            cout << "错误：记录验证失败" << endl;
-            return;
-        }
-        
-        RecordNode* newNode = new RecordNode();
-        newNode->data = record;
-        newNode->next = RecordHead;
-        RecordHead = newNode;
 
-        recordCount++;
-        cout << "记录添加成功，目前共 " << recordCount << " 条记录" << endl;
-    }
+typedef function<void(RowId, const map<string, Value>&)> RecordVisitor;
 
-    // 删除满足条件的记录
-    // predicate: 判断函数,接受一个记录的引用,返回true表示需要删除该记录
-    void remove_elements_in_database(const function<bool(const map<string, Value>&)>& predicate){
-        RecordNode* current = RecordHead;
-        RecordNode* prev = nullptr;
-        int removedCount = 0;
+// 记录谓词：保存具体的内核类型（谓词内核或任意可调用对象），扫描循环在 Model<Kernel> 中按内核类型实例化。
+// 存储层每次扫描只经过一次虚调用，循环内对每行直接调用内核，编译器可以把比较内联进循环
+class RecordPredicate {
+private:
+    struct Concept {
+        virtual ~Concept() {}
+        virtual bool test(const map<string, Value>& data) const = 0;
+        // 沿 next 从 head 遍历链表，满足条件的节点追加到 out，返回扫描的行数
+        virtual long long filterList(RecordNode* head, vector<RecordNode*>& out) const = 0;
+        // 就地只保留满足条件的节点，保持原有顺序
+        virtual void filterNodes(vector<RecordNode*>& nodes) const = 0;
+    };
 
-        while (current != nullptr) {
-            if (predicate(current->data)) {
-                // 需要删除当前节点
-                RecordNode* toDelete = current;  
-                if (prev == nullptr) {
-                    // 删除头节点
-                    RecordHead = current->next;
-                    current = RecordHead;
-                } else {
-                    // 删除中间或尾节点
-                    prev->next = current->next;
-                    current = current->next;
+    template <typename Kernel>
+    struct Model : Concept {
+        Kernel kernel;
+
+        explicit Model(Kernel k) : kernel(std::move(k)) {}
+
+        bool test(const map<string, Value>& data) const override {
+            return kernel(data);
+        }
+
+        long long filterList(RecordNode* head, vector<RecordNode*>& out) const override {
+            long long scanned = 0;
+            for (RecordNode* current = head; current != nullptr; current = current->next) {
+                scanned++;
+                if (kernel(current->data)) {
+                    out.push_back(current);
+                }
+            }
+            return scanned;
+        }
+
+        void filterNodes(vector<RecordNode*>& nodes) const override {
+            size_t kept = 0;
+            for (RecordNode* node : nodes) {
+                if (kernel(node->data)) {
+                    nodes[kept++] = node;
                 }
-                delete toDelete;
-                recordCount--;
-                removedCount++;
+            }
+            nodes.resize(kept);
+        }
+    };
+
+    // and 连接的多个谓词：第一个谓词扫描，其余谓词依次在候选节点上过滤，每一趟内部都是直接调用
+    struct AllOf : Concept {
+        vector<RecordPredicate> parts;
+
+        explicit AllOf(vector<RecordPredicate> p) : parts(std::move(p)) {}
+
+        bool test(const map<string, Value>& data) const override {
+            for (const auto& part : parts) {
+                if (!part(data)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        long long filterList(RecordNode* head, vector<RecordNode*>& out) const override {
+            size_t first = out.size();
+            long long scanned = parts[0].filterList(head, out);
+            vector<RecordNode*> candidates(out.begin() + first, out.end());
+            for (size_t i = 1; i < parts.size() && !candidates.empty(); i++) {
+                parts[i].filterNodes(candidates);
+            }
+            out.resize(first);
+            out.insert(out.end(), candidates.begin(), candidates.end());
+            return scanned;
+        }
+
+        void filterNodes(vector<RecordNode*>& nodes) const override {
+            for (const auto& part : parts) {
+                part.filterNodes(nodes);
+            }
+        }
+    };
+
+    shared_ptr<const Concept> impl;
+
+    explicit RecordPredicate(shared_ptr<const Concept> model) : impl(std::move(model)) {}
+
+public:
+    template <typename Kernel,
+              typename = typename enable_if<!is_same<typename decay<Kernel>::type, RecordPredicate>::value>::type>
+    RecordPredicate(Kernel kernel) : impl(make_shared<Model<Kernel>>(std::move(kernel))) {}
+
+    // parts 不能为空
+    static RecordPredicate allOf(vector<RecordPredicate> parts) {
+        shared_ptr<const Concept> combined = make_shared<AllOf>(std::move(parts));
+        return RecordPredicate(std::move(combined));
+    }
+
+    bool operator()(const map<string, Value>& data) const {
+        return impl->test(data);
+    }
+
+    long long filterList(RecordNode* head, vector<RecordNode*>& out) const {
+        return impl->filterList(head, out);
+    }
+
+    void filterNodes(vector<RecordNode*>& nodes) const {
+        impl->filterNodes(nodes);
+    }
+};
+
+// ==================== 谓词内核 ====================
+
+// 字段类型到 Value 成员的映射，供谓词内核在编译期选定读取方式
+template <FieldType Type> struct FieldTraits;
+template <> struct FieldTraits<FIELD_INT> {
+    static int get(const Value& v) { return v.intVal; }
+};
+template <> struct FieldTraits<FIELD_INT64> {
+    static long long get(const Value& v) { return v.int64Val; }
+};
+template <> struct FieldTraits<FIELD_TIMESTAMP> {
+    static long long get(const Value& v) { return v.int64Val; }
+};
+template <> struct FieldTraits<FIELD_BOOL> {
+    static bool get(const Value& v) { return v.boolVal; }
+};
+template <> struct FieldTraits<FIELD_DOUBLE> {
+    static double get(const Value& v) { return v.doubleVal; }
+};
+template <> struct FieldTraits<FIELD_STRING> {
+    static const InternedString& get(const Value& v) { return v.strVal; }
+};
+
+// 运算符内核：语义与 DatabaseUtils::evaluateValue 一致（浮点相等带 1e-9 容差，CONTAINS 仅对字符串有效）
+template <Operator Op> struct OperatorKernel;
+template <> struct OperatorKernel<EQUAL> {
+    template <typename T> static bool apply(const T& lhs, const T& rhs) { return lhs == rhs; }
+    static bool apply(double lhs, double rhs) { return fabs(lhs - rhs) < 1e-9; }
+};
+template <> struct OperatorKernel<NOT_EQUAL> {
+    template <typename T> static bool apply(const T& lhs, const T& rhs) { return lhs != rhs; }
+    static bool apply(double lhs, double rhs) { return fabs(lhs - rhs) >= 1e-9; }
+};
+template <> struct OperatorKernel<GREATER> {
+    template <typename T> static bool apply(const T& lhs, const T& rhs) { return lhs > rhs; }
+};
+template <> struct OperatorKernel<LESS> {
+    template <typename T> static bool apply(const T& lhs, const T& rhs) { return lhs < rhs; }
+};
+template <> struct OperatorKernel<GREATER_EQUAL> {
+    template <typename T> static bool apply(const T& lhs, const T& rhs) { return lhs >= rhs; }
+};
+template <> struct OperatorKernel<LESS_EQUAL> {
+    template <typename T> static bool apply(const T& lhs, const T& rhs) { return lhs <= rhs; }
+};
+template <> struct OperatorKernel<CONTAINS> {
+    template <typename T> static bool apply(const T&, const T&) { return false; }
+    static bool apply(const InternedString& lhs, const InternedString& rhs) {
+        return lhs.str().find(rhs.str()) != string::npos;
+    }
+};
+
+// 单个条件的内核：字段类型与运算符都是模板参数，逐行只剩一次字段查找和一次内联比较
+template <FieldType Type, Operator Op>
+struct TermKernel {
+    string fieldName;
+    Value value;
+
+    bool operator()(const map<string, Value>& data) const {
+        auto it = data.find(fieldName);
+        if (it == data.end() || it->second.isNull || it->second.type != Type) {
+            return false;
+        }
+        return OperatorKernel<Op>::apply(FieldTraits<Type>::get(it->second), FieldTraits<Type>::get(value));
+    }
+};
+
+// 融合区间内核：同一字段上的 lo <(=) f 与 f <(=) hi 只查找一次字段
+template <FieldType Type, Operator LowOp, Operator HighOp>
+struct RangeKernel {
+    string fieldName;
+    Value low;
+    Value high;
+
+    bool operator()(const map<string, Value>& data) const {
+        auto it = data.find(fieldName);
+        if (it == data.end() || it->second.isNull || it->second.type != Type) {
+            return false;
+        }
+        const auto& v = FieldTraits<Type>::get(it->second);
+        return OperatorKernel<LowOp>::apply(v, FieldTraits<Type>::get(low))
+               && OperatorKernel<HighOp>::apply(v, FieldTraits<Type>::get(high));
+    }
+};
+
+// "== null" / "!= null"
+template <bool WantNull>
+struct NullKernel {
+    string fieldName;
+
+    bool operator()(const map<string, Value>& data) const {
+        auto it = data.find(fieldName);
+        return it != data.end() && it->second.isNull == WantNull;
+    }
+};
+
+// 谓词编译：每次查询开始时按条件选定一次内核实例，之后逐行调用不再分派类型与运算符
+// 多个条件之间为 and 关系，同一字段上的一个下界与一个上界会被融合为区间内核
+class PredicateCompiler {
+private:
+    static bool isLowerBound(const Condition& c) {
+        return !c.value.isNull && (c.op == GREATER || c.op == GREATER_EQUAL);
+    }
+
+    static bool isUpperBound(const Condition& c) {
+        return !c.value.isNull && (c.op == LESS || c.op == LESS_EQUAL);
+    }
+
+    template <FieldType Type>
+    static RecordPredicate termForType(const Condition& c) {
+        switch (c.op) {
+            case EQUAL: return TermKernel<Type, EQUAL>{c.fieldName, c.value};
+            case NOT_EQUAL: return TermKernel<Type, NOT_EQUAL>{c.fieldName, c.value};
+            case GREATER: return TermKernel<Type, GREATER>{c.fieldName, c.value};
+            case LESS: return TermKernel<Type, LESS>{c.fieldName, c.value};
+            case GREATER_EQUAL: return TermKernel<Type, GREATER_EQUAL>{c.fieldName, c.value};
+            case LESS_EQUAL: return TermKernel<Type, LESS_EQUAL>{c.fieldName, c.value};
+            case CONTAINS: return TermKernel<Type, CONTAINS>{c.fieldName, c.value};
+        }
+        return [](const map<string, Value>&) { return false; };
+    }
+
+    template <FieldType Type, Operator LowOp>
+    static RecordPredicate rangeForLow(const Condition& low, const Condition& high) {
+        if (high.op == LESS) {
+            return RangeKernel<Type, LowOp, LESS>{low.fieldName, low.value, high.value};
+        }
+        return RangeKernel<Type, LowOp, LESS_EQUAL>{low.fieldName, low.value, high.value};
+    }
+
+    template <FieldType Type>
+    static RecordPredicate rangeForType(const Condition& low, const Condition& high) {
+        if (low.op == GREATER) {
+            return rangeForLow<Type, GREATER>(low, high);
+        }
+        return rangeForLow<Type, GREATER_EQUAL>(low, high);
+    }
+
+    static RecordPredicate compileTerm(const Condition& c) {
+        if (c.value.isNull) {
+            if (c.op == EQUAL) return NullKernel<true>{c.fieldName};
+            if (c.op == NOT_EQUAL) return NullKernel<false>{c.fieldName};
+            return [](const map<string, Value>&) { return false; };
+        }
+        switch (c.value.type) {
+            case FIELD_INT: return termForType<FIELD_INT>(c);
+            case FIELD_INT64: return termForType<FIELD_INT64>(c);
+            case FIELD_TIMESTAMP: return termForType<FIELD_TIMESTAMP>(c);
+            case FIELD_BOOL: return termForType<FIELD_BOOL>(c);
+            case FIELD_DOUBLE: return termForType<FIELD_DOUBLE>(c);
+            case FIELD_STRING: return termForType<FIELD_STRING>(c);
+        }
+        return [](const map<string, Value>&) { return false; };
+    }
+
+    static RecordPredicate compileRange(const Condition& low, const Condition& high) {
+        switch (low.value.type) {
+            case FIELD_INT: return rangeForType<FIELD_INT>(low, high);
+            case FIELD_INT64: return rangeForType<FIELD_INT64>(low, high);
+            case FIELD_TIMESTAMP: return rangeForType<FIELD_TIMESTAMP>(low, high);
+            case FIELD_BOOL: return rangeForType<FIELD_BOOL>(low, high);
+            case FIELD_DOUBLE: return rangeForType<FIELD_DOUBLE>(low, high);
+            case FIELD_STRING: return rangeForType<FIELD_STRING>(low, high);
+        }
+        return [](const map<string, Value>&) { return false; };
+    }
+
+    // 为 terms[i] 找一个可以融合的上界/下界条件，找不到返回 -1
+    static int findRangePartner(const vector<Condition>& terms, size_t i, const vector<bool>& used) {
+        const Condition& c = terms[i];
+        if (!isLowerBound(c) && !isUpperBound(c)) {
+            return -1;
+        }
+        for (size_t j = 0; j < terms.size(); j++) {
+            const Condition& other = terms[j];
+            if (j == i || used[j] || other.fieldName != c.fieldName || other.value.type != c.value.type) {
+                continue;
+            }
+            if ((isLowerBound(c) && isUpperBound(other)) || (isUpperBound(c) && isLowerBound(other))) {
+                return static_cast<int>(j);
+            }
+        }
+        return -1;
+    }
+
+public:
+    // 编译单个条件
+    static RecordPredicate compile(const Condition& condition) {
+        return compileTerm(condition);
+    }
+
+    // 编译 and 连接的多个条件，空列表匹配所有记录
+    static RecordPredicate compile(const vector<Condition>& terms) {
+        vector<RecordPredicate> parts;
+        vector<bool> used(terms.size(), false);
+        for (size_t i = 0; i < terms.size(); i++) {
+            if (used[i]) {
+                continue;
+            }
+            used[i] = true;
+            int partner = findRangePartner(terms, i, used);
+            if (partner < 0) {
+                parts.push_back(compileTerm(terms[i]));
+                continue;
+            }
+            used[partner] = true;
+            const Condition& a = terms[i];
+            const Condition& b = terms[partner];
+            parts.push_back(isLowerBound(a) ? compileRange(a, b) : compileRange(b, a));
+        }
+
+        if (parts.empty()) {
+            return [](const map<string, Value>&) { return true; };
+        }
+        if (parts.size() == 1) {
+            return parts[0];
+        }
+        return RecordPredicate::allOf(std::move(parts));
+    }
+
+    // 选出供存储层裁剪使用的条件：优先等值条件（可走单分片定位），否则取第一个
+    static const Condition* primaryTerm(const vector<Condition>& terms) {
+        for (const auto& term : terms) {
+            if (term.op == EQUAL && !term.value.isNull) {
+                return &term;
+            }
+        }
+        return terms.empty() ? nullptr : &terms[0];
+    }
+
+    // 描述编译结果（explain 使用）
+    static string describe(const vector<Condition>& terms) {
+        ostringstream oss;
+        vector<bool> used(terms.size(), false);
+        for (size_t i = 0; i < terms.size(); i++) {
+            if (used[i]) {
+                continue;
+            }
+            used[i] = true;
+            oss << (oss.tellp() > 0 ? " + " : "");
+            const Condition& c = terms[i];
+            int partner = findRangePartner(terms, i, used);
+            if (partner >= 0) {
+                used[partner] = true;
+                const Condition& low = isLowerBound(c) ? c : terms[partner];
+                const Condition& high = isLowerBound(c) ? terms[partner] : c;
+                oss << "区间(" << DatabaseUtils::fieldTypeName(c.value.type) << ") " << c.fieldName << " ∈ "
+                    << (low.op == GREATER ? "(" : "[") << low.value.toString() << ", " << high.value.toString()
+                    << (high.op == LESS ? ")" : "]");
+            } else if (c.value.isNull) {
+                oss << "NULL 判断 " << c.fieldName;
             } else {
-                // 不删除,继续遍历
-                prev = current;
-                current = current->next;
+                oss << "单条件(" << DatabaseUtils::fieldTypeName(c.value.type) << ") " << c.fieldName;
             }
         }
+        return oss.str();
+    }
+};
 
-        cout << "成功删除 " << removedCount << " 条记录,目前共 " << recordCount << " 条记录" << endl;
+// 存储层接口：Database 负责校验、统计与输出，存储层负责记录的存放与遍历
+class RecordStore {
+public:
+    virtual ~RecordStore() {}
+
+    virtual void append(RowId rowId, const map<string, Value>& record) = 0;
+
+    // 整批追加，第 i 条记录的行号为 firstRowId + i；中途失败时抛出异常，已追加的行由调用方撤销
+    virtual void appendBatch(RowId firstRowId, const vector<map<string, Value>>& records) {
+        for (size_t i = 0; i < records.size(); i++) {
+            append(firstRowId + i, records[i]);
+        }
     }
 
-    // 查找满足条件的记录
-    // predicate: 判断函数,接受一个记录的引用,返回true表示该记录满足条件
-    // 返回: 包含所有满足条件的记录指针的列表
-    vector<RecordNode*> locate_elements_with_features(const function<bool(const map<string, Value>&)>& predicate) {
-        vector<RecordNode*> result;
-        RecordNode* current = RecordHead;
+    // 查找满足条件的记录；hint 非空时可用于块裁剪（满足 predicate 的记录必然满足 hint）
+    // 返回的指针在下一次修改或查询之前有效
+    virtual vector<RecordNode*> select(const RecordPredicate& predicate, const Condition* hint,
+                                       QueryProfile& profile) = 0;
+
+    // 删除满足条件的记录，onRemoved 在每条记录被删除前调用，返回删除条数
+    virtual int removeIf(const RecordPredicate& predicate, const Condition* hint, QueryProfile& profile,
+                         const RecordVisitor& onRemoved) = 0;
+
+    // 按行号删除记录，onRemoved 在每条记录被删除前调用，返回删除条数
+    virtual int removeRows(const vector<RowId>& rowIds, const RecordVisitor& onRemoved) = 0;
+
+    // 用新内容替换指定行号的记录，行号不存在时返回 false
+    virtual bool replaceRow(RowId rowId, const map<string, Value>& record) = 0;
+
+    // 读取指定行号的记录，行号不存在时返回 false
+    virtual bool fetchRow(RowId rowId, map<string, Value>& out) = 0;
+
+    // 只访问给定行号（索引查找得到的候选行），返回其中满足条件的记录；指针有效期同 select
+    virtual vector<RecordNode*> selectRows(const vector<RowId>& rowIds, const RecordPredicate& predicate,
+                                           QueryProfile& profile) = 0;
+
+    // 按行号取一行相对顺序扫描一行的代价，供优化器比较索引与扫描
+    // 内存存储实测：随机取行（哈希查找 + 不连续的节点）约为顺序扫描一行的 12 倍
+    virtual double fetchCost() const {
+        return 12.0;
+    }
+
+    // 更新满足条件的记录：apply 修改记录并返回是否接受修改，不接受时由 apply 负责恢复原值
+    // 返回成功更新的条数，failedCount 返回被拒绝的条数
+    virtual int updateIf(const RecordPredicate& predicate,
+                         const function<bool(RowId, map<string, Value>&)>& apply,
+                         QueryProfile& profile, int& failedCount) = 0;
+
+    // 按存储顺序遍历所有记录
+    virtual void forEach(const RecordVisitor& visitor) = 0;
+
+    // 对满足条件的记录做聚合；fieldName 为空表示 count(*)
+    virtual AggregateState aggregate(const RecordPredicate& predicate, const Condition* hint,
+                                     const string& fieldName, QueryProfile& profile) {
+        AggregateState state;
+        for (RecordNode* node : select(predicate, hint, profile)) {
+            state.addRecord(node->data, fieldName);
+        }
+        return state;
+    }
+
+    // 只根据元信息估算一次扫描需要访问的行、块与字节
+    virtual QueryProfile plan(const Condition* hint) const = 0;
+
+    virtual long long dataBytes() const = 0;
+
+    // 常驻内存的记录数据字节数；分页存储只有缓冲池与页元信息常驻内存
+    virtual long long residentBytes() const {
+        return dataBytes();
+    }
+
+    // 行号索引等辅助结构占用的字节数
+    virtual long long indexBytes() const {
+        return 0;
+    }
+
+    virtual string describe() const = 0;
+};
+
+// 内存存储：双向链表，新记录插入表头；按行号建立哈希索引以便 O(1) 定位单行
+class MemoryRecordStore : public RecordStore {
+private:
+    RecordNode* head;
+    unordered_map<RowId, RecordNode*> rows;
+    long long bytes;
 
+    void unlink(RecordNode* node) {
+        if (node->prev != nullptr) {
+            node->prev->next = node->next;
+        } else {
+            head = node->next;
+        }
+        if (node->next != nullptr) {
+            node->next->prev = node->prev;
+        }
+        rows.erase(node->rowId);
+        bytes -= DatabaseUtils::estimateRecordBytes(node->data);
+        delete node;
+    }
+
+public:
+    MemoryRecordStore() : head(nullptr), bytes(0) {}
+
+    ~MemoryRecordStore() {
+        RecordNode* current = head;
         while (current != nullptr) {
-            if (predicate(current->data)) {
-                result.push_back(current);
-            }
+            RecordNode* toDelete = current;
             current = current->next;
+            delete toDelete;
         }
+    }
 
-        cout << "找到 " << result.size() << " 条满足条件的记录" << endl;
+    MemoryRecordStore(const MemoryRecordStore&) = delete;
+    MemoryRecordStore& operator=(const MemoryRecordStore&) = delete;
+
+    void append(RowId rowId, const map<string, Value>& record) override {
+        RecordNode* newNode = new RecordNode();
+        newNode->data = record;
+        newNode->rowId = rowId;
+        newNode->next = head;
+        if (head != nullptr) {
+            head->prev = newNode;
+        }
+        head = newNode;
+        rows[rowId] = newNode;
+        bytes += DatabaseUtils::estimateRecordBytes(newNode->data);
+    }
+
+    vector<RecordNode*> select(const RecordPredicate& predicate, const Condition*,
+                               QueryProfile& profile) override {
+        profile.accessPath = ACCESS_FULL_SCAN;
+        profile.bytesTouched += bytes;
+        vector<RecordNode*> result;
+        profile.rowsScanned += predicate.filterList(head, result);
+        profile.rowsMatched += result.size();
         return result;
     }
-    
-    // 显示所有记录
-    void display_all_elements() {
-        if (RecordHead == nullptr) {
-            cout << "数据库 \"" << name << "\" 中没有记录" << endl;
-            return;
+
+    // 先整表过滤出要删除的节点，再逐个摘除
+    int removeIf(const RecordPredicate& predicate, const Condition*, QueryProfile& profile,
+                 const RecordVisitor& onRemoved) override {
+        profile.accessPath = ACCESS_FULL_SCAN;
+        profile.bytesTouched += bytes;
+        vector<RecordNode*> matched;
+        profile.rowsScanned += predicate.filterList(head, matched);
+        for (RecordNode* node : matched) {
+            onRemoved(node->rowId, node->data);
+            unlink(node);
         }
+        profile.rowsMatched += matched.size();
+        return static_cast<int>(matched.size());
+    }
 
-        cout << "========== 数据库: " << name << " ==========" << endl;
-        cout << "共有 " << recordCount << " 条记录" << endl;
-        cout << "======================================" << endl;
+    int removeRows(const vector<RowId>& rowIds, const RecordVisitor& onRemoved) override {
+        int removedCount = 0;
+        for (RowId rowId : rowIds) {
+            auto it = rows.find(rowId);
+            if (it == rows.end()) {
+                continue;
+            }
+            onRemoved(rowId, it->second->data);
+            unlink(it->second);
+            removedCount++;
+        }
+        return removedCount;
+    }
 
-        RecordNode* current = RecordHead;
-        int index = 1;
+    bool replaceRow(RowId rowId, const map<string, Value>& record) override {
+        auto it = rows.find(rowId);
+        if (it == rows.end()) {
+            return false;
+        }
+        bytes += DatabaseUtils::estimateRecordBytes(record) - DatabaseUtils::estimateRecordBytes(it->second->data);
+        it->second->data = record;
+        return true;
+    }
 
-        while (current != nullptr) {
-            cout << "记录 #" << index << ":" << endl;
-            
-            // 遍历当前记录的所有字段
-            for (const auto& field : current->data) {
-                cout << "  " << field.first << ": " << field.second.toString() << endl;
+    bool fetchRow(RowId rowId, map<string, Value>& out) override {
+        auto it = rows.find(rowId);
+        if (it == rows.end()) {
+            return false;
+        }
+        out = it->second->data;
+        return true;
+    }
+
+    vector<RecordNode*> selectRows(const vector<RowId>& rowIds, const RecordPredicate& predicate,
+                                   QueryProfile& profile) override {
+        vector<RecordNode*> result;
+        for (RowId rowId : rowIds) {
+            auto it = rows.find(rowId);
+            if (it == rows.end()) {
+                continue;
             }
-            
-            cout << "--------------------------------------" << endl;
-            current = current->next;
-            index++;
+            profile.rowsScanned++;
+            profile.bytesTouched += DatabaseUtils::estimateRecordBytes(it->second->data);
+            result.push_back(it->second);
+        }
+        predicate.filterNodes(result);
+        profile.rowsMatched += result.size();
+        return result;
+    }
+
+    int updateIf(const RecordPredicate& predicate, const function<bool(RowId, map<string, Value>&)>& apply,
+                 QueryProfile& profile, int& failedCount) override {
+        profile.accessPath = ACCESS_FULL_SCAN;
+        profile.bytesTouched += bytes;
+        int updatedCount = 0;
+        failedCount = 0;
+        vector<RecordNode*> matched;
+        profile.rowsScanned += predicate.filterList(head, matched);
+        for (RecordNode* current : matched) {
+            long long before = DatabaseUtils::estimateRecordBytes(current->data);
+            if (apply(current->rowId, current->data)) {
+                bytes += DatabaseUtils::estimateRecordBytes(current->data) - before;
+                updatedCount++;
+            } else {
+                failedCount++;
+            }
+        }
+        profile.rowsMatched += updatedCount + failedCount;
+        return updatedCount;
+    }
+
+    void forEach(const RecordVisitor& visitor) override {
+        for (RecordNode* current = head; current != nullptr; current = current->next) {
+            visitor(current->rowId, current->data);
+        }
+    }
+
+    QueryProfile plan(const Condition*) const override {
+        QueryProfile estimate;
+        estimate.accessPath = ACCESS_FULL_SCAN;
+        estimate.rowsScanned = static_cast<long long>(rows.size());
+        estimate.bytesTouched = bytes;
+        return estimate;
+    }
+
+    long long dataBytes() const override {
+        return bytes;
+    }
+
+    long long indexBytes() const override {
+        return DatabaseUtils::hashMapBytes(rows);
+    }
+
+    string describe() const override {
+        return "内存链表";
+    }
+};
+
+// 为分页存储选择页面文件路径：放在环境变量 CMDBS_DATA_DIR 指定的目录（未设置时为系统临时目录），
+// 文件名带进程号与序号，同一台机器上的多个实例（如主库与跟随它的副本）不会共用同一个文件
+inline string makePageFilePath(const string& dbName) {
+    static atomic<unsigned> sequence(0);
+#ifdef _WIN32
+    unsigned long pid = GetCurrentProcessId();
+#else
+    unsigned long pid = static_cast<unsigned long>(getpid());
+#endif
+    const char* configured = getenv("CMDBS_DATA_DIR");
+    filesystem::path dir = configured != nullptr && *configured != '\0' ? filesystem::path(configured)
+                                                                         : filesystem::temp_directory_path();
+    while (true) {
+        filesystem::path candidate = dir / (dbName + "." + to_string(pid) + "." + to_string(sequence++) + ".cmdbs.pages");
+        if (!filesystem::exists(candidate)) {
+            return candidate.string();
+        }
+    }
+}
+
+// 固定大小的页缓冲池：CLOCK 置换，缺页时按顺序预读后续页面
+// 页面文件仅作为溢出存储使用，由缓冲池创建并在销毁时删除；已存在的文件不会被覆盖
+class BufferPool {
+public:
+    static const size_t PAGE_SIZE = 4096;
+
+private:
+    struct Frame {
+        int pageId;
+        int pinCount;
+        bool dirty;
+        bool referenced;
+
+        Frame() : pageId(-1), pinCount(0), dirty(false), referenced(false) {}
+    };
+
+    string path;
+    fstream file;
+    vector<char> memory;          // frames.size() * PAGE_SIZE 字节
+    vector<Frame> frames;
+    unordered_map<int, size_t> pageTable;  // 页号 -> 帧号
+    size_t clockHand;
+    int numPages;
+    long long pagesRead;
+    long long pagesWritten;
+
+    char* frameData(size_t frame) {
+        return &memory[frame * PAGE_SIZE];
+    }
+
+    void writeBack(size_t frame) {
+        Frame& f = frames[frame];
+        if (f.pageId < 0 || !f.dirty) {
+            return;
+        }
+        file.seekp(static_cast<streamoff>(f.pageId) * PAGE_SIZE);
+        file.write(frameData(frame), PAGE_SIZE);
+        f.dirty = false;
+        pagesWritten++;
+    }
+
+    // CLOCK 算法：跳过被固定的帧，被引用的帧给一次“第二次机会”
+    size_t findVictim() {
+        for (size_t step = 0; step < 2 * frames.size(); step++) {
+            size_t frame = clockHand;
+            clockHand = (clockHand + 1) % frames.size();
+            Frame& f = frames[frame];
+            if (f.pinCount > 0) {
+                continue;
+            }
+            if (f.referenced) {
+                f.referenced = false;
+                continue;
+            }
+            writeBack(frame);
+            if (f.pageId >= 0) {
+                pageTable.erase(f.pageId);
+            }
+            f = Frame();
+            return frame;
+        }
+        throw runtime_error("缓冲池中所有页面均被固定，无法置换");
+    }
+
+public:
+    BufferPool(const string& filePath, size_t frameCount)
+        : path(filePath), memory(max<size_t>(frameCount, 2) * PAGE_SIZE), frames(max<size_t>(frameCount, 2)),
+          clockHand(0), numPages(0), pagesRead(0), pagesWritten(0) {
+        if (filesystem::exists(path)) {
+            throw runtime_error("页面文件 " + path + " 已存在，可能属于其他实例，拒绝覆盖");
+        }
+        file.open(path, ios::in | ios::out | ios::binary | ios::trunc);
+        if (!file.is_open()) {
+            throw runtime_error("无法创建页面文件 " + path);
+        }
+    }
+
+    ~BufferPool() {
+        file.close();
+        remove(path.c_str());
+    }
+
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    // 读取并固定页面，使用完毕后必须调用 unpin
+    char* pin(int pageId) {
+        auto it = pageTable.find(pageId);
+        if (it == pageTable.end()) {
+            size_t frame = findVictim();
+            file.seekg(static_cast<streamoff>(pageId) * PAGE_SIZE);
+            file.read(frameData(frame), PAGE_SIZE);
+            file.clear();
+            pagesRead++;
+            frames[frame].pageId = pageId;
+            it = pageTable.emplace(pageId, frame).first;
+        }
+        Frame& f = frames[it->second];
+        f.pinCount++;
+        f.referenced = true;
+        return frameData(it->second);
+    }
+
+    void unpin(int pageId, bool dirty) {
+        auto it = pageTable.find(pageId);
+        if (it == pageTable.end()) {
+            return;
+        }
+        Frame& f = frames[it->second];
+        if (f.pinCount > 0) {
+            f.pinCount--;
+        }
+        f.dirty = f.dirty || dirty;
+    }
+
+    // 在文件末尾分配一个清零的新页面并固定
+    char* allocatePage(int& pageId) {
+        pageId = numPages++;
+        size_t frame = findVictim();
+        memset(frameData(frame), 0, PAGE_SIZE);
+        frames[frame].pageId = pageId;
+        frames[frame].dirty = true;
+        frames[frame].pinCount = 1;
+        frames[frame].referenced = true;
+        pageTable[pageId] = frame;
+        return frameData(frame);
+    }
+
+    // 顺序扫描预读：若 firstPage 不在缓冲池中，一次性读入从它开始的连续缺页（最多 count 页）
+    void prefetch(int firstPage, int count) {
+        if (pageTable.count(firstPage) != 0) {
+            return;
+        }
+        int limit = static_cast<int>(min<size_t>(static_cast<size_t>(count), frames.size() / 2 + 1));
+        int run = 0;
+        while (run < limit && firstPage + run < numPages && pageTable.count(firstPage + run) == 0) {
+            run++;
+        }
+        if (run == 0) {
+            return;
+        }
+        vector<char> buffer(static_cast<size_t>(run) * PAGE_SIZE);
+        file.seekg(static_cast<streamoff>(firstPage) * PAGE_SIZE);
+        file.read(buffer.data(), buffer.size());
+        file.clear();
+        for (int i = 0; i < run; i++) {
+            size_t frame = findVictim();
+            memcpy(frameData(frame), &buffer[static_cast<size_t>(i) * PAGE_SIZE], PAGE_SIZE);
+            frames[frame].pageId = firstPage + i;
+            frames[frame].referenced = true;
+            pageTable[firstPage + i] = frame;
+        }
+        pagesRead += run;
+    }
+
+    int getPageCount() const {
+        return numPages;
+    }
+
+    size_t getFrameCount() const {
+        return frames.size();
+    }
+
+    long long getPagesRead() const {
+        return pagesRead;
+    }
+
+    long long getPagesWritten() const {
+        return pagesWritten;
+    }
+};
+
+// 分页存储：记录按表结构顺序序列化到 4KB 页面中，页面通过缓冲池按需读入
+// 页面布局：[uint16 槽位数][uint16 已用字节] 之后依次为 [uint16 长度][uint8 有效位][uint64 行号][数据]
+// 删除先清除有效位，页面被修改后再整理页内空间，空出的页面供后续追加复用；
+// 每页维护非字符串字段的最小/最大值（zone map）用于跳过不可能命中的页
+class PagedRecordStore : public RecordStore {
+private:
+    static const size_t HEADER_SIZE = 4;
+    static const size_t SLOT_HEADER_SIZE = 3 + sizeof(RowId);
+    static const int READ_AHEAD_PAGES = 8;
+    static const int REUSE_FREE_BYTES = BufferPool::PAGE_SIZE / 4;  // 空闲空间达到该值的页面才进入复用列表
+
+    struct PageMeta {
+        int liveCount;
+        int usedBytes;
+        int deadBytes;            // 已删除槽位占用、尚未整理回收的字节数
+        vector<Value> minVal;     // 按字段下标，字符串字段不维护
+        vector<Value> maxVal;
+        vector<bool> hasValue;    // 该字段在本页是否出现过非 NULL 值
+
+        PageMeta() : liveCount(0), usedBytes(static_cast<int>(HEADER_SIZE)), deadBytes(0) {}
+    };
+
+    vector<Field> fields;
+    size_t nullBitmapBytes;  // 每条记录开头的 NULL 位图长度
+    BufferPool pool;
+    vector<PageMeta> pages;
+    vector<unique_ptr<RecordNode>> materialized;  // select 返回的记录副本
+    vector<RecordNode> pageRecords;               // scanPage 反序列化整页记录的缓冲，跨页复用
+    long long liveRecords;
+    unordered_map<RowId, int> rowPages;  // 行号 -> 所在页，按行号删除/读取时只访问相关的页
+    set<int> reusablePages;              // 整理后空闲空间较多的页，追加时优先填入
+
+    static uint16_t readU16(const char* p) {
+        uint16_t v;
+        memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    static void writeU16(char* p, uint16_t v) {
+        memcpy(p, &v, sizeof(v));
+    }
+
+    // 可以维护块最值的字段类型
+    static bool hasZoneMap(FieldType type) {
+        return type != FIELD_STRING;
+    }
+
+    template <typename T>
+    static void appendRaw(string& out, const T& v) {
+        out.append(reinterpret_cast<const char*>(&v), sizeof(v));
+    }
+
+    template <typename T>
+    static T readRaw(const char*& p) {
+        T v;
+        memcpy(&v, p, sizeof(v));
+        p += sizeof(v);
+        return v;
+    }
+
+    // 记录格式：[NULL 位图] 之后按字段顺序存放非 NULL 字段的值
+    void serialize(const map<string, Value>& record, string& out) const {
+        out.assign(nullBitmapBytes, '\0');
+        for (size_t i = 0; i < fields.size(); i++) {
+            const Value& v = record.at(fields[i].name);
+            if (v.isNull) {
+                out[i / 8] = static_cast<char>(out[i / 8] | (1 << (i % 8)));
+                continue;
+            }
+            switch (fields[i].type) {
+                case FIELD_INT: appendRaw(out, v.intVal); break;
+                case FIELD_DOUBLE: appendRaw(out, v.doubleVal); break;
+                case FIELD_INT64:
+                case FIELD_TIMESTAMP: appendRaw(out, v.int64Val); break;
+                case FIELD_BOOL: appendRaw(out, static_cast<uint8_t>(v.boolVal ? 1 : 0)); break;
+                case FIELD_STRING:
+                    appendRaw(out, static_cast<uint16_t>(v.strVal.str().size()));
+                    out.append(v.strVal.str());
+                    break;
+            }
+        }
+    }
+
+    void deserialize(const char* p, map<string, Value>& record) const {
+        record.clear();
+        const char* bitmap = p;
+        p += nullBitmapBytes;
+        for (size_t i = 0; i < fields.size(); i++) {
+            const Field& field = fields[i];
+            if (bitmap[i / 8] & (1 << (i % 8))) {
+                record[field.name] = DatabaseUtils::makeNullValue(field.type);
+                continue;
+            }
+            switch (field.type) {
+                case FIELD_INT: record[field.name] = DatabaseUtils::makeIntValue(readRaw<int>(p)); break;
+                case FIELD_DOUBLE: record[field.name] = DatabaseUtils::makeDoubleValue(readRaw<double>(p)); break;
+                case FIELD_INT64: record[field.name] = DatabaseUtils::makeInt64Value(readRaw<long long>(p)); break;
+                case FIELD_TIMESTAMP:
+                    record[field.name] = DatabaseUtils::makeTimestampValue(readRaw<long long>(p));
+                    break;
+                case FIELD_BOOL: record[field.name] = DatabaseUtils::makeBoolValue(readRaw<uint8_t>(p) != 0); break;
+                case FIELD_STRING: {
+                    uint16_t len = readRaw<uint16_t>(p);
+                    record[field.name] = DatabaseUtils::makeUnpooledStringValue(string(p, len));
+                    p += len;
+                    break;
+                }
+            }
+        }
+    }
+
+    void updateZoneMap(PageMeta& meta, const map<string, Value>& record) const {
+        if (meta.hasValue.empty()) {
+            meta.minVal.resize(fields.size());
+            meta.maxVal.resize(fields.size());
+            meta.hasValue.assign(fields.size(), false);
+        }
+        for (size_t i = 0; i < fields.size(); i++) {
+            const Value& v = record.at(fields[i].name);
+            if (!hasZoneMap(fields[i].type) || v.isNull) {
+                continue;
+            }
+            if (!meta.hasValue[i]) {
+                meta.minVal[i] = v;
+                meta.maxVal[i] = v;
+                meta.hasValue[i] = true;
+                continue;
+            }
+            if (DatabaseUtils::compareValues(v, meta.minVal[i]) < 0) meta.minVal[i] = v;
+            if (DatabaseUtils::compareValues(v, meta.maxVal[i]) > 0) meta.maxVal[i] = v;
+        }
+    }
+
+    int zoneMapFieldIndex(const Condition* hint) const {
+        if (hint == nullptr || hint->value.isNull) {
+            return -1;
+        }
+        for (size_t i = 0; i < fields.size(); i++) {
+            if (fields[i].name == hint->fieldName) {
+                return hasZoneMap(fields[i].type) ? static_cast<int>(i) : -1;
+            }
+        }
+        return -1;
+    }
+
+    // 根据 zone map 判断整页是否不可能包含满足条件的记录
+    // 页内该字段全为 NULL 时任何非 NULL 比较都不成立，整页可以跳过
+    bool canSkip(const PageMeta& meta, int fieldIndex, const Condition& hint) const {
+        if (fieldIndex < 0 || meta.hasValue.empty()) {
+            return false;
+        }
+        if (!meta.hasValue[fieldIndex]) {
+            return true;
+        }
+        int vsLo = DatabaseUtils::compareValues(hint.value, meta.minVal[fieldIndex]);
+        int vsHi = DatabaseUtils::compareValues(hint.value, meta.maxVal[fieldIndex]);
+        switch (hint.op) {
+            case EQUAL: return vsLo < 0 || vsHi > 0;
+            case NOT_EQUAL: return vsLo == 0 && vsHi == 0 && fields[fieldIndex].type != FIELD_DOUBLE;
+            case GREATER: return vsHi >= 0;
+            case LESS: return vsLo <= 0;
+            case GREATER_EQUAL: return vsHi > 0;
+            case LESS_EQUAL: return vsLo < 0;
+            default: return false;
+        }
+    }
+
+    void markDead(char* slotPtr, PageMeta& meta) {
+        slotPtr[2] = 0;
+        meta.liveCount--;
+        meta.deadBytes += static_cast<int>(SLOT_HEADER_SIZE + readU16(slotPtr));
+    }
+
+    // 把有效槽位依次前移，回收已删除槽位的空间。整理后 zone map 只会偏宽，仍可用于裁剪；
+    // 页面清空时重置 zone map
+    void compactPage(int pageId, char* page) {
+        PageMeta& meta = pages[pageId];
+        uint16_t slots = readU16(page);
+        size_t from = HEADER_SIZE;
+        size_t to = HEADER_SIZE;
+        uint16_t kept = 0;
+        for (uint16_t slot = 0; slot < slots; slot++) {
+            char* slotPtr = page + from;
+            size_t size = SLOT_HEADER_SIZE + readU16(slotPtr);
+            from += size;
+            if (slotPtr[2] == 0) {
+                continue;
+            }
+            if (to != from - size) {
+                memmove(page + to, slotPtr, size);
+            }
+            to += size;
+            kept++;
+        }
+        writeU16(page, kept);
+        writeU16(page + 2, static_cast<uint16_t>(to));
+        meta.usedBytes = static_cast<int>(to);
+        meta.deadBytes = 0;
+        if (meta.liveCount == 0) {
+            meta.minVal.clear();
+            meta.maxVal.clear();
+            meta.hasValue.clear();
+        }
+        if (BufferPool::PAGE_SIZE - to >= static_cast<size_t>(REUSE_FREE_BYTES)) {
+            reusablePages.insert(pageId);
+        }
+    }
+
+    // 选择能放下 needed 字节的页面：先找复用列表，再看最后一页，都放不下时返回 -1；
+    // 复用列表中放不下本条记录且剩余空间已不多的页面顺带移出
+    int findPageWithSpace(size_t needed) {
+        for (auto it = reusablePages.begin(); it != reusablePages.end();) {
+            size_t used = static_cast<size_t>(pages[*it].usedBytes);
+            if (used + needed <= BufferPool::PAGE_SIZE) {
+                return *it;
+            }
+            if (BufferPool::PAGE_SIZE - used < static_cast<size_t>(REUSE_FREE_BYTES)) {
+                it = reusablePages.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        int last = static_cast<int>(pages.size()) - 1;
+        if (last >= 0 && pages[last].usedBytes + needed <= BufferPool::PAGE_SIZE) {
+            return last;
+        }
+        return -1;
+    }
+
+    typedef function<bool(char* slot, RowId rowId, const map<string, Value>& record, PageMeta& meta)> SlotVisitor;
+
+    // 扫描单个页面内的有效记录：先把整页反序列化，filter 非空时对整页批量过滤，只把命中的记录交给 visitor
+    void scanPage(int pageId, QueryProfile& profile, const SlotVisitor& visitor, const RecordPredicate* filter = nullptr) {
+        PageMeta& meta = pages[pageId];
+        char* page = pool.pin(pageId);
+        profile.bytesTouched += BufferPool::PAGE_SIZE;
+        bool dirty = false;
+        uint16_t slots = readU16(page);
+        if (pageRecords.size() < slots) {
+            pageRecords.resize(slots);
+        }
+        vector<char*> slotPtrs;
+        vector<RecordNode*> candidates;
+        size_t offset = HEADER_SIZE;
+        for (uint16_t slot = 0; slot < slots; slot++) {
+            char* slotPtr = page + offset;
+            uint16_t len = readU16(slotPtr);
+            offset += SLOT_HEADER_SIZE + len;
+            if (slotPtr[2] == 0) {
+                continue;
+            }
+            profile.rowsScanned++;
+            RecordNode& row = pageRecords[candidates.size()];
+            memcpy(&row.rowId, slotPtr + 3, sizeof(row.rowId));
+            deserialize(slotPtr + SLOT_HEADER_SIZE, row.data);
+            slotPtrs.push_back(slotPtr);
+            candidates.push_back(&row);
+        }
+        if (filter != nullptr) {
+            filter->filterNodes(candidates);
+        }
+        for (RecordNode* row : candidates) {
+            char* slotPtr = slotPtrs[static_cast<size_t>(row - pageRecords.data())];
+            dirty = visitor(slotPtr, row->rowId, row->data, meta) || dirty;
+        }
+        if (meta.deadBytes > 0) {
+            compactPage(pageId, page);
+            dirty = true;
+        }
+        pool.unpin(pageId, dirty);
+    }
+
+    // 逐页扫描；visitor 接收页内记录的起始地址、行号与反序列化后的记录，返回 true 表示页面被修改
+    void scanPages(const Condition* hint, QueryProfile& profile, const SlotVisitor& visitor,
+                   const RecordPredicate* filter = nullptr) {
+        int fieldIndex = zoneMapFieldIndex(hint);
+        profile.accessPath = fieldIndex >= 0 ? ACCESS_ZONE_MAP : ACCESS_FULL_SCAN;
+        int pageCount = static_cast<int>(pages.size());
+        profile.blocksTotal += pageCount;
+
+        for (int pageId = 0; pageId < pageCount; pageId++) {
+            PageMeta& meta = pages[pageId];
+            if (meta.liveCount == 0 || (hint != nullptr && canSkip(meta, fieldIndex, *hint))) {
+                profile.blocksSkipped++;
+                continue;
+            }
+            pool.prefetch(pageId, READ_AHEAD_PAGES);
+            scanPage(pageId, profile, visitor, filter);
+        }
+    }
+
+    // 只扫描包含指定行号的页面（按页号顺序，便于顺序读）
+    void scanRowPages(const vector<RowId>& rowIds, const SlotVisitor& visitor, QueryProfile* profile = nullptr) {
+        set<int> targetPages;
+        for (RowId rowId : rowIds) {
+            auto it = rowPages.find(rowId);
+            if (it != rowPages.end()) {
+                targetPages.insert(it->second);
+            }
+        }
+        QueryProfile ignored;
+        QueryProfile& target = profile != nullptr ? *profile : ignored;
+        target.blocksTotal += static_cast<long long>(pages.size());
+        target.blocksSkipped += static_cast<long long>(pages.size() - targetPages.size());
+        for (int pageId : targetPages) {
+            scanPage(pageId, target, visitor);
+        }
+    }
+
+public:
+    PagedRecordStore(const string& filePath, const vector<Field>& schema, size_t poolPages)
+        : fields(schema), nullBitmapBytes((schema.size() + 7) / 8), pool(filePath, poolPages), liveRecords(0) {}
+
+    void append(RowId rowId, const map<string, Value>& record) override {
+        string payload;
+        serialize(record, payload);
+        size_t needed = SLOT_HEADER_SIZE + payload.size();
+        if (needed > BufferPool::PAGE_SIZE - HEADER_SIZE) {
+            throw runtime_error("记录序列化后超过单页容量");
+        }
+
+        int pageId = findPageWithSpace(needed);
+        char* page = nullptr;
+        if (pageId < 0) {
+            page = pool.allocatePage(pageId);
+            writeU16(page, 0);
+            writeU16(page + 2, static_cast<uint16_t>(HEADER_SIZE));
+            pages.push_back(PageMeta());
+        } else {
+            page = pool.pin(pageId);
+        }
+
+        PageMeta& meta = pages[pageId];
+        char* slotPtr = page + meta.usedBytes;
+        writeU16(slotPtr, static_cast<uint16_t>(payload.size()));
+        slotPtr[2] = 1;
+        memcpy(slotPtr + 3, &rowId, sizeof(rowId));
+        memcpy(slotPtr + SLOT_HEADER_SIZE, payload.data(), payload.size());
+        meta.usedBytes += static_cast<int>(needed);
+        meta.liveCount++;
+        writeU16(page, static_cast<uint16_t>(readU16(page) + 1));
+        writeU16(page + 2, static_cast<uint16_t>(meta.usedBytes));
+        updateZoneMap(meta, record);
+        pool.unpin(pageId, true);
+        liveRecords++;
+        rowPages[rowId] = pageId;
+    }
+
+    vector<RecordNode*> select(const RecordPredicate& predicate, const Condition* hint,
+                               QueryProfile& profile) override {
+        materialized.clear();
+        vector<RecordNode*> result;
+        scanPages(hint, profile, [&](char*, RowId rowId, const map<string, Value>& record, PageMeta&) {
+            materialized.emplace_back(new RecordNode());
+            materialized.back()->data = record;
+            materialized.back()->rowId = rowId;
+            result.push_back(materialized.back().get());
+            return false;
+        }, &predicate);
+        profile.rowsMatched += result.size();
+        return result;
+    }
+
+    int removeIf(const RecordPredicate& predicate, const Condition* hint, QueryProfile& profile,
+                 const RecordVisitor& onRemoved) override {
+        materialized.clear();
+        int removedCount = 0;
+        scanPages(hint, profile, [&](char* slotPtr, RowId rowId, const map<string, Value>& record, PageMeta& meta) {
+            onRemoved(rowId, record);
+            markDead(slotPtr, meta);
+            rowPages.erase(rowId);
+            removedCount++;
+            return true;
+        }, &predicate);
+        liveRecords -= removedCount;
+        profile.rowsMatched += removedCount;
+        return removedCount;
+    }
+
+    // 按行号删除：只访问这些行所在的页，把同一页上的行一次处理完
+    int removeRows(const vector<RowId>& rowIds, const RecordVisitor& onRemoved) override {
+        materialized.clear();
+        unordered_set<RowId> targets(rowIds.begin(), rowIds.end());
+        int removedCount = 0;
+        scanRowPages(rowIds, [&](char* slotPtr, RowId rowId, const map<string, Value>& record, PageMeta& meta) {
+            if (targets.count(rowId) == 0) {
+                return false;
+            }
+            onRemoved(rowId, record);
+            markDead(slotPtr, meta);
+            rowPages.erase(rowId);
+            removedCount++;
+            return true;
+        });
+        liveRecords -= removedCount;
+        return removedCount;
+    }
+
+    bool replaceRow(RowId rowId, const map<string, Value>& record) override {
+        int removed = removeRows(vector<RowId>(1, rowId), [](RowId, const map<string, Value>&) {});
+        if (removed == 0) {
+            return false;
+        }
+        append(rowId, record);
+        return true;
+    }
+
+    bool fetchRow(RowId rowId, map<string, Value>& out) override {
+        bool found = false;
+        scanRowPages(vector<RowId>(1, rowId), [&](char*, RowId id, const map<string, Value>& record, PageMeta&) {
+            if (id == rowId) {
+                out = record;
+                found = true;
+            }
+            return false;
+        });
+        return found;
+    }
+
+    vector<RecordNode*> selectRows(const vector<RowId>& rowIds, const RecordPredicate& predicate,
+                                   QueryProfile& profile) override {
+        materialized.clear();
+        unordered_set<RowId> targets(rowIds.begin(), rowIds.end());
+        vector<RecordNode*> result;
+        scanRowPages(rowIds, [&](char*, RowId rowId, const map<string, Value>& record, PageMeta&) {
+            if (targets.count(rowId) != 0 && predicate(record)) {
+                materialized.emplace_back(new RecordNode());
+                materialized.back()->data = record;
+                materialized.back()->rowId = rowId;
+                result.push_back(materialized.back().get());
+            }
+            return false;
+        }, &profile);
+        profile.rowsMatched += result.size();
+        return result;
+    }
+
+    // 取一行要反序列化它所在的整页
+    double fetchCost() const override {
+        size_t usedPages = max<size_t>(1, pages.size());
+        return max(1.0, static_cast<double>(liveRecords) / static_cast<double>(usedPages));
+    }
+
+    // 更新后的记录长度可能变化：旧槽位置为无效，新版本在扫描结束后重新追加（优先填入整理出的空闲页）
+    int updateIf(const RecordPredicate& predicate, const function<bool(RowId, map<string, Value>&)>& apply,
+                 QueryProfile& profile, int& failedCount) override {
+        materialized.clear();
+        failedCount = 0;
+        vector<pair<RowId, map<string, Value>>> updated;
+        scanPages(nullptr, profile, [&](char* slotPtr, RowId rowId, const map<string, Value>& record, PageMeta& meta) {
+            map<string, Value> copy = record;
+            if (!apply(rowId, copy)) {
+                failedCount++;
+                return false;
+            }
+            markDead(slotPtr, meta);
+            updated.emplace_back(rowId, copy);
+            return true;
+        }, &predicate);
+        liveRecords -= updated.size();
+        for (const auto& entry : updated) {
+            append(entry.first, entry.second);
+        }
+        profile.rowsMatched += updated.size() + failedCount;
+        return static_cast<int>(updated.size());
+    }
+
+    void forEach(const RecordVisitor& visitor) override {
+        QueryProfile ignored;
+        scanPages(nullptr, ignored, [&](char*, RowId rowId, const map<string, Value>& record, PageMeta&) {
+            visitor(rowId, record);
+            return false;
+        });
+    }
+
+    QueryProfile plan(const Condition* hint) const override {
+        QueryProfile estimate;
+        int fieldIndex = zoneMapFieldIndex(hint);
+        estimate.accessPath = fieldIndex >= 0 ? ACCESS_ZONE_MAP : ACCESS_FULL_SCAN;
+        estimate.blocksTotal = pages.size();
+        for (const auto& meta : pages) {
+            if (meta.liveCount == 0 || (hint != nullptr && canSkip(meta, fieldIndex, *hint))) {
+                estimate.blocksSkipped++;
+            } else {
+                estimate.rowsScanned += meta.liveCount;
+                estimate.bytesTouched += BufferPool::PAGE_SIZE;
+            }
+        }
+        return estimate;
+    }
+
+    long long dataBytes() const override {
+        return static_cast<long long>(pages.size()) * BufferPool::PAGE_SIZE;
+    }
+
+    long long residentBytes() const override {
+        long long metaBytes = static_cast<long long>(pages.size())
+                              * (sizeof(PageMeta) + fields.size() * (2 * sizeof(Value) + 1));
+        return static_cast<long long>(pool.getFrameCount() * BufferPool::PAGE_SIZE) + metaBytes;
+    }
+
+    long long indexBytes() const override {
+        return DatabaseUtils::hashMapBytes(rowPages);
+    }
+
+    string describe() const override {
+        ostringstream oss;
+        oss << "分页文件 (" << pages.size() << " 页, 缓冲池 " << pool.getFrameCount() << " 页, 读入 "
+            << pool.getPagesRead() << " 页, 写回 " << pool.getPagesWritten() << " 页)";
+        return oss.str();
+    }
+};
+
+// 分片工作线程：独占一个内存存储，按提交顺序串行执行任务
+// 任务队列有上限，写入过快时提交方阻塞，避免队列无限增长
+class ShardWorker {
+private:
+    static const size_t MAX_PENDING = 4096;
+
+    MemoryRecordStore store;
+    thread worker;
+    mutex queueMutex;
+    condition_variable taskReady;
+    condition_variable stateChanged;  // 队列有空位或变为空闲时通知
+    deque<function<void(MemoryRecordStore&)>> tasks;
+    bool busy;
+    bool stopping;
+    exception_ptr failure;  // 最早一个抛出异常的任务，由下一次 drain 在调用线程中重新抛出
+
+    void run() {
+        while (true) {
+            function<void(MemoryRecordStore&)> task;
+            {
+                unique_lock<mutex> lock(queueMutex);
+                taskReady.wait(lock, [this] { return stopping || !tasks.empty(); });
+                if (tasks.empty()) {
+                    return;
+                }
+                task = std::move(tasks.front());
+                tasks.pop_front();
+                busy = true;
+            }
+            stateChanged.notify_all();
+            exception_ptr error;
+            try {
+                task(store);
+            } catch (...) {
+                error = current_exception();
+            }
+            {
+                lock_guard<mutex> lock(queueMutex);
+                busy = false;
+                if (error && !failure) {
+                    failure = error;
+                }
+            }
+            stateChanged.notify_all();
+        }
+    }
+
+public:
+    ShardWorker() : busy(false), stopping(false) {
+        worker = thread([this] { run(); });
+    }
+
+    ~ShardWorker() {
+        {
+            lock_guard<mutex> lock(queueMutex);
+            stopping = true;
+        }
+        taskReady.notify_all();
+        worker.join();
+    }
+
+    ShardWorker(const ShardWorker&) = delete;
+    ShardWorker& operator=(const ShardWorker&) = delete;
+
+    void post(function<void(MemoryRecordStore&)> task) {
+        {
+            unique_lock<mutex> lock(queueMutex);
+            stateChanged.wait(lock, [this] { return tasks.size() < MAX_PENDING; });
+            tasks.push_back(std::move(task));
+        }
+        taskReady.notify_one();
+    }
+
+    // 等待已提交的任务全部完成；返回后调用方可以直接访问 store，直到下一次 post
+    // 期间有任务抛出异常时在这里重新抛出（只抛一次）
+    MemoryRecordStore& drain() {
+        unique_lock<mutex> lock(queueMutex);
+        stateChanged.wait(lock, [this] { return tasks.empty() && !busy; });
+        if (failure) {
+            exception_ptr error = failure;
+            failure = nullptr;
+            rethrow_exception(error);
+        }
+        return store;
+    }
+};
+
+// 哈希分片存储：按分片键的哈希值把记录分配到各分片
+// 插入异步投递给所属分片；分片键上的等值查询只访问一个分片；扫描与聚合并行下发后按分片顺序合并
+// 删除/更新的回调统一在调用线程中执行，监听器无需考虑线程安全
+class ShardedRecordStore : public RecordStore {
+private:
+    string keyField;
+    vector<unique_ptr<ShardWorker>> shards;
+    // 在调用线程里维护的记录字节数与行数，查询内存占用时不必等待各分片空闲
+    long long bytes;
+    long long rowCount;
+
+    static size_t hashValue(const Value& v) {
+        if (v.isNull) {
+            return 0;
+        }
+        switch (v.type) {
+            case FIELD_INT: return hash<long long>()(v.intVal);
+            case FIELD_INT64:
+            case FIELD_TIMESTAMP: return hash<long long>()(v.int64Val);
+            case FIELD_BOOL: return v.boolVal ? 1 : 0;
+            case FIELD_STRING: return hash<string>()(v.strVal.str());  // 按内容分片，与驻留 id 的分配顺序无关
+            default: return 0;
+        }
+    }
+
+    size_t shardOf(const map<string, Value>& record) const {
+        auto it = record.find(keyField);
+        return it == record.end() ? 0 : hashValue(it->second) % shards.size();
+    }
+
+    // 分片键上的等值条件只需访问一个分片，返回 -1 表示需要访问全部分片
+    int targetShard(const Condition* hint) const {
+        if (hint == nullptr || hint->op != EQUAL || hint->fieldName != keyField || hint->value.isNull) {
+            return -1;
+        }
+        return static_cast<int>(hashValue(hint->value) % shards.size());
+    }
+
+    // 把 task 下发到目标分片（target < 0 时为全部分片）并等待完成，每个分片的结果写入 results[i]
+    template <typename Result>
+    vector<Result> fanOut(int target, const function<Result(MemoryRecordStore&)>& task) {
+        vector<Result> results(shards.size());
+        for (size_t i = 0; i < shards.size(); i++) {
+            if (target >= 0 && static_cast<size_t>(target) != i) {
+                continue;
+            }
+            Result* slot = &results[i];
+            shards[i]->post([slot, task](MemoryRecordStore& store) { *slot = task(store); });
+        }
+        exception_ptr error = drainAll();
+        if (error) {
+            rethrow_exception(error);
+        }
+        return results;
+    }
+
+    // 等待所有分片空闲后才返回（任务可能还引用着调用方栈上的结果），返回第一个失败任务的异常
+    exception_ptr drainAll() {
+        exception_ptr error;
+        for (auto& shard : shards) {
+            try {
+                shard->drain();
+            } catch (...) {
+                if (!error) {
+                    error = current_exception();
+                }
+            }
+        }
+        return error;
+    }
+
+    // 合并各分片的扫描统计
+    static void mergeProfile(QueryProfile& profile, const QueryProfile& part) {
+        profile.rowsScanned += part.rowsScanned;
+        profile.rowsMatched += part.rowsMatched;
+        profile.bytesTouched += part.bytesTouched;
+    }
+
+public:
+    ShardedRecordStore(const string& key, size_t shardCount) : keyField(key), bytes(0), rowCount(0) {
+        for (size_t i = 0; i < max<size_t>(shardCount, 1); i++) {
+            shards.emplace_back(new ShardWorker());
+        }
+    }
+
+    void append(RowId rowId, const map<string, Value>& record) override {
+        bytes += DatabaseUtils::estimateRecordBytes(record);
+        rowCount++;
+        shards[shardOf(record)]->post([rowId, record](MemoryRecordStore& store) { store.append(rowId, record); });
+    }
+
+    // 先按分片分组，每个分片只下发一个任务；等各分片写完再返回，任一分片失败时抛出异常，
+    // 由调用方按行号撤销已写入的行
+    void appendBatch(RowId firstRowId, const vector<map<string, Value>>& records) override {
+        typedef vector<pair<RowId, map<string, Value>>> Group;
+        vector<Group> groups(shards.size());
+        for (size_t i = 0; i < records.size(); i++) {
+            groups[shardOf(records[i])].emplace_back(firstRowId + i, records[i]);
+        }
+        // 各分片实际写入的字节数与行数，drain 之后在调用线程中读取
+        vector<pair<long long, long long>> written(shards.size());
+        for (size_t i = 0; i < shards.size(); i++) {
+            if (groups[i].empty()) {
+                continue;
+            }
+            auto group = make_shared<Group>(std::move(groups[i]));
+            pair<long long, long long>* slot = &written[i];
+            shards[i]->post([group, slot](MemoryRecordStore& store) {
+                for (const auto& row : *group) {
+                    store.append(row.first, row.second);
+                    slot->first += DatabaseUtils::estimateRecordBytes(row.second);
+                    slot->second++;
+                }
+            });
+        }
+        exception_ptr error = drainAll();
+        for (const auto& part : written) {
+            bytes += part.first;
+            rowCount += part.second;
+        }
+        if (error) {
+            rethrow_exception(error);
+        }
+    }
+
+    vector<RecordNode*> select(const RecordPredicate& predicate, const Condition* hint,
+                               QueryProfile& profile) override {
+        int target = targetShard(hint);
+        typedef pair<vector<RecordNode*>, QueryProfile> Part;
+        vector<Part> parts = fanOut<Part>(target, [&predicate, hint](MemoryRecordStore& store) {
+            Part part;
+            part.first = store.select(predicate, hint, part.second);
+            return part;
+        });
+        vector<RecordNode*> result;
+        for (const auto& part : parts) {
+            result.insert(result.end(), part.first.begin(), part.first.end());
+            mergeProfile(profile, part.second);
+        }
+        profile.accessPath = target >= 0 ? ACCESS_SHARD_POINT : ACCESS_FULL_SCAN;
+        profile.blocksTotal += shards.size();
+        profile.blocksSkipped += target >= 0 ? shards.size() - 1 : 0;
+        return result;
+    }
+
+    int removeIf(const RecordPredicate& predicate, const Condition* hint, QueryProfile& profile,
+                 const RecordVisitor& onRemoved) override {
+        int target = targetShard(hint);
+        typedef pair<vector<pair<RowId, map<string, Value>>>, QueryProfile> Part;
+        vector<Part> parts = fanOut<Part>(target, [&predicate, hint](MemoryRecordStore& store) {
+            Part part;
+            store.removeIf(predicate, hint, part.second, [&part](RowId rowId, const map<string, Value>& data) {
+                part.first.emplace_back(rowId, data);
+            });
+            return part;
+        });
+        int removedCount = 0;
+        for (const auto& part : parts) {
+            for (const auto& removed : part.first) {
+                bytes -= DatabaseUtils::estimateRecordBytes(removed.second);
+                rowCount--;
+                onRemoved(removed.first, removed.second);
+            }
+            removedCount += static_cast<int>(part.first.size());
+            mergeProfile(profile, part.second);
+        }
+        profile.accessPath = target >= 0 ? ACCESS_SHARD_POINT : ACCESS_FULL_SCAN;
+        profile.blocksTotal += shards.size();
+        profile.blocksSkipped += target >= 0 ? shards.size() - 1 : 0;
+        return removedCount;
+    }
+
+    int removeRows(const vector<RowId>& rowIds, const RecordVisitor& onRemoved) override {
+        int removedCount = 0;
+        for (auto& shard : shards) {
+            removedCount += shard->drain().removeRows(rowIds, [&](RowId rowId, const map<string, Value>& data) {
+                bytes -= DatabaseUtils::estimateRecordBytes(data);
+                rowCount--;
+                onRemoved(rowId, data);
+            });
+        }
+        return removedCount;
+    }
+
+    bool replaceRow(RowId rowId, const map<string, Value>& record) override {
+        // 分片键可能被修改：先从原分片移除，再按新键值放入对应分片
+        bool found = false;
+        for (auto& shard : shards) {
+            found = shard->drain().removeRows(vector<RowId>(1, rowId), [this](RowId, const map<string, Value>& old) {
+                bytes -= DatabaseUtils::estimateRecordBytes(old);
+            }) > 0 || found;
+        }
+        if (found) {
+            bytes += DatabaseUtils::estimateRecordBytes(record);
+            shards[shardOf(record)]->drain().append(rowId, record);
+        }
+        return found;
+    }
+
+    bool fetchRow(RowId rowId, map<string, Value>& out) override {
+        for (auto& shard : shards) {
+            if (shard->drain().fetchRow(rowId, out)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // 行号不携带分片信息，逐个分片按行号查找
+    vector<RecordNode*> selectRows(const vector<RowId>& rowIds, const RecordPredicate& predicate,
+                                   QueryProfile& profile) override {
+        vector<RecordNode*> result;
+        for (auto& shard : shards) {
+            vector<RecordNode*> part = shard->drain().selectRows(rowIds, predicate, profile);
+            result.insert(result.end(), part.begin(), part.end());
+        }
+        profile.blocksTotal += shards.size();
+        return result;
+    }
+
+    // 未命中的分片只多一次哈希查找
+    double fetchCost() const override {
+        return RecordStore::fetchCost() + 0.5 * static_cast<double>(shards.size() - 1);
+    }
+
+    // 更新很少见：等待各分片空闲后在调用线程中逐个分片执行，修改了分片键的记录迁移到新分片
+    int updateIf(const RecordPredicate& predicate, const function<bool(RowId, map<string, Value>&)>& apply,
+                 QueryProfile& profile, int& failedCount) override {
+        int updatedCount = 0;
+        failedCount = 0;
+        vector<pair<RowId, map<string, Value>>> moved;
+        for (size_t i = 0; i < shards.size(); i++) {
+            MemoryRecordStore& store = shards[i]->drain();
+            int failed = 0;
+            updatedCount += store.updateIf(predicate, [&](RowId rowId, map<string, Value>& data) {
+                long long before = DatabaseUtils::estimateRecordBytes(data);
+                if (!apply(rowId, data)) {
+                    return false;
+                }
+                bytes += DatabaseUtils::estimateRecordBytes(data) - before;
+                if (shardOf(data) != i) {
+                    moved.emplace_back(rowId, data);
+                }
+                return true;
+            }, profile, failed);
+            failedCount += failed;
+        }
+        for (const auto& entry : moved) {
+            replaceRow(entry.first, entry.second);
+        }
+        profile.accessPath = ACCESS_FULL_SCAN;
+        return updatedCount;
+    }
+
+    void forEach(const RecordVisitor& visitor) override {
+        for (auto& shard : shards) {
+            shard->drain().forEach(visitor);
+        }
+    }
+
+    AggregateState aggregate(const RecordPredicate& predicate, const Condition* hint,
+                             const string& fieldName, QueryProfile& profile) override {
+        int target = targetShard(hint);
+        typedef pair<AggregateState, QueryProfile> Part;
+        vector<Part> parts = fanOut<Part>(target, [&predicate, hint, &fieldName](MemoryRecordStore& store) {
+            Part part;
+            for (RecordNode* node : store.select(predicate, hint, part.second)) {
+                part.first.addRecord(node->data, fieldName);
+            }
+            return part;
+        });
+        AggregateState state;
+        for (const auto& part : parts) {
+            state.merge(part.first);
+            mergeProfile(profile, part.second);
+        }
+        profile.accessPath = target >= 0 ? ACCESS_SHARD_POINT : ACCESS_FULL_SCAN;
+        profile.blocksTotal += shards.size();
+        profile.blocksSkipped += target >= 0 ? shards.size() - 1 : 0;
+        return state;
+    }
+
+    QueryProfile plan(const Condition* hint) const override {
+        QueryProfile estimate;
+        int target = targetShard(hint);
+        estimate.accessPath = target >= 0 ? ACCESS_SHARD_POINT : ACCESS_FULL_SCAN;
+        estimate.blocksTotal = shards.size();
+        for (size_t i = 0; i < shards.size(); i++) {
+            if (target >= 0 && static_cast<size_t>(target) != i) {
+                estimate.blocksSkipped++;
+                continue;
+            }
+            QueryProfile part = shards[i]->drain().plan(hint);
+            estimate.rowsScanned += part.rowsScanned;
+            estimate.bytesTouched += part.bytesTouched;
+        }
+        return estimate;
+    }
+
+    long long dataBytes() const override {
+        return bytes;
+    }
+
+    // 按行数估算各分片行号索引的总占用（每行一个节点，装载因子不超过 1 时每行至多一个桶）
+    long long indexBytes() const override {
+        return rowCount * static_cast<long long>(sizeof(pair<const RowId, RecordNode*>) + 3 * sizeof(void*));
+    }
+
+    string describe() const override {
+        ostringstream oss;
+        oss << "哈希分片 (键 " << keyField << ", " << shards.size() << " 个分片, 各分片记录数";
+        for (size_t i = 0; i < shards.size(); i++) {
+            oss << (i == 0 ? " " : "/") << shards[i]->drain().plan(nullptr).rowsScanned;
+        }
+        oss << ")";
+        return oss.str();
+    }
+};
+
+// 数据变更监听接口：记录成功写入存储后回调（复制日志等使用）
+class ChangeListener {
+public:
+    virtual ~ChangeListener() {}
+    virtual void onInsert(const string& dbName, RowId rowId, const map<string, Value>& record) = 0;
+    virtual void onDelete(const string& dbName, RowId rowId, const map<string, Value>& record) = 0;
+    virtual void onUpdate(const string& dbName, RowId rowId, const map<string, Value>& before,
+                          const map<string, Value>& after) = 0;
+    // 一批变更（如一个事务）的开始与结束，其间的回调属于同一批
+    virtual void onBatchBegin(const string&) {}
+    virtual void onBatchEnd(const string&) {}
+};
+
+// ==================== 列摘要 ====================
+
+// HyperLogLog 基数估计：2^12 个寄存器，标准误差约 1.6%，占用 4 KB
+class HyperLogLog {
+private:
+    static const int PRECISION = 12;
+    static const size_t REGISTER_COUNT = size_t(1) << PRECISION;
+
+    vector<uint8_t> registers;
+
+public:
+    HyperLogLog() : registers(REGISTER_COUNT, 0) {}
+
+    void add(uint64_t hash) {
+        size_t index = static_cast<size_t>(hash >> (64 - PRECISION));
+        uint64_t rest = hash << PRECISION;
+        uint8_t rank = 1;
+        while (rank <= 64 - PRECISION && (rest & (uint64_t(1) << 63)) == 0) {
+            rest <<= 1;
+            rank++;
+        }
+        registers[index] = max(registers[index], rank);
+    }
+
+    double estimate() const {
+        double m = static_cast<double>(REGISTER_COUNT);
+        double sum = 0.0;
+        size_t zeros = 0;
+        for (uint8_t r : registers) {
+            sum += ldexp(1.0, -r);
+            zeros += (r == 0);
+        }
+        double raw = (0.7213 / (1.0 + 1.079 / m)) * m * m / sum;
+        // 小基数时改用线性计数，偏差更小
+        if (raw <= 2.5 * m && zeros > 0) {
+            return m * log(m / static_cast<double>(zeros));
+        }
+        return raw;
+    }
+
+    long long memoryBytes() const {
+        return static_cast<long long>(registers.size());
+    }
+};
+
+// KLL 分位数摘要：每层是一个压缩器，满了就排序后隔一个取一个提升到上一层（权重翻倍）
+// 高层容量为 K，越往下按 2/3 递减，总大小与已插入的值个数无关
+class KllSketch {
+private:
+    static const size_t K = 200;
+    static const size_t MIN_CAPACITY = 8;
+
+    vector<vector<double>> levels;
+    long long count;
+    uint64_t coin;  // 决定压缩时保留奇数位还是偶数位
+
+    size_t capacity(size_t level) const {
+        size_t depth = levels.size() - 1 - level;
+        return max(static_cast<size_t>(MIN_CAPACITY), static_cast<size_t>(K * pow(2.0 / 3.0, static_cast<double>(depth))));
+    }
+
+    void compress() {
+        for (size_t level = 0; level < levels.size(); level++) {
+            if (levels[level].size() < capacity(level)) {
+                continue;
+            }
+            if (level + 1 == levels.size()) {
+                levels.emplace_back();
+            }
+            vector<double>& items = levels[level];
+            sort(items.begin(), items.end());
+            // 奇数个时留下最大的一个在本层，其余两两合并
+            double leftover = 0.0;
+            bool hasLeftover = items.size() % 2 == 1;
+            if (hasLeftover) {
+                leftover = items.back();
+                items.pop_back();
+            }
+            coin = coin * 6364136223846793005ULL + 1442695040888963407ULL;
+            size_t offset = static_cast<size_t>(coin >> 63);
+            for (size_t i = offset; i < items.size(); i += 2) {
+                levels[level + 1].push_back(items[i]);
+            }
+            items.clear();
+            if (hasLeftover) {
+                items.push_back(leftover);
+            }
+        }
+    }
+
+public:
+    KllSketch() : levels(1), count(0), coin(0x9E3779B97F4A7C15ULL) {}
+
+    void add(double v) {
+        levels[0].push_back(v);
+        count++;
+        if (levels[0].size() >= capacity(0)) {
+            compress();
+        }
+    }
+
+    long long size() const {
+        return count;
+    }
+
+    // q 取 [0, 1]；没有值时返回 false
+    bool quantile(double q, double& out) const {
+        vector<pair<double, long long>> weighted;
+        long long totalWeight = 0;
+        for (size_t level = 0; level < levels.size(); level++) {
+            long long weight = 1LL << level;
+            for (double v : levels[level]) {
+                weighted.emplace_back(v, weight);
+                totalWeight += weight;
+            }
+        }
+        if (weighted.empty()) {
+            return false;
+        }
+        sort(weighted.begin(), weighted.end());
+        double target = q * static_cast<double>(totalWeight);
+        long long cumulative = 0;
+        for (const auto& item : weighted) {
+            cumulative += item.second;
+            if (static_cast<double>(cumulative) >= target) {
+                out = item.first;
+                return true;
+            }
+        }
+        out = weighted.back().first;
+        return true;
+    }
+
+    long long memoryBytes() const {
+        long long bytes = 0;
+        for (const auto& level : levels) {
+            bytes += static_cast<long long>(level.capacity() * sizeof(double));
+        }
+        return bytes;
+    }
+};
+
+// 每列的基数与分位数摘要，随插入与更新增量维护，查询代价与记录数无关
+// 摘要不支持撤销：删除或被更新覆盖的旧值仍计入统计
+class ColumnSketches : public ChangeListener {
+private:
+    struct ColumnSketch {
+        HyperLogLog distinct;
+        KllSketch quantiles;  // 仅数值与时间戳列使用
+    };
+
+    vector<Field> fields;
+    vector<ColumnSketch> columns;
+
+    static uint64_t mix(uint64_t x) {
+        x += 0x9E3779B97F4A7C15ULL;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+        return x ^ (x >> 31);
+    }
+
+    static uint64_t hashValue(const Value& v) {
+        switch (v.type) {
+            case FIELD_INT: return mix(static_cast<uint64_t>(static_cast<long long>(v.intVal)));
+            case FIELD_INT64:
+            case FIELD_TIMESTAMP: return mix(static_cast<uint64_t>(v.int64Val));
+            case FIELD_BOOL: return mix(v.boolVal ? 1 : 0);
+            case FIELD_DOUBLE: {
+                double d = v.doubleVal == 0.0 ? 0.0 : v.doubleVal;  // +0 与 -0 视为同一个值
+                uint64_t bits;
+                memcpy(&bits, &d, sizeof(bits));
+                return mix(bits);
+            }
+            case FIELD_STRING: return mix(hash<string>()(v.strVal.str()));  // 按内容，驻留与不驻留的值一致
+            default: return 0;
+        }
+    }
+
+    void addRecord(const map<string, Value>& record) {
+        for (size_t i = 0; i < fields.size(); i++) {
+            auto it = record.find(fields[i].name);
+            if (it == record.end() || it->second.isNull) {
+                continue;
+            }
+            columns[i].distinct.add(hashValue(it->second));
+            if (supportsQuantile(fields[i].type)) {
+                columns[i].quantiles.add(DatabaseUtils::numericValue(it->second));
+            }
+        }
+    }
+
+public:
+    explicit ColumnSketches(const vector<Field>& schema) : fields(schema), columns(schema.size()) {}
+
+    static bool supportsQuantile(FieldType type) {
+        return type == FIELD_INT || type == FIELD_INT64 || type == FIELD_TIMESTAMP || type == FIELD_DOUBLE;
+    }
+
+    void onInsert(const string&, RowId, const map<string, Value>& record) override {
+        addRecord(record);
+    }
+
+    void onDelete(const string&, RowId, const map<string, Value>&) override {}
+
+    void onUpdate(const string&, RowId, const map<string, Value>&, const map<string, Value>& after) override {
+        addRecord(after);
+    }
+
+    // 字段不存在时返回 -1
+    int fieldIndex(const string& fieldName) const {
+        for (size_t i = 0; i < fields.size(); i++) {
+            if (fields[i].name == fieldName) {
+                return static_cast<int>(i);
+            }
+        }
+        return -1;
+    }
+
+    double approxCountDistinct(size_t index) const {
+        return columns[index].distinct.estimate();
+    }
+
+    // 返回与字段同类型的近似分位数，没有值时返回 NULL
+    Value approxQuantile(size_t index, double q) const {
+        double v = 0.0;
+        FieldType type = fields[index].type;
+        if (!columns[index].quantiles.quantile(q, v)) {
+            return DatabaseUtils::makeNullValue(type);
+        }
+        switch (type) {
+            case FIELD_INT: return DatabaseUtils::makeIntValue(static_cast<int>(llround(v)));
+            case FIELD_INT64: return DatabaseUtils::makeInt64Value(llround(v));
+            case FIELD_TIMESTAMP: return DatabaseUtils::makeTimestampValue(llround(v));
+            default: return DatabaseUtils::makeDoubleValue(v);
+        }
+    }
+
+    long long memoryBytes() const {
+        long long bytes = 0;
+        for (const auto& column : columns) {
+            bytes += column.distinct.memoryBytes() + column.quantiles.memoryBytes();
+        }
+        return bytes;
+    }
+};
+
+// TTL 到期索引：按到期时间（时间戳字段 + TTL）把行号分桶，桶宽为 TTL 的 1/64（至少 1 秒）
+// 整桶到期后一次取出交给存储层按行号删除，代价只与到期的行数有关，与表大小无关
+// 记录最多比到期时间晚一个桶宽被删除
+class TtlIndex : public ChangeListener {
+private:
+    static const long long BUCKETS_PER_TTL = 64;
+
+    string fieldName;
+    long long ttlSeconds;
+    long long bucketWidth;
+    map<long long, vector<RowId>> buckets;     // 桶起点 -> 行号（可能含已删除或已改期的行）
+    unordered_map<RowId, long long> rowBucket;  // 行号 -> 当前所在的桶，用于识别过期的桶内条目
+
+    long long bucketOf(long long expiry) const {
+        long long q = expiry / bucketWidth;
+        if (expiry % bucketWidth != 0 && expiry < 0) {
+            q--;
+        }
+        return q * bucketWidth;
+    }
+
+    void track(RowId rowId, const map<string, Value>& record) {
+        auto it = record.find(fieldName);
+        if (it == record.end() || it->second.isNull) {
+            rowBucket.erase(rowId);
+            return;
+        }
+        long long bucket = bucketOf(it->second.int64Val + ttlSeconds);
+        auto current = rowBucket.find(rowId);
+        if (current != rowBucket.end() && current->second == bucket) {
+            return;
+        }
+        rowBucket[rowId] = bucket;
+        buckets[bucket].push_back(rowId);
+    }
+
+public:
+    TtlIndex(const string& fieldName, long long ttlSeconds)
+        : fieldName(fieldName), ttlSeconds(ttlSeconds),
+          bucketWidth(max(1LL, ttlSeconds / BUCKETS_PER_TTL)) {}
+
+    void onInsert(const string&, RowId rowId, const map<string, Value>& record) override {
+        track(rowId, record);
+    }
+
+    void onDelete(const string&, RowId rowId, const map<string, Value>&) override {
+        rowBucket.erase(rowId);
+    }
+
+    void onUpdate(const string&, RowId rowId, const map<string, Value>&, const map<string, Value>& after) override {
+        track(rowId, after);
+    }
+
+    // 取出所有在 now 之前已整桶到期的行号
+    vector<RowId> takeDue(long long now) {
+        vector<RowId> due;
+        while (!buckets.empty() && buckets.begin()->first + bucketWidth <= now) {
+            long long bucket = buckets.begin()->first;
+            for (RowId rowId : buckets.begin()->second) {
+                auto it = rowBucket.find(rowId);
+                if (it != rowBucket.end() && it->second == bucket) {
+                    due.push_back(rowId);
+                    rowBucket.erase(it);
+                }
+            }
+            buckets.erase(buckets.begin());
+        }
+        return due;
+    }
+
+    const string& getFieldName() const {
+        return fieldName;
+    }
+
+    long long getTtlSeconds() const {
+        return ttlSeconds;
+    }
+
+    long long getBucketWidth() const {
+        return bucketWidth;
+    }
+
+    size_t trackedRows() const {
+        return rowBucket.size();
+    }
+
+    size_t bucketCount() const {
+        return buckets.size();
+    }
+
+    long long memoryBytes() const {
+        long long bytes = DatabaseUtils::hashMapBytes(rowBucket);
+        for (const auto& bucket : buckets) {
+            bytes += static_cast<long long>(bucket.second.capacity() * sizeof(RowId) + sizeof(bucket) + 4 * sizeof(void*));
+        }
+        return bytes;
+    }
+};
+
+// 记录每个数据库引用了字符串池中的哪些字符串（带引用计数），用于按库核算字符串在池中的占用
+// （内容加上池内的对象与索引开销）；多个库引用同一字符串时，各自都计入一份
+class StringReferences : public ChangeListener {
+private:
+    unordered_map<uint32_t, uint32_t> refCounts;  // 驻留 id -> 本库中引用它的值个数
+    long long textBytes;
+
+    void adjust(const map<string, Value>& record, int delta) {
+        for (const auto& entry : record) {
+            const Value& v = entry.second;
+            if (v.type != FIELD_STRING || v.isNull) {
+                continue;
+            }
+            uint32_t id = v.strVal.poolId();  // 分页存储读出的值不驻留，按内容换回插入时的 id
+            if (id == 0) {
+                continue;
+            }
+            if (delta > 0) {
+                if (refCounts[id]++ == 0) {
+                    textBytes += StringPool::entryBytes(v.strVal.str());
+                }
+                continue;
+            }
+            auto it = refCounts.find(id);
+            if (it != refCounts.end() && --it->second == 0) {
+                textBytes -= StringPool::entryBytes(v.strVal.str());
+                refCounts.erase(it);
+            }
+        }
+    }
+
+public:
+    StringReferences() : textBytes(0) {}
+
+    void onInsert(const string&, RowId, const map<string, Value>& record) override {
+        adjust(record, 1);
+    }
+
+    void onDelete(const string&, RowId, const map<string, Value>& record) override {
+        adjust(record, -1);
+    }
+
+    void onUpdate(const string&, RowId, const map<string, Value>& before, const map<string, Value>& after) override {
+        adjust(after, 1);
+        adjust(before, -1);
+    }
+
+    // 本库引用的不同字符串在池中的字节数
+    long long contentBytes() const {
+        return textBytes;
+    }
+
+    long long trackingBytes() const {
+        return DatabaseUtils::hashMapBytes(refCounts);
+    }
+};
+
+// ==================== 二级索引与代价优化 ====================
+
+// 单列有序二级索引：按 (值, 行号) 排序，支持等值与范围查找；NULL 不入索引
+class SecondaryIndex : public ChangeListener {
+private:
+    struct EntryLess {
+        bool operator()(const pair<Value, RowId>& a, const pair<Value, RowId>& b) const {
+            int cmp = DatabaseUtils::compareValues(a.first, b.first);
+            return cmp != 0 ? cmp < 0 : a.second < b.second;
+        }
+    };
+    typedef set<pair<Value, RowId>, EntryLess> EntrySet;
+
+    string fieldName;
+    FieldType fieldType;
+    EntrySet entries;
+
+    void add(RowId rowId, const map<string, Value>& record) {
+        auto it = record.find(fieldName);
+        if (it != record.end() && !it->second.isNull) {
+            entries.emplace(it->second, rowId);
+        }
+    }
+
+    void remove(RowId rowId, const map<string, Value>& record) {
+        auto it = record.find(fieldName);
+        if (it != record.end() && !it->second.isNull) {
+            entries.erase(make_pair(it->second, rowId));
+        }
+    }
+
+public:
+    SecondaryIndex(const string& field, FieldType type) : fieldName(field), fieldType(type) {}
+
+    void onInsert(const string&, RowId rowId, const map<string, Value>& record) override {
+        add(rowId, record);
+    }
+
+    void onDelete(const string&, RowId rowId, const map<string, Value>& record) override {
+        remove(rowId, record);
+    }
+
+    void onUpdate(const string&, RowId rowId, const map<string, Value>& before,
+                  const map<string, Value>& after) override {
+        remove(rowId, before);
+        add(rowId, after);
+    }
+
+    const string& getFieldName() const {
+        return fieldName;
+    }
+
+    // 只有与字段同类型的非 NULL 比较值、且运算符为等值或范围时才能走索引
+    bool supports(const Condition& condition) const {
+        if (condition.fieldName != fieldName || condition.value.isNull || condition.value.type != fieldType) {
+            return false;
+        }
+        switch (condition.op) {
+            case EQUAL: case GREATER: case LESS: case GREATER_EQUAL: case LESS_EQUAL: return true;
+            default: return false;
+        }
+    }
+
+    // 返回满足条件的行号（升序）；浮点等值按容差放宽成闭区间，结果可能多于精确匹配，由调用方复核
+    vector<RowId> lookup(const Condition& condition) const {
+        const Value& value = condition.value;
+        EntrySet::const_iterator first = entries.begin();
+        EntrySet::const_iterator last = entries.end();
+        auto lowest = [](const Value& v) { return make_pair(v, numeric_limits<RowId>::min()); };
+        auto highest = [](const Value& v) { return make_pair(v, numeric_limits<RowId>::max()); };
+        switch (condition.op) {
+            case EQUAL:
+                if (fieldType == FIELD_DOUBLE) {
+                    first = entries.lower_bound(lowest(DatabaseUtils::makeDoubleValue(value.doubleVal - 1e-9)));
+                    last = entries.upper_bound(highest(DatabaseUtils::makeDoubleValue(value.doubleVal + 1e-9)));
+                } else {
+                    first = entries.lower_bound(lowest(value));
+                    last = entries.upper_bound(highest(value));
+                }
+                break;
+            case GREATER: first = entries.upper_bound(highest(value)); break;
+            case GREATER_EQUAL: first = entries.lower_bound(lowest(value)); break;
+            case LESS: last = entries.lower_bound(lowest(value)); break;
+            case LESS_EQUAL: last = entries.upper_bound(highest(value)); break;
+            default: break;
+        }
+        vector<RowId> rowIds;
+        for (auto it = first; it != last; ++it) {
+            rowIds.push_back(it->second);
+        }
+        sort(rowIds.begin(), rowIds.end());
+        return rowIds;
+    }
+
+    size_t size() const {
+        return entries.size();
+    }
+
+    // 红黑树节点：三个指针 + 颜色 + 元素
+    long long memoryBytes() const {
+        return static_cast<long long>(entries.size() * (sizeof(pair<Value, RowId>) + 4 * sizeof(void*)));
+    }
+};
+
+// 单列统计：等深直方图、高频值、NULL 比例与不同值个数，由 analyze 对记录做蓄水池采样后构建
+class ColumnStatistics {
+public:
+    static const size_t BUCKETS = 32;
+    static const size_t MOST_COMMON = 8;
+
+    // 没有统计信息时使用的缺省选择率
+    static constexpr double DEFAULT_EQUAL = 0.005;
+    static constexpr double DEFAULT_RANGE = 1.0 / 3.0;
+    static constexpr double DEFAULT_CONTAINS = 0.1;
+
+    ColumnStatistics() : nullFraction(0.0), distinctCount(1.0), sampleRows(0) {}
+
+    // sample 为采样到的该列取值（含 NULL）；distinct 为全表不同值个数的估计
+    ColumnStatistics(vector<Value> sample, double distinct)
+        : nullFraction(0.0), distinctCount(max(1.0, distinct)), sampleRows(sample.size()) {
+        vector<Value> values;
+        for (Value& v : sample) {
+            if (!v.isNull) {
+                values.push_back(std::move(v));
+            }
+        }
+        if (sampleRows == 0) {
+            return;
+        }
+        nullFraction = 1.0 - static_cast<double>(values.size()) / static_cast<double>(sampleRows);
+        if (values.empty()) {
+            return;
+        }
+        sort(values.begin(), values.end(), ValueLess());
+
+        // 样本中出现不止一次的值按频率取前几个，其余值平分剩余的选择率
+        vector<pair<size_t, size_t>> runs;  // (出现次数, 起始下标)
+        for (size_t i = 0, j; i < values.size(); i = j) {
+            for (j = i + 1; j < values.size() && DatabaseUtils::compareValues(values[i], values[j]) == 0; j++) {}
+            if (j - i > 1) {
+                runs.emplace_back(j - i, i);
+            }
+        }
+        sort(runs.begin(), runs.end(), [](const pair<size_t, size_t>& a, const pair<size_t, size_t>& b) {
+            return a.first > b.first;
+        });
+        for (size_t k = 0; k < runs.size() && k < MOST_COMMON; k++) {
+            mostCommon.emplace_back(values[runs[k].second],
+                                    static_cast<double>(runs[k].first) / static_cast<double>(sampleRows));
+        }
+
+        size_t buckets = min(static_cast<size_t>(BUCKETS), values.size());
+        for (size_t b = 0; b <= buckets; b++) {
+            bounds.push_back(values[min(values.size() - 1, b * (values.size() - 1) / buckets)]);
+        }
+    }
+
+    bool empty() const {
+        return sampleRows == 0;
+    }
+
+    // 估计单个条件的选择率（满足条件的行占全表的比例）
+    double selectivity(const Condition& condition) const {
+        const Value& v = condition.value;
+        if (v.isNull) {
+            if (condition.op == EQUAL) return empty() ? DEFAULT_EQUAL : nullFraction;
+            if (condition.op == NOT_EQUAL) return empty() ? 1.0 - DEFAULT_EQUAL : 1.0 - nullFraction;
+            return 0.0;
+        }
+        double nonNull = 1.0 - nullFraction;
+        switch (condition.op) {
+            case EQUAL: return equalFraction(v);
+            case NOT_EQUAL: return clamp(nonNull - equalFraction(v));
+            case LESS: return clamp(belowFraction(v) * nonNull);
+            case LESS_EQUAL: return clamp(belowFraction(v) * nonNull + equalFraction(v));
+            case GREATER: return clamp(nonNull - belowFraction(v) * nonNull - equalFraction(v));
+            case GREATER_EQUAL: return clamp(nonNull - belowFraction(v) * nonNull);
+            case CONTAINS: return DEFAULT_CONTAINS * nonNull;
+            default: return 1.0;
+        }
+    }
+
+    double getNullFraction() const {
+        return nullFraction;
+    }
+
+    double getDistinctCount() const {
+        return distinctCount;
+    }
+
+    const vector<Value>& getBounds() const {
+        return bounds;
+    }
+
+    const vector<pair<Value, double>>& getMostCommon() const {
+        return mostCommon;
+    }
+
+private:
+    double nullFraction;
+    double distinctCount;
+    size_t sampleRows;
+    vector<Value> bounds;                     // 等深直方图的桶边界，桶数 = bounds.size() - 1
+    vector<pair<Value, double>> mostCommon;   // 高频值及其占全表的比例
+
+    static double clamp(double x) {
+        return min(1.0, max(0.0, x));
+    }
+
+    double equalFraction(const Value& v) const {
+        if (empty()) {
+            return DEFAULT_EQUAL;
+        }
+        double commonTotal = 0.0;
+        for (const auto& entry : mostCommon) {
+            if (DatabaseUtils::compareValues(entry.first, v) == 0) {
+                return entry.second;
+            }
+            commonTotal += entry.second;
+        }
+        double others = max(1.0, distinctCount - static_cast<double>(mostCommon.size()));
+        return clamp((1.0 - nullFraction - commonTotal) / others);
+    }
+
+    // 非 NULL 值中严格小于 v 的比例：定位所在的桶，数值类型在桶内线性插值
+    double belowFraction(const Value& v) const {
+        if (empty()) {
+            return DEFAULT_RANGE;
+        }
+        if (bounds.empty() || DatabaseUtils::compareValues(v, bounds.front()) <= 0) {
+            return 0.0;
+        }
+        if (DatabaseUtils::compareValues(v, bounds.back()) > 0) {
+            return 1.0;
+        }
+        size_t buckets = bounds.size() - 1;
+        size_t i = static_cast<size_t>(std::lower_bound(bounds.begin(), bounds.end(), v, ValueLess()) - bounds.begin()) - 1;
+        double within = 0.5;
+        if (v.type != FIELD_STRING) {
+            double low = DatabaseUtils::numericValue(bounds[i]);
+            double high = DatabaseUtils::numericValue(bounds[i + 1]);
+            within = high > low ? (DatabaseUtils::numericValue(v) - low) / (high - low) : 0.0;
+        }
+        return clamp((static_cast<double>(i) + within) / static_cast<double>(buckets));
+    }
+};
+
+// 优化器为一组 and 条件选定的访问路径
+struct PlanChoice {
+    AccessPath accessPath;     // ACCESS_INDEX 表示走索引，否则交给存储层扫描
+    vector<size_t> indexed;    // 走索引的条件下标，多于一个时对行号求交
+    double estimatedRows;      // 预计命中行数
+    double scanCost;           // 扫描方案的代价
+    double cost;               // 选定方案的代价
+    vector<double> selectivities;  // 各条件的选择率估计
+
+    PlanChoice() : accessPath(ACCESS_FULL_SCAN), estimatedRows(0.0), scanCost(0.0), cost(0.0) {}
+};
+
+// 代价模型：以顺序扫描一行为单位
+//   扫描 = 存储层预计扫描行数（已计入块裁剪与分片定位）
+//   索引 = 每个索引一次下探 + 访问的索引项 + 按行号取回的候选行 × 取行代价
+// 多个索引求交时各条件按独立估计，按选择率从低到高逐个加入，直到再加一个不再降低代价
+class AccessPathOptimizer {
+public:
+    static constexpr double INDEX_PROBE_COST = 10.0;
+    static constexpr double INDEX_ENTRY_COST = 0.2;
+
+    static PlanChoice choose(const vector<double>& selectivities, const vector<bool>& indexable, double rowCount,
+                             double scanRows, double fetchCost) {
+        PlanChoice choice;
+        choice.selectivities = selectivities;
+        double combined = 1.0;
+        for (double s : selectivities) {
+            combined *= s;
+        }
+        choice.estimatedRows = combined * rowCount;
+        choice.scanCost = scanRows;
+        choice.cost = scanRows;
+
+        vector<size_t> candidates;
+        for (size_t i = 0; i < selectivities.size(); i++) {
+            if (indexable[i]) {
+                candidates.push_back(i);
+            }
+        }
+        sort(candidates.begin(), candidates.end(), [&](size_t a, size_t b) {
+            return selectivities[a] < selectivities[b];
+        });
+
+        double entries = 0.0;
+        double fetched = rowCount;
+        double best = numeric_limits<double>::infinity();
+        size_t bestCount = 0;
+        for (size_t k = 0; k < candidates.size(); k++) {
+            entries += selectivities[candidates[k]] * rowCount;
+            fetched *= selectivities[candidates[k]];
+            double cost = INDEX_PROBE_COST * static_cast<double>(k + 1) + entries * INDEX_ENTRY_COST
+                          + fetched * fetchCost;
+            if (cost < best) {
+                best = cost;
+                bestCount = k + 1;
+            }
+        }
+        if (bestCount > 0 && best < choice.scanCost) {
+            choice.accessPath = ACCESS_INDEX;
+            choice.indexed.assign(candidates.begin(), candidates.begin() + bestCount);
+            choice.cost = best;
+        }
+        return choice;
+    }
+};
+
+// 单个数据库的内存占用（字节）
+struct MemoryUsage {
+    long long rows;      // 记录数据（分页存储为缓冲池与页元信息）
+    long long strings;   // 引用的字符串在字符串池中的占用
+    long long indexes;   // 行号索引、列摘要、TTL 桶等辅助结构
+
+    MemoryUsage() : rows(0), strings(0), indexes(0) {}
+
+    long long total() const {
+        return rows + strings + indexes;
+    }
+};
+
+//数据库
+
+class Database {
+private:
+    string name;
+    vector<Field> fields;  // 表结构，初始化后不可更改
+    StorageOptions storageOptions;
+    unique_ptr<RecordStore> store;  // 记录的实际存放位置
+    int recordCount;
+    RowId nextRowId;        // 下一条记录的行号
+    DatabaseStats stats;    // 累计执行统计
+    vector<ChangeListener*> listeners;  // 不拥有所有权
+    ColumnSketches sketches;            // 各列的近似统计，作为第一个监听器随变更维护
+    unique_ptr<TtlIndex> ttl;           // 未设置 TTL 时为空
+    StringReferences stringRefs;        // 本库引用的字符串，用于内存核算
+    map<string, unique_ptr<SecondaryIndex>> indexes;  // 字段名 -> 二级索引，作为监听器随变更维护
+    map<string, ColumnStatistics> columnStats;        // analyze 采样得到的列统计，未分析的列使用缺省选择率
+    long long analyzedRows;                           // 上次 analyze 时的记录数
+    long long softMemoryLimit;          // 超过时告警，0 表示不限制
+    long long hardMemoryLimit;          // 超过时拒绝写入，0 表示不限制
+    bool overSoftLimit;                 // 已经对超过软限制告警过
+    
+    // 验证记录是否符合表结构
+    bool validateRecord(const map<string, Value>& record) const {
+        // 检查记录字段数量是否匹配
+        if (record.size() != fields.size()) {
+            cout << "错误：记录字段数量不匹配。期望 " << fields.size() 
+                 << " 个字段，实际 " << record.size() << " 个字段" << endl;
+            return false;
+        }
+        
+        // 检查每个必需字段是否存在且类型正确
+        for (const auto& field : fields) {
+            auto it = record.find(field.name);
+            
+            // 检查字段是否存在
+            if (it == record.end()) {
+                cout << "错误：缺少必需字段 \"" << field.name << "\"" << endl;
+                return false;
+            }
+            
+            // 检查字段类型是否匹配
+            if (it->second.type != field.type) {
+                cout << "错误：字段 \"" << field.name << "\" 类型不匹配。期望 "
+                     << DatabaseUtils::fieldTypeName(field.type) << "，实际 "
+                     << DatabaseUtils::fieldTypeName(it->second.type) << endl;
+                return false;
+            }
+
+            // 检查 NULL 是否允许
+            if (it->second.isNull && !field.nullable) {
+                cout << "错误：字段 \"" << field.name << "\" 不允许为 NULL" << endl;
+                return false;
+            }
+        }
+        
+        // 字段数相同且每个表结构字段都在记录中，记录里就不可能再有未定义的字段，无需逐一比对
+        return true;
+    }
+
+    // 按列校验一批记录：先确认字段数，再逐列检查存在性、类型与 NULL，
+    // 出错时指出批内第几条记录
+    bool validateBatch(const vector<map<string, Value>>& records) const {
+        for (size_t i = 0; i < records.size(); i++) {
+            if (records[i].size() != fields.size()) {
+                cout << "错误：第 " << i + 1 << " 条记录字段数量不匹配。期望 " << fields.size()
+                     << " 个字段，实际 " << records[i].size() << " 个字段" << endl;
+                return false;
+            }
+        }
+        for (const auto& field : fields) {
+            for (size_t i = 0; i < records.size(); i++) {
+                auto it = records[i].find(field.name);
+                if (it == records[i].end()) {
+                    cout << "错误：第 " << i + 1 << " 条记录缺少字段 \"" << field.name << "\"" << endl;
+                    return false;
+                }
+                if (it->second.type != field.type) {
+                    cout << "错误：第 " << i + 1 << " 条记录的字段 \"" << field.name << "\" 类型不匹配。期望 "
+                         << DatabaseUtils::fieldTypeName(field.type) << "，实际 "
+                         << DatabaseUtils::fieldTypeName(it->second.type) << endl;
+                    return false;
+                }
+                if (it->second.isNull && !field.nullable) {
+                    cout << "错误：第 " << i + 1 << " 条记录的字段 \"" << field.name << "\" 不允许为 NULL" << endl;
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+    
+public:
+    // 构造函数：必须提供数据库名称和表结构定义
+    // quiet: 为 true 时不输出创建提示（复制回放使用）
+    Database(const string& name, const vector<Field>& schema, const StorageOptions& options = StorageOptions(),
+             bool quiet = false)
+        : name(name), fields(schema), storageOptions(options), recordCount(0), nextRowId(1), sketches(schema),
+          analyzedRows(-1), softMemoryLimit(0), hardMemoryLimit(0), overSoftLimit(false) {
+        if (fields.empty()) {
+            throw invalid_argument("错误：表结构不能为空");
+        }
+        listeners.push_back(&sketches);
+        listeners.push_back(&stringRefs);
+        if (options.mode == STORAGE_PAGED) {
+            store.reset(new PagedRecordStore(makePageFilePath(name), fields, options.bufferPoolPages));
+        } else if (options.mode == STORAGE_SHARDED) {
+            bool keyFound = false;
+            for (const auto& field : fields) {
+                if (field.name == options.shardKey) {
+                    if (field.type == FIELD_DOUBLE) {
+                        throw invalid_argument("错误：分片键不能是 DOUBLE 字段");
+                    }
+                    keyFound = true;
+                }
+            }
+            if (!keyFound) {
+                throw invalid_argument("错误：分片键 " + options.shardKey + " 不在表结构中");
+            }
+            store.reset(new ShardedRecordStore(options.shardKey, options.shardCount));
+        } else {
+            store.reset(new MemoryRecordStore());
+        }
+        if (quiet) {
+            return;
+        }
+        cout << "数据库 \"" << name << "\" 创建成功，包含 " << fields.size() << " 个字段：";
+        for (size_t i = 0; i < fields.size(); i++) {
+            cout << fields[i].name;
+            if (i < fields.size() - 1) cout << ", ";
+        }
+        cout << endl;
+    }
+    
+    ~Database() {}
+    
+    Database(const Database&) = delete;
+    Database& operator=(const Database&) = delete;
+
+private:
+    // 优化器：估计各条件的选择率，在存储层扫描与（多个）索引之间按代价选择
+    PlanChoice choosePlan(const vector<Condition>& conditions) const {
+        vector<double> selectivities;
+        vector<bool> indexable;
+        for (const Condition& condition : conditions) {
+            auto stat = columnStats.find(condition.fieldName);
+            selectivities.push_back(stat != columnStats.end() ? stat->second.selectivity(condition)
+                                                              : ColumnStatistics().selectivity(condition));
+            auto index = indexes.find(condition.fieldName);
+            indexable.push_back(index != indexes.end() && index->second->supports(condition));
+        }
+        QueryProfile scanPlan = store->plan(PredicateCompiler::primaryTerm(conditions));
+        return AccessPathOptimizer::choose(selectivities, indexable, static_cast<double>(recordCount),
+                                           static_cast<double>(scanPlan.rowsScanned), store->fetchCost());
+    }
+
+    // 按选定的索引取候选行号（多个索引时对有序行号求交），再取回记录并用全部条件复核
+    vector<RecordNode*> selectIndexed(const vector<Condition>& conditions, const PlanChoice& choice,
+                                      QueryProfile& scan) {
+        vector<RowId> candidates;
+        for (size_t k = 0; k < choice.indexed.size(); k++) {
+            const Condition& condition = conditions[choice.indexed[k]];
+            vector<RowId> rows = indexes.at(condition.fieldName)->lookup(condition);
+            if (k == 0) {
+                candidates.swap(rows);
+            } else {
+                vector<RowId> both;
+                set_intersection(candidates.begin(), candidates.end(), rows.begin(), rows.end(), back_inserter(both));
+                candidates.swap(both);
+            }
+        }
+        vector<RecordNode*> result = store->selectRows(candidates, PredicateCompiler::compile(conditions), scan);
+        scan.accessPath = ACCESS_INDEX;
+        return result;
+    }
+
+    // 将一次扫描的结果累加到累计统计与调用方的 profile 中
+    void recordScan(const QueryProfile& scan, double millis, QueryProfile* profile) {
+        stats.rowsScanned += scan.rowsScanned;
+        stats.rowsMatched += scan.rowsMatched;
+        stats.blocksSkipped += scan.blocksSkipped;
+        stats.bytesTouched += scan.bytesTouched;
+        stats.totalMillis += millis;
+        if (profile != nullptr) {
+            profile->accessPath = scan.accessPath;
+            profile->rowsScanned += scan.rowsScanned;
+            profile->rowsMatched += scan.rowsMatched;
+            profile->blocksTotal += scan.blocksTotal;
+            profile->blocksSkipped += scan.blocksSkipped;
+            profile->bytesTouched += scan.bytesTouched;
+        }
+    }
+
+    static RecordPredicate conditionPredicate(const Condition& condition) {
+        return PredicateCompiler::compile(condition);
+    }
+
+public:
+    
+    // 显示表结构
+    void displaySchema() const {
+        cout << "========== 数据库表结构: " << name << " ==========" << endl;
+        for (const auto& field : fields) {
+            cout << "  字段名: " << field.name << " | 类型: " << DatabaseUtils::fieldTypeName(field.type);
+            if (field.nullable) {
+                cout << " (可为空)";
+            }
+            cout << endl;
+        }
+        cout << "  存储方式: " << store->describe() << endl;
+        if (!indexes.empty()) {
+            cout << "  索引:";
+            for (const auto& pair : indexes) {
+                cout << " " << pair.first << "(" << pair.second->size() << " 项)";
+            }
+            cout << endl;
+        }
+        if (ttl) {
+            cout << "  TTL: " << ttl->getFieldName() << " + " << ttl->getTtlSeconds() << " 秒 (桶宽 "
+                 << ttl->getBucketWidth() << " 秒, " << ttl->bucketCount() << " 个桶, 跟踪 " << ttl->trackedRows()
+                 << " 行)" << endl;
+        }
+        cout << "============================================" << endl;
+    }
+
+    void add_element_to_database(const map<string, Value>& record){
+        if (insertRecord(record)) {
+            cout << "记录添加成功，目前共 " << recordCount << " 条记录" << endl;
+        }
+    }
+
+    // 校验并追加一条记录，成功时不输出提示（批量导入使用）
+    bool insertRecord(const map<string, Value>& record) {
+        if (record.empty()) {
+            cout << "错误：不能添加空记录" << endl;
+            return false;
+        }
+        
+        if (!validateRecord(record)) {
+            cout << "错误：记录验证失败" << endl;
+            return false;
+        }
+
+        if (!checkMemoryLimits(incomingBytes(record))) {
+            return false;
+        }
+        
+        RowId rowId = nextRowId;
+        try {
+            store->append(rowId, record);
+        } catch (const exception& e) {
+            cout << "错误：" << e.what() << endl;
+            return false;
+        }
+
+        nextRowId++;
+        recordCount++;
+        stats.adds++;
+        for (ChangeListener* listener : listeners) {
+            listener->onInsert(name, rowId, record);
+        }
+        return true;
+    }
+
+    // 整批写入：校验与内存限制检查各做一次；全部追加成功后才通知监听器，
+    // 任一条追加失败则撤销本批已追加的行，数据库保持批次前的状态
+    bool insertBatch(const vector<map<string, Value>>& records) {
+        if (records.empty()) {
+            return true;
+        }
+        if (!validateBatch(records)) {
+            cout << "错误：批次验证失败" << endl;
+            return false;
+        }
+        long long batchBytes = 0;
+        for (const auto& record : records) {
+            batchBytes += incomingBytes(record);
+        }
+        if (!checkMemoryLimits(batchBytes)) {
+            return false;
+        }
+
+        try {
+            store->appendBatch(nextRowId, records);
+        } catch (const exception& e) {
+            vector<RowId> rowIds;
+            for (size_t i = 0; i < records.size(); i++) {
+                rowIds.push_back(nextRowId + i);
+            }
+            int undone = store->removeRows(rowIds, [](RowId, const map<string, Value>&) {});
+            cout << "错误：" << e.what() << "，已撤销本批次已写入的 " << undone << " 条记录" << endl;
+            return false;
+        }
+
+        for (ChangeListener* listener : listeners) {
+            listener->onBatchBegin(name);
+        }
+        for (size_t i = 0; i < records.size(); i++) {
+            for (ChangeListener* listener : listeners) {
+                listener->onInsert(name, nextRowId + i, records[i]);
+            }
+        }
+        for (ChangeListener* listener : listeners) {
+            listener->onBatchEnd(name);
+        }
+        nextRowId += records.size();
+        recordCount += static_cast<int>(records.size());
+        stats.adds += static_cast<long long>(records.size());
+        return true;
+    }
+
+    // 删除满足条件的记录
+    // predicate: 判断函数,接受一个记录的引用,返回true表示需要删除该记录
+    // profile: 非空时填充本次执行的统计信息
+    // hint: 非空时表示满足 predicate 的记录必然满足该条件，存储层可据此跳过整块数据
+    void remove_elements_in_database(const RecordPredicate& predicate,
+                                     QueryProfile* profile = nullptr, const Condition* hint = nullptr){
+        ScopedTimer timer;
+        QueryProfile scan;
+        int removedCount = store->removeIf(predicate, hint, scan, [this](RowId rowId, const map<string, Value>& data) {
+            for (ChangeListener* listener : listeners) {
+                listener->onDelete(name, rowId, data);
+            }
+        });
+        finishRemove(removedCount, scan, timer.elapsedMillis(), profile, "扫描并删除");
+    }
+
+private:
+    void finishRemove(int removedCount, const QueryProfile& scan, double millis, QueryProfile* profile,
+                      const char* operatorName) {
+        recordCount -= removedCount;
+        recordScan(scan, millis, profile);
+        stats.deletes++;
+        if (profile != nullptr) {
+            profile->operatorMillis.emplace_back(operatorName, millis);
+        }
+
+        cout << "成功删除 " << removedCount << " 条记录,目前共 " << recordCount << " 条记录" << endl;
+    }
+
+    vector<RecordNode*> finishLocate(vector<RecordNode*> result, const QueryProfile& scan, double millis,
+                                     QueryProfile* profile, const char* operatorName) {
+        recordScan(scan, millis, profile);
+        stats.locates++;
+        if (profile != nullptr) {
+            profile->operatorMillis.emplace_back(operatorName, millis);
+        }
+
+        cout << "找到 " << result.size() << " 条满足条件的记录" << endl;
+        return result;
+    }
+
+public:
+
+    // 按单个条件删除，允许存储层做块裁剪
+    void remove_elements_in_database(const Condition& condition, QueryProfile* profile = nullptr) {
+        remove_elements_in_database(conditionPredicate(condition), profile, &condition);
+    }
+
+    // 按 and 连接的多个条件删除，由优化器决定扫描还是走索引
+    void remove_elements_in_database(const vector<Condition>& conditions, QueryProfile* profile = nullptr) {
+        PlanChoice choice = indexes.empty() ? PlanChoice() : choosePlan(conditions);
+        if (choice.accessPath != ACCESS_INDEX) {
+            remove_elements_in_database(PredicateCompiler::compile(conditions), profile,
+                                        PredicateCompiler::primaryTerm(conditions));
+            return;
+        }
+        ScopedTimer timer;
+        QueryProfile scan;
+        vector<RowId> matched;
+        for (RecordNode* node : selectIndexed(conditions, choice, scan)) {
+            matched.push_back(node->rowId);
+        }
+        int removedCount = store->removeRows(matched, [this](RowId rowId, const map<string, Value>& data) {
+            for (ChangeListener* listener : listeners) {
+                listener->onDelete(name, rowId, data);
+            }
+        });
+        finishRemove(removedCount, scan, timer.elapsedMillis(), profile, "索引查找并删除");
+    }
+
+    // 查找满足条件的记录
+    // predicate: 判断函数,接受一个记录的引用,返回true表示该记录满足条件
+    // profile: 非空时填充本次执行的统计信息
+    // hint: 非空时表示满足 predicate 的记录必然满足该条件，存储层可据此跳过整块数据
+    // 返回: 包含所有满足条件的记录指针的列表（在下一次查询或修改前有效）
+    vector<RecordNode*> locate_elements_with_features(const RecordPredicate& predicate,
+                                                      QueryProfile* profile = nullptr,
+                                                      const Condition* hint = nullptr) {
+        ScopedTimer timer;
+        QueryProfile scan;
+        vector<RecordNode*> result = store->select(predicate, hint, scan);
+        return finishLocate(std::move(result), scan, timer.elapsedMillis(), profile, "扫描过滤");
+    }
+
+    // 按单个条件查找，允许存储层做块裁剪
+    vector<RecordNode*> locate_elements_with_features(const Condition& condition, QueryProfile* profile = nullptr) {
+        return locate_elements_with_features(conditionPredicate(condition), profile, &condition);
+    }
+
+    // 按 and 连接的多个条件查找，由优化器决定扫描还是走索引
+    vector<RecordNode*> locate_elements_with_features(const vector<Condition>& conditions,
+                                                      QueryProfile* profile = nullptr) {
+        PlanChoice choice = indexes.empty() ? PlanChoice() : choosePlan(conditions);
+        if (choice.accessPath != ACCESS_INDEX) {
+            return locate_elements_with_features(PredicateCompiler::compile(conditions), profile,
+                                                 PredicateCompiler::primaryTerm(conditions));
+        }
+        ScopedTimer timer;
+        QueryProfile scan;
+        vector<RecordNode*> result = selectIndexed(conditions, choice, scan);
+        return finishLocate(std::move(result), scan, timer.elapsedMillis(), profile, "索引查找");
+    }
+
+    // 对满足条件（and 连接）的记录做聚合；conditions 为空表示全表，fieldName 为空表示 count(*)
+    // 返回聚合结果，没有参与聚合的值时返回 NULL
+    Value aggregate(AggregateFunction func, const string& fieldName,
+                    const vector<Condition>& conditions = vector<Condition>(), QueryProfile* profile = nullptr) {
+        ScopedTimer timer;
+        QueryProfile scan;
+        AggregateState state;
+        PlanChoice choice = indexes.empty() ? PlanChoice() : choosePlan(conditions);
+        if (choice.accessPath == ACCESS_INDEX) {
+            for (RecordNode* node : selectIndexed(conditions, choice, scan)) {
+                state.addRecord(node->data, fieldName);
+            }
+        } else {
+            state = store->aggregate(PredicateCompiler::compile(conditions), PredicateCompiler::primaryTerm(conditions),
+                                     fieldName, scan);
+        }
+
+        double millis = timer.elapsedMillis();
+        recordScan(scan, millis, profile);
+        stats.locates++;
+        if (profile != nullptr) {
+            profile->operatorMillis.emplace_back(choice.accessPath == ACCESS_INDEX ? "索引聚合" : "扫描聚合", millis);
+        }
+        return state.result(func);
+    }
+    
+    // 显示所有记录
+    void display_all_elements() {
+        if (recordCount == 0) {
+            cout << "数据库 \"" << name << "\" 中没有记录" << endl;
+            return;
+        }
+
+        cout << "========== 数据库: " << name << " ==========" << endl;
+        cout << "共有 " << recordCount << " 条记录" << endl;
+        cout << "======================================" << endl;
+
+        int index = 1;
+        store->forEach([&](RowId, const map<string, Value>& data) {
+            cout << "记录 #" << index << ":" << endl;
+            
+            // 遍历当前记录的所有字段
+            for (const auto& field : data) {
+                cout << "  " << field.first << ": " << field.second.toString() << endl;
+            }
+            
+            cout << "--------------------------------------" << endl;
+            index++;
+        });
+        
+        cout << "======================================" << endl;
+    }
+
+    string getName() const {
+        return name;
+    }
+    // predicate: 判断是否需要更新的条件
+    // updater: 更新函数,接受记录引用并修改
+    void update_elements_in_database(
+        const RecordPredicate& predicate,
+        const function<void(map<string, Value>&)>& updater
+    ) {
+        ScopedTimer timer;
+        QueryProfile scan;
+        int failedCount = 0;
+        int updatedCount = store->updateIf(predicate, [&](RowId rowId, map<string, Value>& data) {
+            // 先保存原记录，以便验证失败时恢复
+            map<string, Value> backup = data;
+            
+            // 执行更新
+            updater(data);
+            
+            // 验证更新后的记录是否仍符合表结构
+            if (!validateRecord(data)) {
+                cout << "警告：更新后的记录不符合表结构，已恢复原记录" << endl;
+                data = backup;  // 恢复原记录
+                return false;
+            }
+            if (!checkMemoryLimits(growthBytes(backup, data))) {
+                data = backup;
+                return false;
+            }
+            for (ChangeListener* listener : listeners) {
+                listener->onUpdate(name, rowId, backup, data);
+            }
+            return true;
+        }, scan, failedCount);
+
+        recordScan(scan, timer.elapsedMillis(), nullptr);
+        stats.updates++;
+
+        cout << "成功更新 " << updatedCount << " 条记录";
+        if (failedCount > 0) {
+            cout << "，" << failedCount << " 条记录更新失败";
+        }
+        cout << endl;
+    }
+    
+    int getRecordCount() const {
+        return recordCount;
+    }
+
+    // 近似不同值个数（HyperLogLog），字段不存在时返回 false
+    bool approxCountDistinct(const string& fieldName, double& out) const {
+        int index = sketches.fieldIndex(fieldName);
+        if (index < 0) {
+            return false;
+        }
+        out = sketches.approxCountDistinct(static_cast<size_t>(index));
+        return true;
+    }
+
+    // 近似分位数（KLL），字段不存在或不是数值/时间戳类型时返回 false
+    bool approxQuantile(const string& fieldName, double q, Value& out) const {
+        int index = sketches.fieldIndex(fieldName);
+        if (index < 0 || !ColumnSketches::supportsQuantile(fields[index].type)) {
+            return false;
+        }
+        out = sketches.approxQuantile(static_cast<size_t>(index), q);
+        return true;
+    }
+
+    long long getSketchBytes() const {
+        return sketches.memoryBytes();
+    }
+
+    MemoryUsage memoryUsage() const {
+        MemoryUsage usage;
+        usage.rows = store->residentBytes();
+        usage.strings = stringRefs.contentBytes();
+        usage.indexes = store->indexBytes() + sketches.memoryBytes() + stringRefs.trackingBytes()
+                        + (ttl ? ttl->memoryBytes() : 0);
+        for (const auto& pair : indexes) {
+            usage.indexes += pair.second->memoryBytes();
+        }
+        return usage;
+    }
+
+    // soft/hard 为 0 表示不限制
+    void setMemoryLimits(long long soft, long long hard) {
+        softMemoryLimit = soft;
+        hardMemoryLimit = hard;
+        overSoftLimit = false;
+    }
+
+    long long getSoftMemoryLimit() const {
+        return softMemoryLimit;
+    }
+
+    long long getHardMemoryLimit() const {
+        return hardMemoryLimit;
+    }
+
+    // 写入一条记录预计新增的内存：记录本身（分页存储的记录在磁盘上，不计）加上字符串在池中的占用
+    long long incomingBytes(const map<string, Value>& record) const {
+        long long bytes = storageOptions.mode == STORAGE_PAGED ? 0 : DatabaseUtils::estimateRecordBytes(record);
+        return bytes + DatabaseUtils::pooledStringBytes(record);
+    }
+
+    // 把 before 替换为 after 预计新增的内存，变小时为 0
+    long long growthBytes(const map<string, Value>& before, const map<string, Value>& after) const {
+        return max(0LL, incomingBytes(after) - incomingBytes(before));
+    }
+
+    // 写入前检查：超过硬限制拒绝写入，首次超过软限制时告警；quiet 为 true 时不输出（复制回放使用）
+    bool checkMemoryLimits(long long incomingBytes, bool quiet = false) {
+        if (softMemoryLimit <= 0 && hardMemoryLimit <= 0) {
+            return true;
+        }
+        long long projected = memoryUsage().total() + incomingBytes;
+        if (hardMemoryLimit > 0 && projected > hardMemoryLimit) {
+            if (!quiet) {
+                cout << "错误：数据库 \"" << name << "\" 的内存占用将达到 " << projected << " 字节，超过硬限制 "
+                     << hardMemoryLimit << " 字节，写入被拒绝（可删除旧记录、设置 TTL，或改用 paged 存储把记录溢出到磁盘）"
+                     << endl;
+            }
+            return false;
+        }
+        bool over = softMemoryLimit > 0 && projected > softMemoryLimit;
+        if (over && !overSoftLimit && !quiet) {
+            cout << "警告：数据库 \"" << name << "\" 的内存占用 " << projected << " 字节已超过软限制 "
+                 << softMemoryLimit << " 字节" << endl;
+        }
+        overSoftLimit = over;
+        return true;
+    }
+
+    // 在 TIMESTAMP 字段上设置 TTL：现有记录扫描一次入桶，之后随写入维护
+    // seconds <= 0 表示取消 TTL
+    bool setTtl(const string& fieldName, long long seconds) {
+        if (ttl) {
+            removeListener(ttl.get());
+            ttl.reset();
+        }
+        if (seconds <= 0) {
+            return true;
+        }
+        auto it = std::find_if(fields.begin(), fields.end(), [&](const Field& f) { return f.name == fieldName; });
+        if (it == fields.end() || it->type != FIELD_TIMESTAMP) {
+            return false;
+        }
+        ttl.reset(new TtlIndex(fieldName, seconds));
+        store->forEach([this](RowId rowId, const map<string, Value>& record) {
+            ttl->onInsert(name, rowId, record);
+        });
+        listeners.push_back(ttl.get());
+        return true;
+    }
+
+    bool hasTtl() const {
+        return ttl != nullptr;
+    }
+
+    // 删除在 now（Unix 秒）之前到期的记录，返回删除条数
+    int expire(long long now) {
+        if (!ttl) {
+            return 0;
+        }
+        vector<RowId> due = ttl->takeDue(now);
+        if (due.empty()) {
+            return 0;
+        }
+        ScopedTimer timer;
+        int removed = store->removeRows(due, [this](RowId rowId, const map<string, Value>& data) {
+            for (ChangeListener* listener : listeners) {
+                listener->onDelete(name, rowId, data);
+            }
+        });
+        recordCount -= removed;
+        stats.expiredRows += removed;
+        stats.totalMillis += timer.elapsedMillis();
+        return removed;
+    }
+
+    long long getDataBytes() const {
+        return store->dataBytes();
+    }
+
+    const DatabaseStats& getStats() const {
+        return stats;
+    }
+
+    // 生成执行计划（不执行查询）
+    QueryProfile explainScan(const Condition* hint = nullptr) const {
+        return store->plan(hint);
+    }
+
+    // 多条件查询的执行计划；optimizerNote 返回各条件的选择率估计与两种方案的代价
+    QueryProfile explainConditions(const vector<Condition>& conditions, string& optimizerNote) const {
+        PlanChoice choice = choosePlan(conditions);
+        QueryProfile estimate = store->plan(PredicateCompiler::primaryTerm(conditions));
+        ostringstream note;
+        note << fixed << setprecision(4);
+        for (size_t i = 0; i < conditions.size(); i++) {
+            const Condition& c = conditions[i];
+            note << "  选择率: " << c.fieldName << " " << DatabaseUtils::operatorSymbol(c.op) << " "
+                 << c.value.toString() << " ≈ " << choice.selectivities[i]
+                 << (columnStats.count(c.fieldName) ? "" : "（无统计，缺省值）");
+            if (std::find(choice.indexed.begin(), choice.indexed.end(), i) != choice.indexed.end()) {
+                note << " [使用索引]";
+            } else if (indexes.count(c.fieldName)) {
+                note << " [有索引]";
+            }
+            note << "\n";
+        }
+        note << setprecision(1) << "  代价: 扫描 " << choice.scanCost;
+        if (choice.accessPath == ACCESS_INDEX) {
+            note << " | 索引" << (choice.indexed.size() > 1 ? "求交 " : " ") << choice.cost;
+        }
+        note << "，预计命中 " << static_cast<long long>(choice.estimatedRows + 0.5) << " 行";
+        if (analyzedRows >= 0) {
+            note << "（统计基于 " << analyzedRows << " 行时的 analyze）";
+        }
+        optimizerNote = note.str();
+
+        if (choice.accessPath == ACCESS_INDEX) {
+            double fetched = static_cast<double>(recordCount);
+            for (size_t i : choice.indexed) {
+                fetched *= choice.selectivities[i];
+            }
+            double fraction = recordCount > 0 ? fetched / static_cast<double>(recordCount) : 0.0;
+            estimate.accessPath = ACCESS_INDEX;
+            estimate.rowsScanned = static_cast<long long>(fetched + 0.5);
+            estimate.bytesTouched = static_cast<long long>(static_cast<double>(store->dataBytes()) * fraction);
+            estimate.blocksTotal = 0;
+            estimate.blocksSkipped = 0;
+        }
+        return estimate;
+    }
+
+    // 在字段上建立二级索引：扫描一遍现有记录，之后随增删改维护
+    bool createIndex(const string& fieldName) {
+        auto field = std::find_if(fields.begin(), fields.end(), [&](const Field& f) { return f.name == fieldName; });
+        if (field == fields.end()) {
+            cout << "错误：字段 " << fieldName << " 不存在" << endl;
+            return false;
+        }
+        if (indexes.count(fieldName)) {
+            cout << "错误：字段 " << fieldName << " 上已有索引" << endl;
+            return false;
+        }
+        unique_ptr<SecondaryIndex> index(new SecondaryIndex(fieldName, field->type));
+        store->forEach([&](RowId rowId, const map<string, Value>& record) {
+            index->onInsert(name, rowId, record);
+        });
+        addListener(index.get());
+        cout << "已在字段 " << fieldName << " 上建立索引，共 " << index->size() << " 个索引项" << endl;
+        indexes[fieldName] = std::move(index);
+        return true;
+    }
+
+    bool dropIndex(const string& fieldName) {
+        auto it = indexes.find(fieldName);
+        if (it == indexes.end()) {
+            return false;
+        }
+        removeListener(it->second.get());
+        indexes.erase(it);
+        return true;
+    }
+
+    vector<string> getIndexedFields() const {
+        vector<string> names;
+        for (const auto& pair : indexes) {
+            names.push_back(pair.first);
+        }
+        return names;
+    }
+
+    // 蓄水池采样最多 SAMPLE_ROWS 行，为每列重建直方图与高频值；不同值个数取自增量维护的 HyperLogLog
+    void analyze() {
+        static const size_t SAMPLE_ROWS = 4096;
+        mt19937_64 random(static_cast<unsigned long long>(nextRowId));
+        vector<map<string, Value>> sample;
+        long long seen = 0;
+        store->forEach([&](RowId, const map<string, Value>& record) {
+            seen++;
+            if (sample.size() < SAMPLE_ROWS) {
+                sample.push_back(record);
+            } else {
+                unsigned long long slot = random() % static_cast<unsigned long long>(seen);
+                if (slot < SAMPLE_ROWS) {
+                    sample[static_cast<size_t>(slot)] = record;
+                }
+            }
+        });
+
+        columnStats.clear();
+        for (const Field& field : fields) {
+            vector<Value> values;
+            values.reserve(sample.size());
+            for (const auto& record : sample) {
+                auto it = record.find(field.name);
+                values.push_back(it != record.end() ? it->second : DatabaseUtils::makeNullValue(field.type));
+            }
+            double distinct = 1.0;
+            approxCountDistinct(field.name, distinct);
+            columnStats[field.name] = ColumnStatistics(std::move(values), min(distinct, static_cast<double>(seen)));
+        }
+        analyzedRows = seen;
+    }
+
+    const ColumnStatistics* getColumnStatistics(const string& fieldName) const {
+        auto it = columnStats.find(fieldName);
+        return it == columnStats.end() ? nullptr : &it->second;
+    }
+
+    const vector<Field>& getSchema() const {
+        return fields;
+    }
+
+    const StorageOptions& getStorageOptions() const {
+        return storageOptions;
+    }
+
+    void addListener(ChangeListener* listener) {
+        listeners.push_back(listener);
+    }
+
+    void removeListener(ChangeListener* listener) {
+        listeners.erase(std::remove(listeners.begin(), listeners.end(), listener), listeners.end());
+    }
+
+    // 按存储顺序遍历所有记录（附带行号）
+    void forEachRecord(const RecordVisitor& visitor) {
+        store->forEach(visitor);
+    }
+
+    // 按行号（即插入顺序）遍历所有记录：只收集并排序行号，再按块从存储取回记录，
+    // 常驻内存的只有行号数组和一块记录
+    void forEachRecordInRowOrder(const RecordVisitor& visitor) {
+        const size_t chunkRows = 4096;
+        vector<RowId> rowIds;
+        rowIds.reserve(static_cast<size_t>(recordCount));
+        store->forEach([&rowIds](RowId rowId, const map<string, Value>&) { rowIds.push_back(rowId); });
+        sort(rowIds.begin(), rowIds.end());
+        RecordPredicate all([](const map<string, Value>&) { return true; });
+        for (size_t start = 0; start < rowIds.size(); start += chunkRows) {
+            vector<RowId> chunk(rowIds.begin() + start, rowIds.begin() + min(start + chunkRows, rowIds.size()));
+            QueryProfile scan;
+            vector<RecordNode*> nodes = store->selectRows(chunk, all, scan);
+            sort(nodes.begin(), nodes.end(), [](const RecordNode* a, const RecordNode* b) { return a->rowId < b->rowId; });
+            for (const RecordNode* node : nodes) {
+                visitor(node->rowId, node->data);
+            }
+        }
+    }
+
+    // ---------- 复制回放接口：按主库给定的行号写入，不做校验也不输出提示 ----------
+
+    bool applyInsert(RowId rowId, const map<string, Value>& record) {
+        if (!checkMemoryLimits(incomingBytes(record), true)) {
+            return false;
+        }
+        try {
+            store->append(rowId, record);
+        } catch (const exception&) {
+            return false;
+        }
+        recordCount++;
+        nextRowId = max(nextRowId, rowId + 1);
+        for (ChangeListener* listener : listeners) {
+            listener->onInsert(name, rowId, record);
+        }
+        return true;
+    }
+
+    bool applyDelete(RowId rowId) {
+        int removed = store->removeRows(vector<RowId>(1, rowId), [this](RowId id, const map<string, Value>& data) {
+            for (ChangeListener* listener : listeners) {
+                listener->onDelete(name, id, data);
+            }
+        });
+        recordCount -= removed;
+        return removed > 0;
+    }
+
+    bool applyUpdate(RowId rowId, const map<string, Value>& record) {
+        map<string, Value> before;
+        bool limited = softMemoryLimit > 0 || hardMemoryLimit > 0;
+        if ((!listeners.empty() || limited) && !store->fetchRow(rowId, before)) {
+            return false;
+        }
+        if (!checkMemoryLimits(growthBytes(before, record), true)) {
+            return false;
+        }
+        if (!store->replaceRow(rowId, record)) {
+            return false;
+        }
+        for (ChangeListener* listener : listeners) {
+            listener->onUpdate(name, rowId, before, record);
+        }
+        return true;
+    }
+};
+
+// ==================== 物化视图 ====================
+
+// 物化视图：保存一条 locate 或 aggregate 查询的结果，作为源库的监听器按每次增删改的增量更新
+// 读取代价与结果大小成正比，重新计算的代价从每次读取转移到每次写入
+class MaterializedView : public ChangeListener {
+public:
+    enum Kind {
+        VIEW_LOCATE,
+        VIEW_AGGREGATE
+    };
+
+private:
+    string name;
+    string sourceName;
+    string definition;  // 创建时的查询文本
+    Kind kind;
+    RecordPredicate predicate;
+    AggregateFunction func;
+    string fieldName;  // 聚合字段，为空表示 count(*)
+
+    map<RowId, map<string, Value>> rows;  // VIEW_LOCATE：命中的记录，按行号即插入顺序
+    long long rowBytes;                   // rows 中记录的估算字节数
+    long long count;                      // VIEW_AGGREGATE：参与聚合的值个数
+    double sum;
+    map<Value, long long, ValueLess> values;  // min/max 需要在删除后撤回，按值保存计数
+    long long deltaCount;  // 已应用的增量次数
+
+    void apply(RowId rowId, const map<string, Value>& record, int sign) {
+        if (!predicate(record)) {
+            return;
+        }
+        deltaCount++;
+        if (kind == VIEW_LOCATE) {
+            auto it = rows.find(rowId);
+            if (it != rows.end()) {
+                rowBytes -= DatabaseUtils::estimateRecordBytes(it->second);
+                rows.erase(it);
+            }
+            if (sign > 0) {
+                rows[rowId] = record;
+                rowBytes += DatabaseUtils::estimateRecordBytes(record);
+            }
+            return;
+        }
+        if (fieldName.empty()) {
+            count += sign;
+            return;
+        }
+        auto it = record.find(fieldName);
+        if (it == record.end() || it->second.isNull) {
+            return;
+        }
+        count += sign;
+        if (it->second.type != FIELD_STRING) {
+            sum += sign * DatabaseUtils::numericValue(it->second);
+        }
+        if (func == AGG_MIN || func == AGG_MAX) {
+            long long& n = values[it->second];
+            n += sign;
+            if (n <= 0) {
+                values.erase(it->second);
+            }
+        }
+    }
+
+public:
+    MaterializedView(const string& name, const string& sourceName, const string& definition,
+                     const vector<Condition>& conditions, Kind kind, AggregateFunction func = AGG_COUNT,
+                     const string& fieldName = "")
+        : name(name), sourceName(sourceName), definition(definition), kind(kind),
+          predicate(PredicateCompiler::compile(conditions)), func(func), fieldName(fieldName),
+          rowBytes(0), count(0), sum(0.0), deltaCount(0) {}
+
+    // 用源库的现有记录初始化视图（创建时只扫描这一次）
+    void populate(Database& source) {
+        source.forEachRecord([this](RowId rowId, const map<string, Value>& record) {
+            apply(rowId, record, 1);
+        });
+        deltaCount = 0;
+    }
+
+    void onInsert(const string&, RowId rowId, const map<string, Value>& record) override {
+        apply(rowId, record, 1);
+    }
+
+    void onDelete(const string&, RowId rowId, const map<string, Value>& record) override {
+        apply(rowId, record, -1);
+    }
+
+    void onUpdate(const string&, RowId rowId, const map<string, Value>& before,
+                  const map<string, Value>& after) override {
+        apply(rowId, before, -1);
+        apply(rowId, after, 1);
+    }
+
+    const string& getSourceName() const {
+        return sourceName;
+    }
+
+    const string& getDefinition() const {
+        return definition;
+    }
+
+    size_t resultSize() const {
+        return kind == VIEW_LOCATE ? rows.size() : 1;
+    }
+
+    long long memoryBytes() const {
+        return rowBytes + static_cast<long long>(values.size() * (sizeof(Value) + sizeof(long long) + 4 * sizeof(void*)));
+    }
+
+    // 聚合视图的当前结果
+    Value aggregateResult() const {
+        AggregateState state;
+        state.count = count;
+        state.sum = sum;
+        if (!values.empty()) {
+            state.minVal = values.begin()->first;
+            state.maxVal = values.rbegin()->first;
+        }
+        return state.result(func);
+    }
+
+    void display() const {
+        cout << "========== 视图: " << name << " ==========" << endl;
+        cout << "  定义: " << definition << " (源数据库 " << sourceName << ", 已应用 " << deltaCount
+             << " 次增量)" << endl;
+        if (kind == VIEW_AGGREGATE) {
+            cout << "  结果: " << aggregateResult().toString() << endl;
+            cout << "================================" << endl;
+            return;
+        }
+        cout << "  共有 " << rows.size() << " 条记录" << endl;
+        int index = 1;
+        for (const auto& row : rows) {
+            cout << "记录 #" << index << ":" << endl;
+            for (const auto& entry : row.second) {
+                cout << "  " << entry.first << ": " << entry.second.toString() << endl;
+            }
+            cout << "--------------------------------------" << endl;
+            index++;
+        }
+        cout << "================================" << endl;
+    }
+};
+
+// ==================== 变更订阅 ====================
+
+// 单生产者/单消费者的有界无锁环形队列，容量为 2 的幂
+// 生产者是执行写操作的线程（命令线程或复制回放线程，二者由 stateMutex 串行化），
+// 消费者可以是任意一个线程，出队时不需要持有命令锁
+template <typename T>
+class SpscRing {
+private:
+    vector<T> slots;
+    size_t mask;
+    atomic<size_t> head;  // 下一个出队位置，只由消费者修改
+    atomic<size_t> tail;  // 下一个入队位置，只由生产者修改
+
+public:
+    explicit SpscRing(size_t capacityPow2) : slots(capacityPow2), mask(capacityPow2 - 1), head(0), tail(0) {}
+
+    // 队列已满时返回 false，不阻塞写入方
+    bool tryPush(T item) {
+        size_t t = tail.load(memory_order_relaxed);
+        if (t - head.load(memory_order_acquire) == slots.size()) {
+            return false;
+        }
+        slots[t & mask] = std::move(item);
+        tail.store(t + 1, memory_order_release);
+        return true;
+    }
+
+    bool tryPop(T& out) {
+        size_t h = head.load(memory_order_relaxed);
+        if (h == tail.load(memory_order_acquire)) {
+            return false;
+        }
+        out = std::move(slots[h & mask]);
+        head.store(h + 1, memory_order_release);
+        return true;
+    }
+
+    size_t size() const {
+        return tail.load(memory_order_acquire) - head.load(memory_order_acquire);
+    }
+
+    size_t capacity() const {
+        return slots.size();
+    }
+
+    long long memoryBytes() const {
+        return static_cast<long long>(slots.size() * sizeof(T));
+    }
+};
+
+// 推送给订阅者的一条变更
+struct SubscriptionEvent {
+    bool isUpdate;
+    RowId rowId;
+    map<string, Value> record;
+
+    SubscriptionEvent() : isUpdate(false), rowId(0) {}
+};
+
+// 一个订阅：条件 + 投递队列
+struct Subscription {
+    static const size_t QUEUE_CAPACITY = 1024;
+
+    int id;
+    string dbName;
+    string condition;  // 订阅时的条件文本
+    vector<Condition> terms;
+    RecordPredicate predicate;
+    SpscRing<SubscriptionEvent> queue;
+    long long delivered;  // 成功入队的事件数
+    long long dropped;    // 队列已满而丢弃的事件数
+
+    Subscription(int id, const string& dbName, const string& condition, const vector<Condition>& terms)
+        : id(id), dbName(dbName), condition(condition), terms(terms),
+          predicate(PredicateCompiler::compile(terms)), queue(QUEUE_CAPACITY), delivered(0), dropped(0) {}
+};
+
+// 一个数据库上的订阅索引：按 字段 × 运算符 × 比较值 组织订阅，
+// 每条新写入的记录只需在每个字段上做几次有序查找，就能找出可能命中的订阅，而不是逐个订阅判断
+// 每个订阅按其主条件（见 PredicateCompiler::primaryTerm）建立索引，其余 and 条件在命中后再验证
+class SubscriptionIndex : public ChangeListener {
+private:
+    typedef map<Value, vector<Subscription*>, ValueLess> ThresholdMap;
+
+    struct FieldIndex {
+        ThresholdMap equal;         // f == v
+        ThresholdMap greater;       // f > v
+        ThresholdMap greaterEqual;  // f >= v
+        ThresholdMap less;          // f < v
+        ThresholdMap lessEqual;     // f <= v
+    };
+
+    map<string, FieldIndex> byField;
+    vector<Subscription*> unindexed;  // != / contains / null 判断 / 浮点相等，逐条判断
+    size_t subscriptionCount;
+
+    ThresholdMap* slotFor(const Condition& c) {
+        if (c.value.isNull || (c.op == EQUAL && c.value.type == FIELD_DOUBLE)) {
+            return nullptr;
+        }
+        FieldIndex& index = byField[c.fieldName];
+        switch (c.op) {
+            case EQUAL: return &index.equal;
+            case GREATER: return &index.greater;
+            case GREATER_EQUAL: return &index.greaterEqual;
+            case LESS: return &index.less;
+            case LESS_EQUAL: return &index.lessEqual;
+            default: return nullptr;
+        }
+    }
+
+    static void collect(ThresholdMap::const_iterator first, ThresholdMap::const_iterator last,
+                        vector<Subscription*>& out) {
+        for (; first != last; ++first) {
+            out.insert(out.end(), first->second.begin(), first->second.end());
+        }
+    }
+
+    // 找出主条件被该记录满足的订阅
+    void candidates(const map<string, Value>& record, vector<Subscription*>& out) const {
+        for (const auto& entry : byField) {
+            auto it = record.find(entry.first);
+            if (it == record.end() || it->second.isNull) {
+                continue;
+            }
+            const Value& v = it->second;
+            const FieldIndex& index = entry.second;
+            auto eq = index.equal.find(v);
+            if (eq != index.equal.end()) {
+                out.insert(out.end(), eq->second.begin(), eq->second.end());
+            }
+            collect(index.greater.begin(), index.greater.lower_bound(v), out);            // 阈值 < v
+            collect(index.greaterEqual.begin(), index.greaterEqual.upper_bound(v), out);  // 阈值 <= v
+            collect(index.less.upper_bound(v), index.less.end(), out);                    // 阈值 > v
+            collect(index.lessEqual.lower_bound(v), index.lessEqual.end(), out);          // 阈值 >= v
+        }
+        out.insert(out.end(), unindexed.begin(), unindexed.end());
+    }
+
+    void publish(bool isUpdate, RowId rowId, const map<string, Value>& record) {
+        if (subscriptionCount == 0) {
+            return;
+        }
+        vector<Subscription*> matched;
+        candidates(record, matched);
+        for (Subscription* sub : matched) {
+            if (!sub->predicate(record)) {
+                continue;
+            }
+            SubscriptionEvent event;
+            event.isUpdate = isUpdate;
+            event.rowId = rowId;
+            event.record = record;
+            if (sub->queue.tryPush(std::move(event))) {
+                sub->delivered++;
+            } else {
+                sub->dropped++;
+            }
+        }
+    }
+
+public:
+    SubscriptionIndex() : subscriptionCount(0) {}
+
+    void add(Subscription* sub) {
+        const Condition* primary = PredicateCompiler::primaryTerm(sub->terms);
+        ThresholdMap* slot = primary != nullptr ? slotFor(*primary) : nullptr;
+        if (slot != nullptr) {
+            (*slot)[primary->value].push_back(sub);
+        } else {
+            unindexed.push_back(sub);
+        }
+        subscriptionCount++;
+    }
+
+    void remove(Subscription* sub) {
+        const Condition* primary = PredicateCompiler::primaryTerm(sub->terms);
+        ThresholdMap* slot = primary != nullptr ? slotFor(*primary) : nullptr;
+        if (slot != nullptr) {
+            auto it = slot->find(primary->value);
+            if (it != slot->end()) {
+                vector<Subscription*>& subs = it->second;
+                subs.erase(std::remove(subs.begin(), subs.end(), sub), subs.end());
+                if (subs.empty()) {
+                    slot->erase(it);
+                }
+            }
+        } else {
+            unindexed.erase(std::remove(unindexed.begin(), unindexed.end(), sub), unindexed.end());
+        }
+        subscriptionCount--;
+    }
+
+    bool empty() const {
+        return subscriptionCount == 0;
+    }
+
+    void onInsert(const string&, RowId rowId, const map<string, Value>& record) override {
+        publish(false, rowId, record);
+    }
+
+    void onDelete(const string&, RowId, const map<string, Value>&) override {}
+
+    void onUpdate(const string&, RowId rowId, const map<string, Value>&, const map<string, Value>& after) override {
+        publish(true, rowId, after);
+    }
+};
+
+// ==================== 复制日志 ====================
+// 日志为纯文本，第一行为 EPOCH <随机标识>，每次主库重新开始写日志都会换一个标识；
+// 其后每行一条已提交的变更，字段之间以制表符分隔：
+//   <lsn> CREATE <库名> <存储方式> <缓冲池页数> <字段数> {<字段名> <类型> <可为空>}...
+//   <lsn> DROP   <库名>
+//   <lsn> INSERT <库名> <行号> <按表结构顺序的字段值>...
+//   <lsn> UPDATE <库名> <行号> <按表结构顺序的字段值>...
+//   <lsn> DELETE <库名> <行号>
+// 字符串中的 \ 制表符 换行 分别转义为 \\ \t \n，NULL 写作 \N
+class ReplicationCodec {
+public:
+    static string escape(const string& text) {
+        string out;
+        out.reserve(text.size());
+        for (char c : text) {
+            switch (c) {
+                case '\\': out += "\\\\"; break;
+                case '\t': out += "\\t"; break;
+                case '\n': out += "\\n"; break;
+                case '\r': out += "\\r"; break;
+                default: out += c; break;
+            }
+        }
+        return out;
+    }
+
+    static string unescape(const string& text) {
+        string out;
+        out.reserve(text.size());
+        for (size_t i = 0; i < text.size(); i++) {
+            if (text[i] != '\\' || i + 1 >= text.size()) {
+                out += text[i];
+                continue;
+            }
+            char c = text[++i];
+            switch (c) {
+                case 't': out += '\t'; break;
+                case 'n': out += '\n'; break;
+                case 'r': out += '\r'; break;
+                default: out += c; break;
+            }
+        }
+        return out;
+    }
+
+    static vector<string> split(const string& line) {
+        vector<string> parts;
+        size_t start = 0;
+        while (true) {
+            size_t pos = line.find('\t', start);
+            if (pos == string::npos) {
+                parts.push_back(line.substr(start));
+                return parts;
+            }
+            parts.push_back(line.substr(start, pos - start));
+            start = pos + 1;
+        }
+    }
+
+    static string encodeValue(const Value& v) {
+        if (v.isNull) {
+            return "\\N";
+        }
+        switch (v.type) {
+            case FIELD_INT: return to_string(v.intVal);
+            case FIELD_INT64:
+            case FIELD_TIMESTAMP: return to_string(v.int64Val);
+            case FIELD_BOOL: return v.boolVal ? "1" : "0";
+            case FIELD_DOUBLE: {
+                char buffer[40];
+                snprintf(buffer, sizeof(buffer), "%.17g", v.doubleVal);
+                return buffer;
+            }
+            case FIELD_STRING: return escape(v.strVal.str());
+            default: return "";
+        }
+    }
+
+    static bool decodeValue(const Field& field, const string& text, Value& out) {
+        if (text == "\\N") {
+            out = DatabaseUtils::makeNullValue(field.type);
+            return true;
+        }
+        try {
+            switch (field.type) {
+                case FIELD_INT: out = DatabaseUtils::makeIntValue(stoi(text)); return true;
+                case FIELD_INT64: out = DatabaseUtils::makeInt64Value(stoll(text)); return true;
+                case FIELD_TIMESTAMP: out = DatabaseUtils::makeTimestampValue(stoll(text)); return true;
+                case FIELD_BOOL: out = DatabaseUtils::makeBoolValue(text == "1"); return true;
+                case FIELD_DOUBLE: out = DatabaseUtils::makeDoubleValue(stod(text)); return true;
+                case FIELD_STRING: out = DatabaseUtils::makeStringValue(unescape(text)); return true;
+            }
+        } catch (...) {
+        }
+        return false;
+    }
+
+    static string encodeRecord(const vector<Field>& fields, const map<string, Value>& record) {
+        string out;
+        for (const auto& field : fields) {
+            out += '\t';
+            out += encodeValue(record.at(field.name));
+        }
+        return out;
+    }
+
+    // parts[first] 开始依次为各字段的值
+    static bool decodeRecord(const vector<Field>& fields, const vector<string>& parts, size_t first,
+                             map<string, Value>& record) {
+        if (parts.size() != first + fields.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < fields.size(); i++) {
+            Value v;
+            if (!decodeValue(fields[i], parts[first + i], v)) {
+                return false;
+            }
+            record[fields[i].name] = v;
+        }
+        return true;
+    }
+};
+
+// 复制日志写入端：作为变更监听器挂在每个数据库上，每条变更写入后立即刷新
+// 一批变更写成 BEGIN ... COMMIT，先在内存中攒齐再一次写出并刷新；副本读到 COMMIT 才整批回放
+class ReplicationLog : public ChangeListener {
+private:
+    string path;
+    ofstream out;
+    unsigned long long nextLsn;
+    map<string, vector<Field>> schemas;  // 库名 -> 表结构，用于按顺序编码字段值
+    bool batching;
+    string pending;  // 当前批次尚未写出的日志行
+
+    void writeLine(const string& body) {
+        string line = to_string(nextLsn++) + '\t' + body + '\n';
+        if (batching) {
+            pending += line;
+            return;
+        }
+        out << line;
+        out.flush();
+    }
+
+public:
+    explicit ReplicationLog(const string& filePath) : path(filePath), nextLsn(1), batching(false) {
+        out.open(path, ios::out | ios::trunc | ios::binary);
+        if (!out.is_open()) {
+            throw runtime_error("无法打开复制日志文件 " + path);
+        }
+        random_device device;
+        unsigned long long epoch = (static_cast<unsigned long long>(device()) << 32) ^ device()
+                                   ^ static_cast<unsigned long long>(chrono::steady_clock::now().time_since_epoch().count());
+        out << "EPOCH\t" << hex << epoch << dec << '\n';
+        out.flush();
+    }
+
+    const string& getPath() const {
+        return path;
+    }
+
+    unsigned long long getLastLsn() const {
+        return nextLsn - 1;
+    }
+
+    void logCreate(const string& dbName, const vector<Field>& fields, const StorageOptions& options) {
+        schemas[dbName] = fields;
+        // 分片库的分片数写在页数一栏，分片键追加在行尾
+        ostringstream oss;
+        oss << "CREATE\t" << ReplicationCodec::escape(dbName) << '\t';
+        if (options.mode == STORAGE_SHARDED) {
+            oss << "sharded\t" << options.shardCount;
+        } else {
+            oss << (options.mode == STORAGE_PAGED ? "paged" : "memory") << '\t' << options.bufferPoolPages;
+        }
+        oss << '\t' << fields.size();
+        for (const auto& field : fields) {
+            oss << '\t' << ReplicationCodec::escape(field.name) << '\t' << static_cast<int>(field.type)
+                << '\t' << (field.nullable ? 1 : 0);
+        }
+        if (options.mode == STORAGE_SHARDED) {
+            oss << '\t' << ReplicationCodec::escape(options.shardKey);
+        }
+        writeLine(oss.str());
+    }
+
+    void logDrop(const string& dbName) {
+        schemas.erase(dbName);
+        writeLine("DROP\t" + ReplicationCodec::escape(dbName));
+    }
+
+    void onInsert(const string& dbName, RowId rowId, const map<string, Value>& record) override {
+        writeLine("INSERT\t" + ReplicationCodec::escape(dbName) + '\t' + to_string(rowId)
+                  + ReplicationCodec::encodeRecord(schemas[dbName], record));
+    }
+
+    void onDelete(const string& dbName, RowId rowId, const map<string, Value>&) override {
+        writeLine("DELETE\t" + ReplicationCodec::escape(dbName) + '\t' + to_string(rowId));
+    }
+
+    void onUpdate(const string& dbName, RowId rowId, const map<string, Value>&,
+                  const map<string, Value>& after) override {
+        writeLine("UPDATE\t" + ReplicationCodec::escape(dbName) + '\t' + to_string(rowId)
+                  + ReplicationCodec::encodeRecord(schemas[dbName], after));
+    }
+
+    void onBatchBegin(const string& dbName) override {
+        batching = true;
+        writeLine("BEGIN\t" + ReplicationCodec::escape(dbName));
+    }
+
+    void onBatchEnd(const string& dbName) override {
+        writeLine("COMMIT\t" + ReplicationCodec::escape(dbName));
+        batching = false;
+        out << pending;
+        out.flush();
+        pending.clear();
+    }
+};
+
+// 日志跟随端：后台线程定期读取文件中新增的完整行并交给回调处理
+// 首行的 EPOCH 标识变化（主库重新开始写日志，即使新日志已经比旧的读取位置长）
+// 或文件变短时调用 onReset 后从头读取
+class LogTailer {
+private:
+    string path;
+    function<void(const vector<string>&)> onLines;
+    function<void()> onReset;
+    int pollMillis;
+    thread worker;
+    mutex waitMutex;
+    condition_variable wakeup;
+    atomic<bool> stopping;
+    atomic<long long> offset;
+    string epoch;  // 当前跟随的日志首行，尚未读到时为空
+
+    // 读取首行的 EPOCH 标识；首行尚未完整写出时返回 false
+    static bool readEpoch(ifstream& in, string& out) {
+        in.seekg(0);
+        if (!getline(in, out) || in.eof()) {
+            in.clear();
+            return false;
+        }
+        return true;
+    }
+
+    void run() {
+        string partial;
+        while (!stopping) {
+            ifstream in(path, ios::in | ios::binary);
+            string header;
+            if (in.is_open() && readEpoch(in, header) && header.compare(0, 6, "EPOCH\t") == 0) {
+                in.seekg(0, ios::end);
+                long long size = static_cast<long long>(in.tellg());
+                if (header != epoch || size < offset) {
+                    if (!epoch.empty()) {
+                        onReset();
+                    }
+                    epoch = header;
+                    offset = static_cast<long long>(header.size()) + 1;
+                    partial.clear();
+                }
+                if (size > offset) {
+                    string chunk(static_cast<size_t>(size - offset), '\0');
+                    in.seekg(static_cast<streamoff>(offset.load()));
+                    in.read(&chunk[0], chunk.size());
+                    chunk.resize(static_cast<size_t>(in.gcount()));
+                    offset += static_cast<long long>(chunk.size());
+                    partial += chunk;
+
+                    vector<string> lines;
+                    size_t start = 0;
+                    size_t pos;
+                    while ((pos = partial.find('\n', start)) != string::npos) {
+                        lines.push_back(partial.substr(start, pos - start));
+                        start = pos + 1;
+                    }
+                    partial.erase(0, start);
+                    if (!lines.empty()) {
+                        onLines(lines);
+                    }
+                }
+            }
+            unique_lock<mutex> lock(waitMutex);
+            wakeup.wait_for(lock, chrono::milliseconds(pollMillis), [this] { return stopping.load(); });
+        }
+    }
+
+public:
+    LogTailer(const string& filePath, const function<void(const vector<string>&)>& linesCallback,
+              const function<void()>& resetCallback, int pollIntervalMillis = 50)
+        : path(filePath), onLines(linesCallback), onReset(resetCallback), pollMillis(pollIntervalMillis),
+          stopping(false), offset(0) {
+        worker = thread([this] { run(); });
+    }
+
+    ~LogTailer() {
+        {
+            lock_guard<mutex> lock(waitMutex);
+            stopping = true;
+        }
+        wakeup.notify_all();
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+
+    LogTailer(const LogTailer&) = delete;
+    LogTailer& operator=(const LogTailer&) = delete;
+
+    const string& getPath() const {
+        return path;
+    }
+
+    long long getOffset() const {
+        return offset;
+    }
+};
+
+// ==================== Arrow 列式交换 ====================
+// 按 Apache Arrow IPC 文件格式（Feather V2）导出/导入整库：
+//   "ARROW1\0\0" | Schema 消息 | RecordBatch 消息... | 流结束标记 | Footer | footer 长度 | "ARROW1"
+// 每条消息为 0xFFFFFFFF + 元数据长度 + FlatBuffers 元数据（补齐到 8 字节）+ 消息体，
+// 消息体由按 8 字节对齐的连续缓冲区组成：每列一个有效位图，再接定长值（或 Utf8 的偏移与字节）。
+// 元数据用下面的极简 FlatBuffers 编码/解码器处理，不依赖外部库；数值按本机小端序直接写出。
+
+// FlatBuffers 编码器：从前往后写，父对象先占位，子对象写完后回填偏移（偏移始终指向后方，满足无符号要求）
+class FlatBufferBuilder {
+public:
+    typedef function<size_t(FlatBufferBuilder&)> ObjectWriter;  // 写出一个子对象并返回其起始位置
+
+    struct Slot {
+        uint16_t id;          // 字段在 schema 中的序号
+        size_t size;          // 标量字节数；偏移字段为 4
+        uint64_t scalar;
+        ObjectWriter child;   // 非空表示该字段是指向子对象的偏移
+    };
+
+    static Slot scalar(uint16_t id, size_t size, uint64_t value) {
+        return Slot{id, size, value, nullptr};
+    }
+
+    static Slot object(uint16_t id, ObjectWriter child) {
+        return Slot{id, 4, 0, std::move(child)};
+    }
+
+    // 写出一张表：vtable 紧挨在表前，表内字段按大小降序排列以满足各自的对齐
+    size_t table(vector<Slot> slots) {
+        uint16_t fieldCount = 0;
+        for (const Slot& slot : slots) {
+            fieldCount = max<uint16_t>(fieldCount, static_cast<uint16_t>(slot.id + 1));
+        }
+        stable_sort(slots.begin(), slots.end(), [](const Slot& a, const Slot& b) { return a.size > b.size; });
+
+        vector<uint16_t> fieldOffsets(fieldCount, 0);
+        vector<size_t> slotOffsets(slots.size());
+        size_t inlineSize = 4;  // 开头是指向 vtable 的有符号偏移
+        for (size_t i = 0; i < slots.size(); i++) {
+            inlineSize = alignUp(inlineSize, slots[i].size);
+            slotOffsets[i] = inlineSize;
+            fieldOffsets[slots[i].id] = static_cast<uint16_t>(inlineSize);
+            inlineSize += slots[i].size;
+        }
+        inlineSize = alignUp(inlineSize, 4);
+
+        pad(2);
+        size_t vtablePos = buf.size();
+        put<uint16_t>(static_cast<uint16_t>(4 + 2 * fieldCount));
+        put<uint16_t>(static_cast<uint16_t>(inlineSize));
+        for (uint16_t offset : fieldOffsets) {
+            put<uint16_t>(offset);
+        }
+
+        pad(8);
+        size_t tablePos = buf.size();
+        buf.resize(tablePos + inlineSize, '\0');
+        patch<int32_t>(tablePos, static_cast<int32_t>(tablePos - vtablePos));
+        for (size_t i = 0; i < slots.size(); i++) {
+            if (!slots[i].child) {
+                memcpy(&buf[tablePos + slotOffsets[i]], &slots[i].scalar, slots[i].size);
+            }
+        }
+        for (size_t i = 0; i < slots.size(); i++) {
+            if (slots[i].child) {
+                size_t fieldPos = tablePos + slotOffsets[i];
+                size_t childPos = slots[i].child(*this);
+                patch<uint32_t>(fieldPos, static_cast<uint32_t>(childPos - fieldPos));
+            }
+        }
+        return tablePos;
+    }
+
+    size_t vectorOfTables(const vector<ObjectWriter>& elements) {
+        pad(4);
+        size_t pos = buf.size();
+        put<uint32_t>(static_cast<uint32_t>(elements.size()));
+        size_t first = buf.size();
+        buf.resize(first + 4 * elements.size(), '\0');
+        for (size_t i = 0; i < elements.size(); i++) {
+            size_t slotPos = first + 4 * i;
+            size_t childPos = elements[i](*this);
+            patch<uint32_t>(slotPos, static_cast<uint32_t>(childPos - slotPos));
+        }
+        return pos;
+    }
+
+    // 结构体向量：元素按 8 字节对齐，因此长度字段落在 8k+4 处
+    size_t vectorOfStructs(const string& bytes, size_t count) {
+        while ((buf.size() + 4) % 8 != 0) {
+            buf.push_back('\0');
+        }
+        size_t pos = buf.size();
+        put<uint32_t>(static_cast<uint32_t>(count));
+        buf += bytes;
+        return pos;
+    }
+
+    size_t str(const string& text) {
+        pad(4);
+        size_t pos = buf.size();
+        put<uint32_t>(static_cast<uint32_t>(text.size()));
+        buf += text;
+        buf.push_back('\0');
+        return pos;
+    }
+
+    // 以 root 为根表生成完整的缓冲区，长度补齐到 8 字节
+    string finish(const ObjectWriter& root) {
+        buf.clear();
+        put<uint32_t>(0);
+        size_t rootPos = root(*this);
+        patch<uint32_t>(0, static_cast<uint32_t>(rootPos));
+        pad(8);
+        return std::move(buf);
+    }
+
+private:
+    string buf;
+
+    static size_t alignUp(size_t value, size_t alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    void pad(size_t alignment) {
+        buf.resize(alignUp(buf.size(), alignment), '\0');
+    }
+
+    template <typename T>
+    void put(T value) {
+        buf.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template <typename T>
+    void patch(size_t pos, T value) {
+        memcpy(&buf[pos], &value, sizeof(T));
+    }
+};
+
+// FlatBuffers 表的只读视图：所有访问都做越界检查，格式错误时抛出 runtime_error
+class FlatBufferTable {
+public:
+    FlatBufferTable(const char* bytes, size_t length, size_t tablePos)
+        : data(bytes), size(length), pos(tablePos) {
+        int32_t back = readAt<int32_t>(pos);
+        vtable = static_cast<size_t>(static_cast<long long>(pos) - back);
+        vtableSize = readAt<uint16_t>(vtable);
+        if (vtableSize < 4 || vtableSize % 2 != 0) {
+            throw runtime_error("Arrow 元数据损坏：vtable 无效");
+        }
+        check(vtable, vtableSize);
+    }
+
+    static FlatBufferTable root(const char* bytes, size_t length) {
+        FlatBufferTable dummy(bytes, length);
+        return FlatBufferTable(bytes, length, dummy.deref(0));
+    }
+
+    bool has(uint16_t id) const {
+        return fieldPos(id) != 0;
+    }
+
+    template <typename T>
+    T get(uint16_t id, T defaultValue) const {
+        size_t p = fieldPos(id);
+        return p == 0 ? defaultValue : readAt<T>(p);
+    }
+
+    FlatBufferTable table(uint16_t id) const {
+        size_t p = fieldPos(id);
+        if (p == 0) {
+            throw runtime_error("Arrow 元数据缺少必需的表字段");
+        }
+        return FlatBufferTable(data, size, deref(p));
+    }
+
+    string str(uint16_t id) const {
+        size_t p = fieldPos(id);
+        if (p == 0) {
+            return "";
+        }
+        size_t start = deref(p);
+        uint32_t length = readAt<uint32_t>(start);
+        check(start + 4, length);
+        return string(data + start + 4, length);
+    }
+
+    // 返回向量首元素位置并给出元素个数；字段缺失时个数为 0
+    size_t vectorStart(uint16_t id, uint32_t& count) const {
+        count = 0;
+        size_t p = fieldPos(id);
+        if (p == 0) {
+            return 0;
+        }
+        size_t start = deref(p);
+        count = readAt<uint32_t>(start);
+        return start + 4;
+    }
+
+    // 表向量的第 index 个元素
+    FlatBufferTable tableAt(size_t first, uint32_t index) const {
+        return FlatBufferTable(data, size, deref(first + 4 * static_cast<size_t>(index)));
+    }
+
+    template <typename T>
+    T readAt(size_t p) const {
+        check(p, sizeof(T));
+        T value;
+        memcpy(&value, data + p, sizeof(T));
+        return value;
+    }
+
+private:
+    const char* data;
+    size_t size;
+    size_t pos;
+    size_t vtable;
+    uint16_t vtableSize;
+
+    FlatBufferTable(const char* bytes, size_t length)
+        : data(bytes), size(length), pos(0), vtable(0), vtableSize(0) {}
+
+    void check(size_t p, size_t length) const {
+        if (p > size || length > size - p) {
+            throw runtime_error("Arrow 元数据损坏：偏移越界");
+        }
+    }
+
+    size_t deref(size_t p) const {
+        return p + readAt<uint32_t>(p);
+    }
+
+    size_t fieldPos(uint16_t id) const {
+        size_t entry = 4 + 2 * static_cast<size_t>(id);
+        if (entry + 2 > vtableSize) {
+            return 0;
+        }
+        uint16_t offset = readAt<uint16_t>(vtable + entry);
+        return offset == 0 ? 0 : pos + offset;
+    }
+};
+
+// Arrow 格式常量（取自 Schema.fbs / Message.fbs / File.fbs）
+struct ArrowIpc {
+    static constexpr const char* MAGIC = "ARROW1";
+    static const uint32_t CONTINUATION = 0xFFFFFFFFu;
+    static const uint16_t METADATA_V5 = 4;
+    static const uint8_t HEADER_SCHEMA = 1;
+    static const uint8_t HEADER_RECORD_BATCH = 3;
+    static const uint8_t TYPE_INT = 2;
+    static const uint8_t TYPE_FLOATING_POINT = 3;
+    static const uint8_t TYPE_UTF8 = 5;
+    static const uint8_t TYPE_BOOL = 6;
+    static const uint8_t TYPE_TIMESTAMP = 10;
+    static const uint8_t TYPE_LARGE_UTF8 = 20;
+    static const uint16_t PRECISION_SINGLE = 1;
+    static const uint16_t PRECISION_DOUBLE = 2;
+
+    // 文件尾部记录的消息位置
+    struct Block {
+        long long offset;       // 消息在文件中的起点（续行标记处）
+        int32_t metadataLength; // 含 8 字节前缀
+        long long bodyLength;
+    };
+
+    // 字段与类型描述，Schema 消息与 Footer 共用
+    static size_t writeSchema(FlatBufferBuilder& fb, const vector<Field>& fields) {
+        vector<FlatBufferBuilder::ObjectWriter> writers;
+        for (const Field& field : fields) {
+            writers.push_back([&field](FlatBufferBuilder& b) { return writeField(b, field); });
+        }
+        return fb.table({
+            FlatBufferBuilder::scalar(0, 2, 0),  // 小端
+            FlatBufferBuilder::object(1, [&writers](FlatBufferBuilder& b) { return b.vectorOfTables(writers); }),
+        });
+    }
+
+    static size_t writeField(FlatBufferBuilder& fb, const Field& field) {
+        uint8_t typeId = 0;
+        FlatBufferBuilder::ObjectWriter typeWriter;
+        switch (field.type) {
+            case FIELD_INT:
+            case FIELD_INT64: {
+                uint64_t bits = field.type == FIELD_INT ? 32 : 64;
+                typeId = TYPE_INT;
+                typeWriter = [bits](FlatBufferBuilder& b) {
+                    return b.table({FlatBufferBuilder::scalar(0, 4, bits), FlatBufferBuilder::scalar(1, 1, 1)});
+                };
+                break;
+            }
+            case FIELD_DOUBLE:
+                typeId = TYPE_FLOATING_POINT;
+                typeWriter = [](FlatBufferBuilder& b) {
+                    return b.table({FlatBufferBuilder::scalar(0, 2, PRECISION_DOUBLE)});
+                };
+                break;
+            case FIELD_BOOL:
+                typeId = TYPE_BOOL;
+                typeWriter = [](FlatBufferBuilder& b) { return b.table({}); };
+                break;
+            case FIELD_TIMESTAMP:
+                // 秒精度、UTC，与本系统的 Unix 秒一致
+                typeId = TYPE_TIMESTAMP;
+                typeWriter = [](FlatBufferBuilder& b) {
+                    return b.table({FlatBufferBuilder::scalar(0, 2, 0),
+                                    FlatBufferBuilder::object(1, [](FlatBufferBuilder& s) { return s.str("UTC"); })});
+                };
+                break;
+            case FIELD_STRING:
+            default:
+                typeId = TYPE_UTF8;
+                typeWriter = [](FlatBufferBuilder& b) { return b.table({}); };
+                break;
+        }
+        return fb.table({
+            FlatBufferBuilder::object(0, [&field](FlatBufferBuilder& b) { return b.str(field.name); }),
+            FlatBufferBuilder::scalar(1, 1, field.nullable ? 1 : 0),
+            FlatBufferBuilder::scalar(2, 1, typeId),
+            FlatBufferBuilder::object(3, typeWriter),
+            FlatBufferBuilder::object(5, [](FlatBufferBuilder& b) { return b.vectorOfTables({}); }),
+        });
+    }
+
+    static size_t writeMessage(FlatBufferBuilder& fb, uint8_t headerType, const FlatBufferBuilder::ObjectWriter& header,
+                               long long bodyLength) {
+        return fb.table({
+            FlatBufferBuilder::scalar(0, 2, METADATA_V5),
+            FlatBufferBuilder::scalar(1, 1, headerType),
+            FlatBufferBuilder::object(2, header),
+            FlatBufferBuilder::scalar(3, 8, static_cast<uint64_t>(bodyLength)),
+        });
+    }
+};
+
+// 单列的构建缓冲：有效位图 + 值（定长值、位压缩的布尔值或 Utf8 字节）+ Utf8 偏移
+struct ArrowColumnBuffer {
+    FieldType type;
+    string validity;
+    string values;
+    vector<int32_t> offsets;
+    long long length;
+    long long nullCount;
+
+    explicit ArrowColumnBuffer(FieldType fieldType) : type(fieldType), length(0), nullCount(0) {
+        clear();
+    }
+
+    void clear() {
+        validity.clear();
+        values.clear();
+        offsets.assign(1, 0);
+        length = 0;
+        nullCount = 0;
+    }
+
+    void append(const Value& value) {
+        size_t bit = static_cast<size_t>(length % 8);
+        if (bit == 0) {
+            validity.push_back('\0');
+        }
+        if (value.isNull) {
+            nullCount++;
+        } else {
+            validity.back() = static_cast<char>(validity.back() | (1 << bit));
+        }
+        switch (type) {
+            case FIELD_INT: {
+                int32_t v = value.isNull ? 0 : value.intVal;
+                values.append(reinterpret_cast<const char*>(&v), sizeof(v));
+                break;
+            }
+            case FIELD_INT64:
+            case FIELD_TIMESTAMP: {
+                int64_t v = value.isNull ? 0 : value.int64Val;
+                values.append(reinterpret_cast<const char*>(&v), sizeof(v));
+                break;
+            }
+            case FIELD_DOUBLE: {
+                double v = value.isNull ? 0.0 : value.doubleVal;
+                values.append(reinterpret_cast<const char*>(&v), sizeof(v));
+                break;
+            }
+            case FIELD_BOOL:
+                if (bit == 0) {
+                    values.push_back('\0');
+                }
+                if (!value.isNull && value.boolVal) {
+                    values.back() = static_cast<char>(values.back() | (1 << bit));
+                }
+                break;
+            case FIELD_STRING:
+                if (!value.isNull) {
+                    values += value.strVal.str();
+                }
+                offsets.push_back(static_cast<int32_t>(values.size()));
+                break;
+        }
+        length++;
+    }
+
+    // 按 Arrow 规定的顺序列出本列的缓冲区
+    vector<string_view> buffers() const {
+        vector<string_view> result;
+        result.emplace_back(validity);
+        if (type == FIELD_STRING) {
+            result.emplace_back(reinterpret_cast<const char*>(offsets.data()), offsets.size() * sizeof(int32_t));
+        }
+        result.emplace_back(values);
+        return result;
+    }
+};
+
+// 流式写出：记录按行追加，每攒满一批就转成列式缓冲写出，内存占用与批大小成正比
+class ArrowIpcWriter {
+public:
+    static const long long ROWS_PER_BATCH = 65536;
+    static const size_t MAX_BATCH_BYTES = size_t(1) << 30;  // Utf8 的偏移是 int32，单批字节数需低于 2GB
+
+    ArrowIpcWriter(const string& path, const vector<Field>& schema)
+        : fields(schema), position(0), rowCount(0) {
+        out.open(path, ios::out | ios::binary | ios::trunc);
+        if (!out.is_open()) {
+            throw runtime_error("无法写入文件 " + path);
+        }
+        for (const Field& field : fields) {
+            columns.emplace_back(field.type);
+        }
+        writeBytes(string(ArrowIpc::MAGIC, 6) + string(2, '\0'));
+        FlatBufferBuilder fb;
+        string metadata = fb.finish([this](FlatBufferBuilder& b) {
+            return ArrowIpc::writeMessage(b, ArrowIpc::HEADER_SCHEMA,
+                                          [this](FlatBufferBuilder& s) { return ArrowIpc::writeSchema(s, fields); }, 0);
+        });
+        writeMessageHeader(metadata);
+    }
+
+    void append(const map<string, Value>& record) {
+        size_t batchBytes = 0;
+        for (size_t i = 0; i < fields.size(); i++) {
+            auto it = record.find(fields[i].name);
+            columns[i].append(it == record.end() ? DatabaseUtils::makeNullValue(fields[i].type) : it->second);
+            batchBytes += columns[i].values.size();
+        }
+        rowCount++;
+        if (columns.empty() || columns[0].length >= ROWS_PER_BATCH || batchBytes >= MAX_BATCH_BYTES) {
+            flushBatch();
+        }
+    }
+
+    // 写出剩余记录、流结束标记与文件尾；返回文件总字节数
+    long long finish() {
+        if (!columns.empty() && columns[0].length > 0) {
+            flushBatch();
+        }
+        writeValue<uint32_t>(ArrowIpc::CONTINUATION);
+        writeValue<int32_t>(0);
+
+        FlatBufferBuilder fb;
+        string footer = fb.finish([this](FlatBufferBuilder& b) {
+            string blockBytes;
+            for (const ArrowIpc::Block& block : blocks) {
+                int64_t offset = block.offset;
+                int64_t bodyLength = block.bodyLength;
+                int32_t padding = 0;
+                blockBytes.append(reinterpret_cast<const char*>(&offset), 8);
+                blockBytes.append(reinterpret_cast<const char*>(&block.metadataLength), 4);
+                blockBytes.append(reinterpret_cast<const char*>(&padding), 4);
+                blockBytes.append(reinterpret_cast<const char*>(&bodyLength), 8);
+            }
+            size_t blockCount = blocks.size();
+            return b.table({
+                FlatBufferBuilder::scalar(0, 2, ArrowIpc::METADATA_V5),
+                FlatBufferBuilder::object(1, [this](FlatBufferBuilder& s) { return ArrowIpc::writeSchema(s, fields); }),
+                FlatBufferBuilder::object(2, [](FlatBufferBuilder& s) { return s.vectorOfStructs("", 0); }),
+                FlatBufferBuilder::object(3, [&](FlatBufferBuilder& s) { return s.vectorOfStructs(blockBytes, blockCount); }),
+            });
+        });
+        writeBytes(footer);
+        writeValue<int32_t>(static_cast<int32_t>(footer.size()));
+        writeBytes(string(ArrowIpc::MAGIC, 6));
+        out.flush();
+        if (!out) {
+            throw runtime_error("写入文件失败");
+        }
+        return position;
+    }
+
+    long long getRowCount() const {
+        return rowCount;
+    }
+
+    size_t getBatchCount() const {
+        return blocks.size();
+    }
+
+private:
+    ofstream out;
+    vector<Field> fields;
+    vector<ArrowColumnBuffer> columns;
+    vector<ArrowIpc::Block> blocks;
+    long long position;  // 已写出的字节数
+    long long rowCount;
+
+    void writeBytes(const char* bytes, size_t length) {
+        out.write(bytes, static_cast<streamsize>(length));
+        position += static_cast<long long>(length);
+    }
+
+    void writeBytes(const string& bytes) {
+        writeBytes(bytes.data(), bytes.size());
+    }
+
+    template <typename T>
+    void writeValue(T value) {
+        writeBytes(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    // 续行标记 + 元数据长度 + 元数据；返回含前缀的元数据长度
+    int32_t writeMessageHeader(const string& metadata) {
+        writeValue<uint32_t>(ArrowIpc::CONTINUATION);
+        writeValue<int32_t>(static_cast<int32_t>(metadata.size()));
+        writeBytes(metadata);
+        return static_cast<int32_t>(metadata.size() + 8);
+    }
+
+    void flushBatch() {
+        long long length = columns[0].length;
+        string nodes;
+        string buffers;
+        vector<string_view> body;
+        long long bodyLength = 0;
+        for (const ArrowColumnBuffer& column : columns) {
+            int64_t node[2] = {column.length, column.nullCount};
+            nodes.append(reinterpret_cast<const char*>(node), sizeof(node));
+            for (string_view buffer : column.buffers()) {
+                int64_t descriptor[2] = {bodyLength, static_cast<int64_t>(buffer.size())};
+                buffers.append(reinterpret_cast<const char*>(descriptor), sizeof(descriptor));
+                body.push_back(buffer);
+                bodyLength += static_cast<long long>((buffer.size() + 7) / 8 * 8);
+            }
+        }
+
+        FlatBufferBuilder fb;
+        size_t columnCount = columns.size();
+        size_t bufferCount = body.size();
+        string metadata = fb.finish([&](FlatBufferBuilder& b) {
+            return ArrowIpc::writeMessage(b, ArrowIpc::HEADER_RECORD_BATCH, [&](FlatBufferBuilder& r) {
+                return r.table({
+                    FlatBufferBuilder::scalar(0, 8, static_cast<uint64_t>(length)),
+                    FlatBufferBuilder::object(1, [&](FlatBufferBuilder& v) { return v.vectorOfStructs(nodes, columnCount); }),
+                    FlatBufferBuilder::object(2, [&](FlatBufferBuilder& v) { return v.vectorOfStructs(buffers, bufferCount); }),
+                });
+            }, bodyLength);
+        });
+
+        ArrowIpc::Block block;
+        block.offset = position;
+        block.metadataLength = writeMessageHeader(metadata);
+        block.bodyLength = bodyLength;
+        static const char zeros[8] = {0};
+        for (string_view buffer : body) {
+            writeBytes(buffer.data(), buffer.size());
+            writeBytes(zeros, (8 - buffer.size() % 8) % 8);
+        }
+        blocks.push_back(block);
+        for (ArrowColumnBuffer& column : columns) {
+            column.clear();
+        }
+    }
+};
+
+// 读取 Arrow IPC 文件：支持本系统写出的类型，以及常见的 int8~int64、float32、large_utf8 与各精度时间戳
+class ArrowIpcReader {
+public:
+    // 只读入文件头尾与 footer，记录批次在 readBatch 时按 footer 给出的位置逐个读取，
+    // 内存占用与单个批次的大小成正比
+    explicit ArrowIpcReader(const string& path) : fileSize(0) {
+        file.open(path, ios::in | ios::binary);
+        if (!file.is_open()) {
+            throw runtime_error("无法打开文件 " + path);
+        }
+        file.seekg(0, ios::end);
+        fileSize = static_cast<size_t>(file.tellg());
+        if (fileSize < 18 || readRange(0, 6).compare(0, 6, ArrowIpc::MAGIC) != 0) {
+            throw runtime_error("不是 Arrow IPC 文件（缺少 ARROW1 标记）");
+        }
+        string tail = readRange(fileSize - 10, 10);
+        if (tail.compare(4, 6, ArrowIpc::MAGIC) != 0) {
+            throw runtime_error("不是 Arrow IPC 文件（缺少 ARROW1 标记）");
+        }
+        int32_t footerLength = 0;
+        memcpy(&footerLength, tail.data(), 4);
+        if (footerLength <= 0 || static_cast<size_t>(footerLength) > fileSize - 18) {
+            throw runtime_error("Arrow 文件尾损坏");
+        }
+        size_t footerStart = fileSize - 10 - static_cast<size_t>(footerLength);
+        string footerBytes = readRange(footerStart, static_cast<size_t>(footerLength));
+        FlatBufferTable footer = FlatBufferTable::root(footerBytes.data(), footerBytes.size());
+        readSchema(footer.table(1));
+
+        uint32_t dictionaryCount = 0;
+        footer.vectorStart(2, dictionaryCount);
+        if (dictionaryCount > 0) {
+            throw runtime_error("不支持字典编码的 Arrow 文件");
+        }
+        uint32_t blockCount = 0;
+        size_t first = footer.vectorStart(3, blockCount);
+        for (uint32_t i = 0; i < blockCount; i++) {
+            size_t p = first + 24 * static_cast<size_t>(i);
+            ArrowIpc::Block block;
+            block.offset = footer.readAt<int64_t>(p);
+            block.metadataLength = footer.readAt<int32_t>(p + 8);
+            block.bodyLength = footer.readAt<int64_t>(p + 16);
+            blocks.push_back(block);
+        }
+    }
+
+    const vector<Field>& getSchema() const {
+        return fields;
+    }
+
+    size_t getBatchCount() const {
+        return blocks.size();
+    }
+
+    // 逐行回放第 index 个记录批次
+    void readBatch(size_t index, const function<void(const map<string, Value>&)>& visitor) const {
+        const ArrowIpc::Block& block = blocks[index];
+        if (block.offset < 0 || block.metadataLength < 8 || block.bodyLength < 0 ||
+            static_cast<unsigned long long>(block.offset) + static_cast<unsigned long long>(block.metadataLength) +
+                    static_cast<unsigned long long>(block.bodyLength) > fileSize) {
+            throw runtime_error("Arrow 记录批次越界");
+        }
+        string data = readRange(static_cast<size_t>(block.offset),
+                                static_cast<size_t>(block.metadataLength) + static_cast<size_t>(block.bodyLength));
+        uint32_t marker = 0;
+        memcpy(&marker, data.data(), 4);
+        size_t prefix = marker == ArrowIpc::CONTINUATION ? 8 : 4;  // 旧格式没有续行标记
+        FlatBufferTable message = FlatBufferTable::root(data.data() + prefix,
+                                                        static_cast<size_t>(block.metadataLength) - prefix);
+        if (message.get<uint8_t>(1, 0) != ArrowIpc::HEADER_RECORD_BATCH) {
+            throw runtime_error("Arrow 文件尾指向的不是记录批次");
+        }
+        FlatBufferTable batch = message.table(2);
+        if (batch.has(3)) {
+            throw runtime_error("不支持压缩的 Arrow 记录批次");
+        }
+        long long length = batch.get<int64_t>(0, 0);
+        const char* body = data.data() + block.metadataLength;
+        size_t bodyLength = static_cast<size_t>(block.bodyLength);
+
+        uint32_t nodeCount = 0;
+        uint32_t bufferCount = 0;
+        size_t nodes = batch.vectorStart(1, nodeCount);
+        size_t buffers = batch.vectorStart(2, bufferCount);
+        if (nodeCount != columns.size() || length < 0) {
+            throw runtime_error("Arrow 记录批次与表结构不一致");
+        }
+
+        // 每列的缓冲区：有效位图、(偏移)、值
+        vector<vector<string_view>> columnBuffers(columns.size());
+        vector<long long> nullCounts(columns.size());
+        uint32_t next = 0;
+        for (size_t c = 0; c < columns.size(); c++) {
+            size_t node = nodes + 16 * c;
+            if (batch.readAt<int64_t>(node) != length) {
+                throw runtime_error("Arrow 列长度与批次行数不一致");
+            }
+            nullCounts[c] = batch.readAt<int64_t>(node + 8);
+            size_t needed = columns[c].type == FIELD_STRING ? 3 : 2;
+            for (size_t k = 0; k < needed; k++, next++) {
+                if (next >= bufferCount) {
+                    throw runtime_error("Arrow 记录批次缺少缓冲区");
+                }
+                size_t descriptor = buffers + 16 * static_cast<size_t>(next);
+                long long offset = batch.readAt<int64_t>(descriptor);
+                long long size = batch.readAt<int64_t>(descriptor + 8);
+                if (offset < 0 || size < 0 || static_cast<unsigned long long>(offset) + size > bodyLength) {
+                    throw runtime_error("Arrow 缓冲区越界");
+                }
+                columnBuffers[c].emplace_back(body + offset, static_cast<size_t>(size));
+            }
+            checkColumn(c, columnBuffers[c], length, nullCounts[c]);
+        }
+
+        map<string, Value> record;
+        for (long long row = 0; row < length; row++) {
+            for (size_t c = 0; c < columns.size(); c++) {
+                record[fields[c].name] = decode(c, columnBuffers[c], nullCounts[c], static_cast<size_t>(row));
+            }
+            visitor(record);
+        }
+    }
+
+private:
+    // 每列在文件中的物理表示
+    struct ColumnInfo {
+        FieldType type;
+        uint8_t arrowType;
+        int width;                  // 定长值或 Utf8 偏移的字节数
+        bool isSigned;
+        long long unitsPerSecond;   // 时间戳单位换算成秒的除数
+    };
+
+    mutable ifstream file;
+    size_t fileSize;
+    vector<Field> fields;
+    vector<ColumnInfo> columns;
+    vector<ArrowIpc::Block> blocks;
+
+    // 读取文件中 [offset, offset + length) 的字节
+    string readRange(size_t offset, size_t length) const {
+        string bytes(length, '\0');
+        file.clear();
+        file.seekg(static_cast<streamoff>(offset));
+        file.read(&bytes[0], static_cast<streamsize>(length));
+        if (static_cast<size_t>(file.gcount()) != length) {
+            throw runtime_error("读取 Arrow 文件失败");
+        }
+        return bytes;
+    }
+
+    void readSchema(const FlatBufferTable& schema) {
+        if (schema.get<int16_t>(0, 0) != 0) {
+            throw runtime_error("不支持大端序的 Arrow 文件");
+        }
+        uint32_t count = 0;
+        size_t first = schema.vectorStart(1, count);
+        if (count == 0) {
+            throw runtime_error("Arrow 文件没有任何列");
+        }
+        for (uint32_t i = 0; i < count; i++) {
+            FlatBufferTable field = schema.tableAt(first, i);
+            string name = field.str(0);
+            if (name.empty()) {
+                throw runtime_error("Arrow 列名不能为空");
+            }
+            if (field.has(4)) {
+                throw runtime_error("列 " + name + " 使用了字典编码，暂不支持");
+            }
+            ColumnInfo info{FIELD_STRING, field.get<uint8_t>(2, 0), 0, true, 1};
+            switch (info.arrowType) {
+                case ArrowIpc::TYPE_INT: {
+                    FlatBufferTable type = field.table(3);
+                    int bits = type.get<int32_t>(0, 0);
+                    info.isSigned = type.get<uint8_t>(1, 0) != 0;
+                    info.width = bits / 8;
+                    if (bits != 8 && bits != 16 && bits != 32 && bits != 64) {
+                        throw runtime_error("列 " + name + " 的整数位宽无效");
+                    }
+                    if (bits == 64 && !info.isSigned) {
+                        throw runtime_error("列 " + name + " 为 uint64，超出 INT64 范围");
+                    }
+                    info.type = (bits < 32 || (bits == 32 && info.isSigned)) ? FIELD_INT : FIELD_INT64;
+                    break;
+                }
+                case ArrowIpc::TYPE_FLOATING_POINT: {
+                    uint16_t precision = field.table(3).get<uint16_t>(0, 0);
+                    if (precision != ArrowIpc::PRECISION_SINGLE && precision != ArrowIpc::PRECISION_DOUBLE) {
+                        throw runtime_error("列 " + name + " 为半精度浮点，暂不支持");
+                    }
+                    info.type = FIELD_DOUBLE;
+                    info.width = precision == ArrowIpc::PRECISION_SINGLE ? 4 : 8;
+                    break;
+                }
+                case ArrowIpc::TYPE_UTF8:
+                case ArrowIpc::TYPE_LARGE_UTF8:
+                    info.type = FIELD_STRING;
+                    info.width = info.arrowType == ArrowIpc::TYPE_UTF8 ? 4 : 8;
+                    break;
+                case ArrowIpc::TYPE_BOOL:
+                    info.type = FIELD_BOOL;
+                    break;
+                case ArrowIpc::TYPE_TIMESTAMP: {
+                    static const long long divisors[] = {1, 1000, 1000000, 1000000000};
+                    uint16_t unit = field.table(3).get<uint16_t>(0, 0);
+                    if (unit > 3) {
+                        throw runtime_error("列 " + name + " 的时间戳单位无效");
+                    }
+                    info.type = FIELD_TIMESTAMP;
+                    info.width = 8;
+                    info.unitsPerSecond = divisors[unit];
+                    break;
+                }
+                default:
+                    throw runtime_error("列 " + name + " 的 Arrow 类型（编号 " + to_string(info.arrowType) + "）暂不支持");
+            }
+            fields.emplace_back(name, info.type, field.get<uint8_t>(1, 0) != 0);
+            columns.push_back(info);
+        }
+    }
+
+    // 解码前一次性检查缓冲区长度，之后按行读取时无需再做越界判断
+    void checkColumn(size_t c, const vector<string_view>& buffers, long long length, long long nullCount) const {
+        const ColumnInfo& info = columns[c];
+        size_t rows = static_cast<size_t>(length);
+        size_t bitmapBytes = (rows + 7) / 8;
+        if (nullCount < 0 || nullCount > length || (nullCount > 0 && buffers[0].size() < bitmapBytes)) {
+            throw runtime_error("列 " + fields[c].name + " 的有效位图无效");
+        }
+        if (info.type == FIELD_BOOL) {
+            if (buffers[1].size() < bitmapBytes) {
+                throw runtime_error("列 " + fields[c].name + " 的值缓冲区过短");
+            }
+            return;
+        }
+        if (info.type != FIELD_STRING) {
+            if (buffers[1].size() / static_cast<size_t>(info.width) < rows) {
+                throw runtime_error("列 " + fields[c].name + " 的值缓冲区过短");
+            }
+            return;
+        }
+        if (rows > 0 && buffers[1].size() / static_cast<size_t>(info.width) < rows + 1) {
+            throw runtime_error("列 " + fields[c].name + " 的偏移缓冲区过短");
+        }
+        long long previous = 0;
+        for (size_t i = 0; rows > 0 && i <= rows; i++) {
+            long long offset = readOffset(info, buffers[1], i);
+            if (offset < previous || static_cast<unsigned long long>(offset) > buffers[2].size()) {
+                throw runtime_error("列 " + fields[c].name + " 的偏移无效");
+            }
+            previous = offset;
+        }
+    }
+
+    static long long readOffset(const ColumnInfo& info, string_view offsets, size_t i) {
+        if (info.width == 4) {
+            int32_t v;
+            memcpy(&v, offsets.data() + 4 * i, 4);
+            return v;
+        }
+        int64_t v;
+        memcpy(&v, offsets.data() + 8 * i, 8);
+        return v;
+    }
+
+    static long long readInteger(const ColumnInfo& info, const char* p) {
+        switch (info.width) {
+            case 1: return info.isSigned ? static_cast<long long>(static_cast<int8_t>(*p))
+                                         : static_cast<long long>(static_cast<uint8_t>(*p));
+            case 2: { uint16_t v; memcpy(&v, p, 2); return info.isSigned ? static_cast<int16_t>(v) : v; }
+            case 4: { uint32_t v; memcpy(&v, p, 4); return info.isSigned ? static_cast<int32_t>(v) : static_cast<long long>(v); }
+            default: { int64_t v; memcpy(&v, p, 8); return v; }
+        }
+    }
+
+    Value decode(size_t c, const vector<string_view>& buffers, long long nullCount, size_t row) const {
+        const ColumnInfo& info = columns[c];
+        if (nullCount > 0 && !(static_cast<uint8_t>(buffers[0][row / 8]) & (1 << (row % 8)))) {
+            return DatabaseUtils::makeNullValue(info.type);
+        }
+        switch (info.type) {
+            case FIELD_INT:
+                return DatabaseUtils::makeIntValue(static_cast<int>(readInteger(info, buffers[1].data() + row * info.width)));
+            case FIELD_INT64:
+                return DatabaseUtils::makeInt64Value(readInteger(info, buffers[1].data() + row * info.width));
+            case FIELD_TIMESTAMP: {
+                long long raw = readInteger(info, buffers[1].data() + row * 8);
+                long long seconds = raw / info.unitsPerSecond;
+                if (raw % info.unitsPerSecond < 0) {
+                    seconds--;  // 向下取整，保证 1969 年的亚秒时间落在正确的秒上
+                }
+                return DatabaseUtils::makeTimestampValue(seconds);
+            }
+            case FIELD_DOUBLE:
+                if (info.width == 4) {
+                    float v;
+                    memcpy(&v, buffers[1].data() + row * 4, 4);
+                    return DatabaseUtils::makeDoubleValue(v);
+                } else {
+                    double v;
+                    memcpy(&v, buffers[1].data() + row * 8, 8);
+                    return DatabaseUtils::makeDoubleValue(v);
+                }
+            case FIELD_BOOL:
+                return DatabaseUtils::makeBoolValue((static_cast<uint8_t>(buffers[1][row / 8]) >> (row % 8)) & 1);
+            case FIELD_STRING:
+            default: {
+                long long begin = readOffset(info, buffers[1], row);
+                long long end = readOffset(info, buffers[1], row + 1);
+                return DatabaseUtils::makeStringValue(string(buffers[2].data() + begin, static_cast<size_t>(end - begin)));
+            }
+        }
+    }
+};
+
+// ==================== 数据库管理系统类 ====================
+class DatabaseManagementSystem {
+private:
+    map<string, Database*> databases;  // 数据库名 -> 数据库指针
+    Database* currentDatabase;         // 当前操作的数据库
+    string currentDatabaseName;        // 当前数据库名称
+    mutex stateMutex;                  // 命令执行与复制回放互斥
+    unique_ptr<ReplicationLog> replicationLog;  // 主库：变更日志写入端
+    unique_ptr<LogTailer> replicaTailer;        // 副本：日志跟随线程
+    unsigned long long appliedLsn;              // 副本：已回放的最大日志序号
+    long long replicaErrors;                    // 副本：无法解析或回放失败的日志行数
+    bool replayingBatch;                        // 副本：已读到 BEGIN，尚未读到 COMMIT
+    vector<string> batchLines;                  // 副本：当前批次暂存的日志行，读到 COMMIT 后一起回放
+    chrono::steady_clock::time_point lastApplyTime;
+    map<string, unique_ptr<MaterializedView>> views;  // 视图名 -> 物化视图（只在本地维护，不写复制日志）
+    map<int, unique_ptr<Subscription>> subscriptions;                   // 订阅号 -> 订阅
+    map<string, unique_ptr<SubscriptionIndex>> subscriptionIndexes;     // 库名 -> 该库上的订阅索引
+    int nextSubscriptionId;
+
+    // 删除建立在指定数据库上的所有订阅
+    void dropSubscriptionsOf(const string& dbName) {
+        for (auto it = subscriptions.begin(); it != subscriptions.end();) {
+            it = it->second->dbName == dbName ? subscriptions.erase(it) : std::next(it);
+        }
+        auto indexIt = subscriptionIndexes.find(dbName);
+        if (indexIt != subscriptionIndexes.end()) {
+            auto dbIt = databases.find(dbName);
+            if (dbIt != databases.end()) {
+                dbIt->second->removeListener(indexIt->second.get());
+            }
+            subscriptionIndexes.erase(indexIt);
+        }
+    }
+
+    // 删除建立在指定数据库上的所有视图
+    void dropViewsOf(const string& dbName) {
+        for (auto it = views.begin(); it != views.end();) {
+            if (it->second->getSourceName() == dbName) {
+                auto dbIt = databases.find(dbName);
+                if (dbIt != databases.end()) {
+                    dbIt->second->removeListener(it->second.get());
+                }
+                it = views.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    // 回放一条已拆分的日志，成功返回 true
+    bool applyLogOperation(const vector<string>& parts) {
+        const string& op = parts[1];
+        string dbName = ReplicationCodec::unescape(parts[2]);
+
+        if (op == "CREATE" && parts.size() >= 6) {
+            StorageOptions options(parts[3] == "paged" ? STORAGE_PAGED : STORAGE_MEMORY,
+                                   static_cast<size_t>(stoull(parts[4])));
+            bool sharded = parts[3] == "sharded";
+            size_t fieldCount = static_cast<size_t>(stoull(parts[5]));
+            if (parts.size() != 6 + fieldCount * 3 + (sharded ? 1 : 0)) {
+                return false;
+            }
+            if (sharded) {
+                options.mode = STORAGE_SHARDED;
+                options.shardCount = options.bufferPoolPages;
+                options.shardKey = ReplicationCodec::unescape(parts.back());
+            }
+            vector<Field> schema;
+            for (size_t i = 0; i < fieldCount; i++) {
+                schema.emplace_back(ReplicationCodec::unescape(parts[6 + i * 3]),
+                                    static_cast<FieldType>(stoi(parts[7 + i * 3])), parts[8 + i * 3] == "1");
+            }
+            return createDatabase(dbName, schema, options, true);
+        }
+        if (op == "DROP") {
+            return deleteDatabase(dbName, true);
+        }
+
+        auto it = databases.find(dbName);
+        if (it == databases.end() || parts.size() < 4) {
+            return false;
+        }
+        Database* db = it->second;
+        RowId rowId = stoull(parts[3]);
+        map<string, Value> record;
+        if (op == "INSERT") {
+            return ReplicationCodec::decodeRecord(db->getSchema(), parts, 4, record) && db->applyInsert(rowId, record);
+        }
+        if (op == "UPDATE") {
+            return ReplicationCodec::decodeRecord(db->getSchema(), parts, 4, record) && db->applyUpdate(rowId, record);
         }
-        
-        cout << "======================================" << endl;
+        if (op == "DELETE") {
+            return db->applyDelete(rowId);
+        }
+        return false;
     }
 
-    string getName() const {
-        return name;
+    // 回放一条日志并统计失败行数
+    void applyLogParts(const vector<string>& parts) {
+        bool ok = false;
+        try {
+            ok = applyLogOperation(parts);
+        } catch (const exception&) {
+            ok = false;
+        }
+        if (!ok) {
+            replicaErrors++;
+        }
     }
-    // predicate: 判断是否需要更新的条件
-    // updater: 更新函数,接受记录引用并修改
-    void update_elements_in_database(
-        const function<bool(const map<string, Value>&)>& predicate,
-        const function<void(map<string, Value>&)>& updater
-    ) {
-        RecordNode* current = RecordHead;
-        int updatedCount = 0;
-        int failedCount = 0;
 
-        while (current != nullptr) {
-            if (predicate(current->data)) {
-                // 先保存原记录，以便验证失败时恢复
-                map<string, Value> backup = current->data;
-                
-                // 执行更新
-                updater(current->data);
-                
-                // 验证更新后的记录是否仍符合表结构
-                if (!validateRecord(current->data)) {
-                    cout << "警告：更新后的记录不符合表结构，已恢复原记录" << endl;
-                    current->data = backup;  // 恢复原记录
-                    failedCount++;
-                } else {
-                    updatedCount++;
-                }
+    // 副本回放一行日志，调用方需持有 stateMutex
+    // BEGIN 与 COMMIT 之间的行先暂存，读到 COMMIT 时在同一次持锁中全部回放，查询看不到半个批次
+    void applyLogLine(const string& line) {
+        vector<string> parts = ReplicationCodec::split(line);
+        unsigned long long lsn = 0;
+        try {
+            if (parts.size() >= 3) {
+                lsn = stoull(parts[0]);
             }
-            current = current->next;
+        } catch (const exception&) {
+            lsn = 0;
+        }
+        if (lsn == 0) {
+            replicaErrors++;
+            return;
+        }
+        if (lsn <= appliedLsn) {
+            return;
         }
 
-        cout << "成功更新 " << updatedCount << " 条记录";
-        if (failedCount > 0) {
-            cout << "，" << failedCount << " 条记录更新失败";
+        if (parts[1] == "BEGIN") {
+            replayingBatch = true;
+            batchLines.clear();
+            return;
         }
-        cout << endl;
-    }
-    
-    int getRecordCount() const {
-        return recordCount;
+        if (parts[1] == "COMMIT") {
+            for (const auto& batched : batchLines) {
+                applyLogParts(ReplicationCodec::split(batched));
+            }
+            replayingBatch = false;
+            batchLines.clear();
+        } else if (replayingBatch) {
+            batchLines.push_back(line);
+            return;
+        } else {
+            applyLogParts(parts);
+        }
+        appliedLsn = lsn;
+        lastApplyTime = chrono::steady_clock::now();
     }
 
-    const vector<Field>& getSchema() const {
-        return fields;
+    // 主库重新开始写日志时副本清空本地数据，从头回放
+    void resetReplica() {
+        views.clear();
+        subscriptions.clear();
+        subscriptionIndexes.clear();
+        for (auto& pair : databases) {
+            delete pair.second;
+        }
+        databases.clear();
+        currentDatabase = nullptr;
+        currentDatabaseName = "";
+        appliedLsn = 0;
+        replayingBatch = false;
+        batchLines.clear();
     }
-};
-
-// ==================== 数据库管理系统类 ====================
-class DatabaseManagementSystem {
-private:
-    map<string, Database*> databases;  // 数据库名 -> 数据库指针
-    Database* currentDatabase;         // 当前操作的数据库
-    string currentDatabaseName;        // 当前数据库名称
     
 public:
-    DatabaseManagementSystem() : currentDatabase(nullptr), currentDatabaseName("") {
+    DatabaseManagementSystem()
+        : currentDatabase(nullptr), currentDatabaseName(""), appliedLsn(0), replicaErrors(0), replayingBatch(false),
+          nextSubscriptionId(1) {
         cout << "========== 数据库管理系统已启动 ==========" << endl;
     }
     
     ~DatabaseManagementSystem() {
+        // 先停止复制线程，再清理数据库
+        replicaTailer.reset();
+        replicationLog.reset();
         // 清理所有数据库
         for (auto& pair : databases) {
             delete pair.second;
@@ -450,31 +5779,46 @@ public:
     DatabaseManagementSystem& operator=(const DatabaseManagementSystem&) = delete;
     
     // 创建新数据库
-    bool createDatabase(const string& name, const vector<Field>& schema) {
+    // quiet: 为 true 时不输出提示信息（复制回放使用）
+    bool createDatabase(const string& name, const vector<Field>& schema,
+                        const StorageOptions& options = StorageOptions(), bool quiet = false) {
         // 检查数据库名是否已存在
         if (databases.find(name) != databases.end()) {
-            cout << "错误：数据库 \"" << name << "\" 已存在" << endl;
+            if (!quiet) {
+                cout << "错误：数据库 \"" << name << "\" 已存在" << endl;
+            }
             return false;
         }
         
         // 检查表结构是否为空
         if (schema.empty()) {
-            cout << "错误：数据库表结构不能为空" << endl;
+            if (!quiet) {
+                cout << "错误：数据库表结构不能为空" << endl;
+            }
             return false;
         }
         
         try {
             // 创建新数据库
-            Database* newDb = new Database(name, schema);
+            Database* newDb = new Database(name, schema, options, quiet);
             databases[name] = newDb;
+            if (replicationLog) {
+                replicationLog->logCreate(name, schema, options);
+                newDb->addListener(replicationLog.get());
+            }
             
             // 如果这是第一个数据库，自动设为当前数据库
             if (currentDatabase == nullptr) {
                 currentDatabase = newDb;
                 currentDatabaseName = name;
-                cout << "已自动切换到数据库 \"" << name << "\"" << endl;
+                if (!quiet) {
+                    cout << "已自动切换到数据库 \"" << name << "\"" << endl;
+                }
             }
             
+            if (quiet) {
+                return true;
+            }
             cout << "数据库 \"" << name << "\" 创建成功！目前共有 " << databases.size() << " 个数据库" << endl;
             return true;
         } catch (const exception& e) {
@@ -484,23 +5828,36 @@ public:
     }
     
     // 删除数据库
-    bool deleteDatabase(const string& name) {
+    // quiet: 为 true 时不输出提示信息（复制回放使用）
+    bool deleteDatabase(const string& name, bool quiet = false) {
         auto it = databases.find(name);
         if (it == databases.end()) {
-            cout << "错误：数据库 \"" << name << "\" 不存在" << endl;
+            if (!quiet) {
+                cout << "错误：数据库 \"" << name << "\" 不存在" << endl;
+            }
             return false;
         }
         
         // 如果要删除的是当前数据库，需要先切换
         if (currentDatabaseName == name) {
-            cout << "警告：正在删除当前操作的数据库 \"" << name << "\"" << endl;
+            if (!quiet) {
+                cout << "警告：正在删除当前操作的数据库 \"" << name << "\"" << endl;
+            }
             currentDatabase = nullptr;
             currentDatabaseName = "";
         }
         
-        // 删除数据库
+        // 删除数据库（视图与订阅随之删除）
+        dropViewsOf(name);
+        dropSubscriptionsOf(name);
         delete it->second;
         databases.erase(it);
+        if (replicationLog) {
+            replicationLog->logDrop(name);
+        }
+        if (quiet) {
+            return true;
+        }
         
         cout << "数据库 \"" << name << "\" 已删除。目前共有 " << databases.size() << " 个数据库" << endl;
         
@@ -546,6 +5903,125 @@ public:
         cout << "======================================" << endl;
     }
     
+    // 在当前数据库上创建物化视图：先扫描一次现有记录，之后随变更增量维护
+    bool createView(const string& viewName, unique_ptr<MaterializedView> view) {
+        if (views.find(viewName) != views.end()) {
+            cout << "错误：视图 \"" << viewName << "\" 已存在" << endl;
+            return false;
+        }
+        auto dbIt = databases.find(view->getSourceName());
+        if (dbIt == databases.end()) {
+            cout << "错误：数据库 \"" << view->getSourceName() << "\" 不存在" << endl;
+            return false;
+        }
+        view->populate(*dbIt->second);
+        dbIt->second->addListener(view.get());
+        cout << "视图 \"" << viewName << "\" 创建成功，当前结果 " << view->resultSize() << " 行" << endl;
+        views[viewName] = std::move(view);
+        return true;
+    }
+
+    bool dropView(const string& viewName) {
+        auto it = views.find(viewName);
+        if (it == views.end()) {
+            cout << "错误：视图 \"" << viewName << "\" 不存在" << endl;
+            return false;
+        }
+        auto dbIt = databases.find(it->second->getSourceName());
+        if (dbIt != databases.end()) {
+            dbIt->second->removeListener(it->second.get());
+        }
+        views.erase(it);
+        cout << "视图 \"" << viewName << "\" 已删除" << endl;
+        return true;
+    }
+
+    // 读取视图结果，不扫描源库
+    bool showView(const string& viewName) const {
+        auto it = views.find(viewName);
+        if (it == views.end()) {
+            cout << "错误：视图 \"" << viewName << "\" 不存在" << endl;
+            return false;
+        }
+        it->second->display();
+        return true;
+    }
+
+    void showViews() const {
+        cout << "========== 物化视图列表 ==========" << endl;
+        if (views.empty()) {
+            cout << "  (无视图)" << endl;
+        }
+        for (const auto& pair : views) {
+            cout << "  " << pair.first << ": " << pair.second->getDefinition() << " (源数据库 "
+                 << pair.second->getSourceName() << ", " << pair.second->resultSize() << " 行)" << endl;
+        }
+        cout << "======================================" << endl;
+    }
+
+    // 在当前数据库上订阅满足条件的新增/更新记录，返回订阅号，失败返回 -1
+    int subscribe(const string& condition, const vector<Condition>& terms) {
+        if (currentDatabase == nullptr) {
+            cout << "错误：请先使用 open 命令选择数据库" << endl;
+            return -1;
+        }
+        int id = nextSubscriptionId++;
+        unique_ptr<Subscription> sub(new Subscription(id, currentDatabaseName, condition, terms));
+        unique_ptr<SubscriptionIndex>& index = subscriptionIndexes[currentDatabaseName];
+        if (!index) {
+            index.reset(new SubscriptionIndex());
+            currentDatabase->addListener(index.get());
+        }
+        index->add(sub.get());
+        subscriptions[id] = std::move(sub);
+        return id;
+    }
+
+    bool unsubscribe(int id) {
+        auto it = subscriptions.find(id);
+        if (it == subscriptions.end()) {
+            cout << "错误：订阅 " << id << " 不存在" << endl;
+            return false;
+        }
+        const string dbName = it->second->dbName;
+        auto indexIt = subscriptionIndexes.find(dbName);
+        indexIt->second->remove(it->second.get());
+        if (indexIt->second->empty()) {
+            databases[dbName]->removeListener(indexIt->second.get());
+            subscriptionIndexes.erase(indexIt);
+        }
+        subscriptions.erase(it);
+        return true;
+    }
+
+    // 取出订阅队列中最多 maxEvents 条事件
+    bool pollSubscription(int id, size_t maxEvents, vector<SubscriptionEvent>& out) {
+        auto it = subscriptions.find(id);
+        if (it == subscriptions.end()) {
+            cout << "错误：订阅 " << id << " 不存在" << endl;
+            return false;
+        }
+        SubscriptionEvent event;
+        while (out.size() < maxEvents && it->second->queue.tryPop(event)) {
+            out.push_back(std::move(event));
+        }
+        return true;
+    }
+
+    void showSubscriptions() const {
+        cout << "========== 订阅列表 ==========" << endl;
+        if (subscriptions.empty()) {
+            cout << "  (无订阅)" << endl;
+        }
+        for (const auto& pair : subscriptions) {
+            const Subscription& sub = *pair.second;
+            cout << "  #" << sub.id << " " << sub.dbName << ": " << sub.condition << " | 已投递 " << sub.delivered
+                 << " | 待取 " << sub.queue.size() << "/" << sub.queue.capacity() << " | 丢弃 " << sub.dropped
+                 << endl;
+        }
+        cout << "======================================" << endl;
+    }
+
     // 显示当前操作的数据库信息
     void showCurrentDatabase() const {
         cout << "========== 当前数据库信息 ==========" << endl;
@@ -563,6 +6039,302 @@ public:
         cout << "======================================" << endl;
     }
     
+    // 显示每个数据库的累计执行统计
+    void showStats() const {
+        cout << "========== 数据库执行统计 ==========" << endl;
+        if (databases.empty()) {
+            cout << "  (无数据库)" << endl;
+        }
+        for (const auto& pair : databases) {
+            const Database* db = pair.second;
+            const DatabaseStats& st = db->getStats();
+            cout << "  [" << pair.first << "] 记录 " << db->getRecordCount()
+                 << " 条，约 " << db->getDataBytes() << " 字节" << endl;
+            cout << "    add " << st.adds << " 次 | locate " << st.locates
+                 << " 次 | delete " << st.deletes << " 次 | update " << st.updates << " 次";
+            if (st.expiredRows > 0) {
+                cout << " | TTL 到期 " << st.expiredRows << " 条";
+            }
+            cout << endl;
+            cout << "    扫描行数 " << st.rowsScanned << " | 命中行数 " << st.rowsMatched
+                 << " | 跳过块数 " << st.blocksSkipped << " | 访问字节 " << st.bytesTouched << endl;
+            cout << "    累计耗时 " << fixed << setprecision(3) << st.totalMillis << " ms" << endl;
+            cout.unsetf(ios::floatfield);
+            cout << setprecision(6);
+        }
+        cout << "  字符串池（所有数据库共享）: " << StringPool::instance().size() << " 个不同的字符串，约 "
+             << StringPool::instance().memoryBytes() << " 字节" << endl;
+        cout << "======================================" << endl;
+    }
+
+    // 按数据库显示内存占用：记录、字符串、索引，以及建立在该库上的视图与订阅
+    void showMemory() const {
+        cout << "========== 内存占用 ==========" << endl;
+        if (databases.empty()) {
+            cout << "  (无数据库)" << endl;
+        }
+        long long grandTotal = 0;
+        for (const auto& pair : databases) {
+            const Database* db = pair.second;
+            MemoryUsage usage = db->memoryUsage();
+            long long viewBytes = 0;
+            for (const auto& view : views) {
+                if (view.second->getSourceName() == pair.first) {
+                    viewBytes += view.second->memoryBytes();
+                }
+            }
+            long long subscriptionBytes = 0;
+            for (const auto& sub : subscriptions) {
+                if (sub.second->dbName == pair.first) {
+                    subscriptionBytes += sub.second->queue.memoryBytes();
+                }
+            }
+            long long total = usage.total() + viewBytes + subscriptionBytes;
+            grandTotal += total;
+            cout << "  [" << pair.first << "] 共 " << total << " 字节" << endl;
+            cout << "    记录 " << usage.rows << " | 字符串 " << usage.strings << " | 索引 " << usage.indexes
+                 << " | 视图 " << viewBytes << " | 订阅队列 " << subscriptionBytes << endl;
+            if (db->getSoftMemoryLimit() > 0 || db->getHardMemoryLimit() > 0) {
+                cout << "    限制: 软 " << db->getSoftMemoryLimit() << " | 硬 " << db->getHardMemoryLimit()
+                     << " (限制只计算记录、字符串与索引)" << endl;
+            }
+        }
+        cout << "  合计 " << grandTotal << " 字节；字符串池（共享）" << StringPool::instance().memoryBytes()
+             << " 字节" << endl;
+        cout << "======================================" << endl;
+    }
+
+    // 重新采样数据库的列统计并输出摘要
+    bool analyzeDatabase(const string& dbName) {
+        Database* db = findDatabase(dbName);
+        if (db == nullptr) {
+            cout << "错误：数据库 \"" << dbName << "\" 不存在" << endl;
+            return false;
+        }
+        ScopedTimer timer;
+        db->analyze();
+        cout << "========== 列统计: " << dbName << " ==========" << endl;
+        cout << fixed << setprecision(3);
+        for (const Field& field : db->getSchema()) {
+            const ColumnStatistics* stat = db->getColumnStatistics(field.name);
+            cout << "  " << field.name << ": 不同值≈" << static_cast<long long>(stat->getDistinctCount() + 0.5)
+                 << " | NULL 比例 " << stat->getNullFraction();
+            const vector<Value>& bounds = stat->getBounds();
+            if (!bounds.empty()) {
+                cout << " | 范围 [" << bounds.front().toString() << ", " << bounds.back().toString() << "] "
+                     << bounds.size() - 1 << " 个等深桶";
+            }
+            const auto& common = stat->getMostCommon();
+            if (!common.empty()) {
+                cout << " | 高频值";
+                for (size_t i = 0; i < common.size() && i < 3; i++) {
+                    cout << " " << common[i].first.toString() << "(" << common[i].second << ")";
+                }
+            }
+            cout << endl;
+        }
+        cout << "  耗时 " << timer.elapsedMillis() << " ms" << endl;
+        cout.unsetf(ios::floatfield);
+        cout << setprecision(6);
+        cout << "======================================" << endl;
+        return true;
+    }
+
+    // 把整库写成 Arrow IPC 文件，可被 pyarrow / DuckDB / Polars 等直接读取
+    bool exportArrow(const string& dbName, const string& path) {
+        auto it = databases.find(dbName);
+        if (it == databases.end()) {
+            cout << "错误：数据库 \"" << dbName << "\" 不存在" << endl;
+            return false;
+        }
+        ScopedTimer timer;
+        try {
+            // 存储的遍历顺序不固定（内存链表新记录在前，分页存储会复用空闲槽位），按行号顺序写出，
+            // 导出文件的行序与插入顺序一致
+            ArrowIpcWriter writer(path, it->second->getSchema());
+            it->second->forEachRecordInRowOrder([&writer](RowId, const map<string, Value>& record) {
+                writer.append(record);
+            });
+            long long bytes = writer.finish();
+            cout << "已导出 " << writer.getRowCount() << " 条记录（" << writer.getBatchCount() << " 个记录批次，"
+                 << bytes << " 字节）到 " << path << "，耗时 " << fixed << setprecision(3)
+                 << timer.elapsedMillis() << " ms" << endl;
+            cout.unsetf(ios::floatfield);
+            cout << setprecision(6);
+        } catch (const exception& e) {
+            cout << "错误：导出失败：" << e.what() << endl;
+            return false;
+        }
+        return true;
+    }
+
+    // 读取 Arrow IPC 文件：数据库不存在时按文件的表结构创建，存在时要求列名与类型一致并追加
+    bool importArrow(const string& dbName, const string& path) {
+        ScopedTimer timer;
+        try {
+            ArrowIpcReader reader(path);
+            const vector<Field>& schema = reader.getSchema();
+            auto it = databases.find(dbName);
+            if (it != databases.end()) {
+                const vector<Field>& existing = it->second->getSchema();
+                bool same = existing.size() == schema.size();
+                for (size_t i = 0; same && i < schema.size(); i++) {
+                    same = existing[i].name == schema[i].name && existing[i].type == schema[i].type;
+                }
+                if (!same) {
+                    cout << "错误：文件的列与数据库 \"" << dbName << "\" 的表结构不一致" << endl;
+                    return false;
+                }
+            } else if (!createDatabase(dbName, schema)) {
+                return false;
+            }
+            Database* db = databases[dbName];
+
+            // 每个 Arrow 记录批次整批校验、整批写入
+            long long imported = 0;
+            bool failed = false;
+            vector<map<string, Value>> batch;
+            for (size_t i = 0; i < reader.getBatchCount() && !failed; i++) {
+                batch.clear();
+                reader.readBatch(i, [&batch](const map<string, Value>& record) {
+                    batch.push_back(record);
+                });
+                if (db->insertBatch(batch)) {
+                    imported += static_cast<long long>(batch.size());
+                } else {
+                    failed = true;
+                }
+            }
+            cout << (failed ? "导入中止：" : "") << "已导入 " << imported << " 条记录（" << reader.getBatchCount()
+                 << " 个记录批次）到数据库 \"" << dbName << "\"，耗时 " << fixed << setprecision(3)
+                 << timer.elapsedMillis() << " ms" << endl;
+            cout.unsetf(ios::floatfield);
+            cout << setprecision(6);
+            return !failed;
+        } catch (const exception& e) {
+            cout << "错误：导入失败：" << e.what() << endl;
+            return false;
+        }
+    }
+
+    // 删除各数据库中已到期的记录，返回删除总数
+    // 只读副本不自行过期，到期删除由主库经复制日志传过来
+    int expireDue() {
+        if (isReadOnly()) {
+            return 0;
+        }
+        long long now = chrono::duration_cast<chrono::seconds>(
+            chrono::system_clock::now().time_since_epoch()).count();
+        int removed = 0;
+        for (auto& pair : databases) {
+            removed += pair.second->expire(now);
+        }
+        return removed;
+    }
+
+    // 命令执行期间需持有该锁，避免与副本回放线程并发修改
+    mutex& getMutex() {
+        return stateMutex;
+    }
+
+    // 副本模式下只接受读操作
+    bool isReadOnly() const {
+        return replicaTailer != nullptr;
+    }
+
+    // 主库：开始把已提交的变更写入日志文件，先写入当前全部数据作为快照
+    bool startReplicationLog(const string& path) {
+        if (isReadOnly()) {
+            cout << "错误：只读副本不能再作为主库写复制日志" << endl;
+            return false;
+        }
+        stopReplicationLog();
+        try {
+            replicationLog.reset(new ReplicationLog(path));
+        } catch (const exception& e) {
+            cout << "错误：" << e.what() << endl;
+            return false;
+        }
+        for (auto& pair : databases) {
+            Database* db = pair.second;
+            // 快照逐行写出，不包成一批：调用方持有 stateMutex，写快照期间没有其他变更
+            replicationLog->logCreate(pair.first, db->getSchema(), db->getStorageOptions());
+            db->forEachRecord([&](RowId rowId, const map<string, Value>& record) {
+                replicationLog->onInsert(pair.first, rowId, record);
+            });
+            db->addListener(replicationLog.get());
+        }
+        cout << "复制日志已写入 " << path << "（快照 " << replicationLog->getLastLsn()
+             << " 条），后续变更将持续追加" << endl;
+        return true;
+    }
+
+    void stopReplicationLog() {
+        if (!replicationLog) {
+            return;
+        }
+        for (auto& pair : databases) {
+            pair.second->removeListener(replicationLog.get());
+        }
+        replicationLog.reset();
+    }
+
+    // 副本：清空本地数据，后台线程持续回放主库的日志文件
+    // 调用方需持有 stateMutex
+    bool followReplica(const string& path) {
+        if (replicationLog) {
+            cout << "错误：正在写复制日志的主库不能同时作为副本" << endl;
+            return false;
+        }
+        replicaTailer.reset();
+        resetReplica();
+        replicaErrors = 0;
+        lastApplyTime = chrono::steady_clock::now();
+        replicaTailer.reset(new LogTailer(path, [this](const vector<string>& lines) {
+            lock_guard<mutex> lock(stateMutex);
+            for (const auto& line : lines) {
+                applyLogLine(line);
+            }
+        }, [this]() {
+            lock_guard<mutex> lock(stateMutex);
+            resetReplica();
+        }));
+        cout << "已进入只读副本模式，正在跟随 " << path << endl;
+        return true;
+    }
+
+    // 调用方不能持有 stateMutex：需要等待回放线程退出
+    void stopReplica() {
+        replicaTailer.reset();
+    }
+
+    void showReplicationStatus() const {
+        cout << "========== 复制状态 ==========" << endl;
+        if (replicationLog) {
+            cout << "  角色: 主库" << endl;
+            cout << "  日志文件: " << replicationLog->getPath() << endl;
+            cout << "  已写入 LSN: " << replicationLog->getLastLsn() << endl;
+        } else if (replicaTailer) {
+            double idle = chrono::duration<double>(chrono::steady_clock::now() - lastApplyTime).count();
+            cout << "  角色: 只读副本" << endl;
+            cout << "  日志文件: " << replicaTailer->getPath() << endl;
+            cout << "  已回放 LSN: " << appliedLsn << " (读取到第 " << replicaTailer->getOffset() << " 字节)" << endl;
+            cout << "  距上次回放: " << fixed << setprecision(1) << idle << " 秒" << endl;
+            cout.unsetf(ios::floatfield);
+            cout << setprecision(6);
+            cout << "  回放失败行数: " << replicaErrors << endl;
+        } else {
+            cout << "  未启用复制" << endl;
+        }
+        cout << "================================" << endl;
+    }
+
+    // 按名称查找数据库，不存在时返回 nullptr
+    Database* findDatabase(const string& name) {
+        auto it = databases.find(name);
+        return it == databases.end() ? nullptr : it->second;
+    }
+
     // 获取当前数据库指针（供外部操作使用）
     Database* getCurrentDatabase() {
         if (currentDatabase == nullptr) {
@@ -591,6 +6363,9 @@ public:
 class CommandParser {
 private:
     DatabaseManagementSystem& dbms;
+    bool inTransaction;                        // begin 之后、commit/rollback 之前
+    string transactionDatabase;                // 事务开始时的当前数据库，暂存记录提交到这里
+    vector<map<string, Value>> stagedRecords;  // 事务中 add 的记录，提交时整批校验写入
 
     static void prompt(const string& message) {
         cout << message;
@@ -633,6 +6408,55 @@ private:
         }
     }
 
+    static bool parseInt64(const string& text, long long& outValue) {
+        try {
+            size_t pos = 0;
+            outValue = stoll(text, &pos);
+            return pos == text.size();
+        } catch (...) {
+            return false;
+        }
+    }
+
+    static bool parseBool(const string& text, bool& outValue) {
+        string lowered = toLower(text);
+        if (lowered == "true" || lowered == "1" || lowered == "yes") {
+            outValue = true;
+            return true;
+        }
+        if (lowered == "false" || lowered == "0" || lowered == "no") {
+            outValue = false;
+            return true;
+        }
+        return false;
+    }
+
+    // 时间戳可输入秒数，或 "YYYY-MM-DD"、"YYYY-MM-DD HH:MM:SS"（按 UTC 解释）
+    static bool parseTimestamp(const string& text, long long& outValue) {
+        if (parseInt64(text, outValue)) {
+            return true;
+        }
+        int y = 0, mo = 0, d = 0, h = 0, mi = 0, sec = 0;
+        char sep = ' ';
+        int consumed = 0;
+        int matched = sscanf(text.c_str(), "%d-%d-%d%c%d:%d:%d%n", &y, &mo, &d, &sep, &h, &mi, &sec, &consumed);
+        if (matched == 3) {
+            consumed = static_cast<int>(text.size());
+            h = mi = sec = 0;
+        } else if (matched != 7 || (sep != ' ' && sep != 'T') || consumed != static_cast<int>(text.size())) {
+            return false;
+        }
+        if (mo < 1 || mo > 12 || h < 0 || h > 23 || mi < 0 || mi > 59 || sec < 0 || sec > 60) {
+            return false;
+        }
+        if (d < 1 || static_cast<unsigned>(d) > daysInMonth(y, static_cast<unsigned>(mo))) {
+            return false;
+        }
+        outValue = daysFromCivil(y, static_cast<unsigned>(mo), static_cast<unsigned>(d)) * 86400LL
+                   + h * 3600LL + mi * 60LL + sec;
+        return true;
+    }
+
     static bool parseDoubleValue(const string& text, double& outValue) {
         try {
             size_t pos = 0;
@@ -643,8 +6467,25 @@ private:
         }
     }
 
-    static bool parseFieldType(const string& text, FieldType& outType) {
+    // 类型名末尾加 ? 表示该字段可为空，例如 int64?
+    static bool parseFieldType(const string& text, FieldType& outType, bool& outNullable) {
         string lowered = toLower(text);
+        outNullable = !lowered.empty() && lowered.back() == '?';
+        if (outNullable) {
+            lowered.pop_back();
+        }
+        if (lowered == "int64" || lowered == "bigint") {
+            outType = FIELD_INT64;
+            return true;
+        }
+        if (lowered == "timestamp") {
+            outType = FIELD_TIMESTAMP;
+            return true;
+        }
+        if (lowered == "bool" || lowered == "boolean") {
+            outType = FIELD_BOOL;
+            return true;
+        }
         if (lowered == "int") {
             outType = FIELD_INT;
             return true;
@@ -718,6 +6559,12 @@ private:
     static bool convertValueByField(const Field& field, const string& text, Value& outValue) {
         string trimmed = trim(text);
         Value converted;
+        // 未加引号的 null 表示空值，仅可为空的字段接受；
+        // 不可为空的字符串字段与以前一样把它当作文本 "null" 保存，其余类型随后解析失败
+        if (field.nullable && toLower(trimmed) == "null") {
+            outValue = DatabaseUtils::makeNullValue(field.type);
+            return true;
+        }
         switch (field.type) {
             case FIELD_INT: {
                 int temp;
@@ -739,6 +6586,30 @@ private:
                 converted = DatabaseUtils::makeStringValue(stripQuotes(trimmed));
                 break;
             }
+            case FIELD_INT64: {
+                long long temp;
+                if (!parseInt64(trimmed, temp)) {
+                    return false;
+                }
+                converted = DatabaseUtils::makeInt64Value(temp);
+                break;
+            }
+            case FIELD_TIMESTAMP: {
+                long long temp;
+                if (!parseTimestamp(stripQuotes(trimmed), temp)) {
+                    return false;
+                }
+                converted = DatabaseUtils::makeTimestampValue(temp);
+                break;
+            }
+            case FIELD_BOOL: {
+                bool temp;
+                if (!parseBool(trimmed, temp)) {
+                    return false;
+                }
+                converted = DatabaseUtils::makeBoolValue(temp);
+                break;
+            }
             default:
                 return false;
         }
@@ -748,17 +6619,104 @@ private:
 
     static void printHelp() {
         cout << "可用命令:" << endl;
-        cout << "  create <name>           - 创建数据库" << endl;
+        cout << "  create <name> [paged [页数]] - 创建数据库，paged 表示记录存放在页面文件中" << endl;
+        cout << "                            并通过固定页数的缓冲池访问" << endl;
+        cout << "                            （页面文件位于 CMDBS_DATA_DIR，未设置时为系统临时目录）" << endl;
+        cout << "  create <name> sharded <键字段> [分片数]" << endl;
+        cout << "                          - 创建按键哈希分片的数据库，每个分片由一个工作线程处理" << endl;
         cout << "  open <name>             - 切换当前数据库" << endl;
         cout << "  add                     - 向当前数据库追加记录" << endl;
-        cout << "  locate for <cond>       - 按条件定位记录" << endl;
+        cout << "  begin / commit / rollback - 事务：其间的 add 先暂存，commit 时整批校验并原子写入" << endl;
+        cout << "  locate for <cond>       - 按条件定位记录，多个条件可用 and 连接" << endl;
         cout << "  delete for <cond>       - 按条件删除记录" << endl;
+        cout << "  aggregate <func> <field|*> [for <cond>]" << endl;
+        cout << "                          - 聚合查询，func 为 count/sum/min/max/avg" << endl;
+        cout << "  aggregate approx_count_distinct <field>" << endl;
+        cout << "  aggregate approx_quantile <field> <q>" << endl;
+        cout << "                          - 基于增量维护的列摘要给出近似不同值个数/分位数（含已删除的值）" << endl;
+        cout << "  explain <locate|delete|aggregate> - 只显示执行计划，不执行" << endl;
+        cout << "  profile <locate|delete|aggregate> - 执行并显示访问路径、行数与各算子耗时" << endl;
         cout << "  show databases          - 显示所有数据库" << endl;
         cout << "  show current            - 显示当前数据库信息" << endl;
+        cout << "  show stats              - 显示各数据库的累计执行统计" << endl;
+        cout << "  show memory             - 按数据库显示记录、字符串、索引、视图与订阅的内存占用" << endl;
+        cout << "  memory limit <软> <硬>  - 设置当前数据库的内存限制（可带 K/M/G），超过硬限制时拒绝写入" << endl;
+        cout << "  memory limit off        - 取消当前数据库的内存限制" << endl;
+        cout << "  show replication        - 显示复制状态" << endl;
+        cout << "  create index on <field> - 在当前数据库的字段上建立有序二级索引" << endl;
+        cout << "  drop index on <field>   - 删除索引" << endl;
+        cout << "  analyze <db>            - 采样重建各列的直方图、高频值与不同值个数，供优化器选择扫描或索引" << endl;
+        cout << "  export <db> arrow <file> - 把数据库导出为 Arrow IPC 文件（列式，可被 pyarrow 等读取）" << endl;
+        cout << "  import <db> arrow <file> - 从 Arrow IPC 文件导入；数据库不存在时按文件的列创建" << endl;
+        cout << "  create view <v> as <locate|aggregate 查询>" << endl;
+        cout << "                          - 在当前数据库上创建物化视图，随增删改增量维护" << endl;
+        cout << "  show view <v>           - 读取视图结果（不扫描源库）" << endl;
+        cout << "  show views              - 显示所有视图" << endl;
+        cout << "  drop view <v>           - 删除视图" << endl;
+        cout << "  ttl <field> <秒数>      - 按时间戳字段设置记录存活时间，到期记录在执行命令前自动删除" << endl;
+        cout << "  ttl off                 - 取消当前数据库的 TTL" << endl;
+        cout << "  expire                  - 立即删除所有到期记录" << endl;
+        cout << "  subscribe where <cond>  - 订阅当前数据库中满足条件的新增/更新记录" << endl;
+        cout << "  poll <id> [n]           - 取出订阅队列中的记录（队列满时新事件被丢弃）" << endl;
+        cout << "  unsubscribe <id>        - 取消订阅" << endl;
+        cout << "  show subscriptions      - 显示所有订阅及其队列状态" << endl;
+        cout << "  replicate start <file>  - 作为主库，把已提交的变更持续写入日志文件" << endl;
+        cout << "  replicate stop          - 停止写复制日志" << endl;
+        cout << "  replica follow <file>   - 作为只读副本，跟随并回放主库的日志文件" << endl;
+        cout << "  replica stop            - 退出只读副本模式" << endl;
         cout << "  help                    - 显示帮助" << endl;
         cout << "  exit                    - 退出程序" << endl;
     }
 
+    // 查询执行方式：直接执行 / 只输出计划 / 执行并输出统计
+    enum QueryMode {
+        QUERY_EXECUTE,
+        QUERY_EXPLAIN,
+        QUERY_PROFILE
+    };
+
+    static void printPlan(const string& operation, const string& condition, const QueryProfile& plan,
+                          const string& kernels = "", const string& optimizerNote = "") {
+        cout << "========== 执行计划 ==========" << endl;
+        cout << "  操作: " << operation << endl;
+        cout << "  条件: " << condition << endl;
+        if (!kernels.empty()) {
+            cout << "  谓词内核: " << kernels << endl;
+        }
+        cout << "  访问路径: " << DatabaseUtils::accessPathName(plan.accessPath) << endl;
+        if (plan.blocksTotal > 0) {
+            cout << "  预计跳过块数: " << plan.blocksSkipped << " / " << plan.blocksTotal << endl;
+        }
+        cout << "  预计扫描行数: " << plan.rowsScanned << endl;
+        cout << "  预计访问字节: " << plan.bytesTouched << endl;
+        if (!optimizerNote.empty()) {
+            cout << optimizerNote << endl;
+        }
+        cout << "================================" << endl;
+    }
+
+    static void printProfile(const string& operation, const QueryProfile& profile) {
+        cout << "========== 执行统计 ==========" << endl;
+        cout << "  操作: " << operation << endl;
+        cout << "  访问路径: " << DatabaseUtils::accessPathName(profile.accessPath) << endl;
+        cout << "  扫描行数: " << profile.rowsScanned << " | 命中行数: " << profile.rowsMatched << endl;
+        // 内存链表不分块，没有可跳过的块
+        if (profile.blocksTotal > 0) {
+            cout << "  跳过块数: " << profile.blocksSkipped << " / " << profile.blocksTotal << endl;
+        }
+        cout << "  访问字节: " << profile.bytesTouched << endl;
+        double total = 0.0;
+        cout << fixed << setprecision(3);
+        for (const auto& op : profile.operatorMillis) {
+            cout << "  算子 " << op.first << ": " << op.second << " ms" << endl;
+            total += op.second;
+        }
+        cout << "  总耗时: " << total << " ms" << endl;
+        cout.unsetf(ios::floatfield);
+        cout << setprecision(6);
+        cout << "================================" << endl;
+    }
+
     static void displayRecords(const vector<RecordNode*>& records) {
         if (records.empty()) {
             cout << "未找到符合条件的记录" << endl;
@@ -825,187 +6783,759 @@ private:
             return false;
         }
 
-        return true;
+        if (value.isNull && op != EQUAL && op != NOT_EQUAL) {
+            cout << "错误：null 只能与 == 或 != 一起使用" << endl;
+            return false;
+        }
+
+        return true;
+    }
+
+    // 解析以 and 连接的多个条件（引号内的 and 不作为分隔符）
+    bool buildConditions(Database* db, const string& rawCondition, vector<Condition>& conditions) {
+        vector<string> terms;
+        string current;
+        char quote = 0;
+        for (size_t i = 0; i < rawCondition.size(); i++) {
+            char ch = rawCondition[i];
+            if (quote != 0) {
+                quote = (ch == quote) ? 0 : quote;
+            } else if (ch == '"' || ch == '\'') {
+                quote = ch;
+            } else if (isspace(static_cast<unsigned char>(ch)) && i + 4 < rawCondition.size()
+                       && toLower(rawCondition.substr(i + 1, 3)) == "and"
+                       && isspace(static_cast<unsigned char>(rawCondition[i + 4]))) {
+                terms.push_back(current);
+                current.clear();
+                i += 4;
+                continue;
+            }
+            current += ch;
+        }
+        terms.push_back(current);
+
+        conditions.clear();
+        for (const auto& term : terms) {
+            Condition parsed;
+            if (!buildCondition(db, term, parsed.fieldName, parsed.op, parsed.value)) {
+                return false;
+            }
+            conditions.push_back(parsed);
+        }
+        return true;
+    }
+
+    bool buildSchema(vector<Field>& schema) {
+        string line;
+    prompt("请输入字段数量：");
+        if (!getline(cin, line)) {
+            return false;
+        }
+        line = trim(line);
+        if (line.empty()) {
+            cout << "错误：字段数量不能为空" << endl;
+            return false;
+        }
+        int count = 0;
+        if (!parseInt(line, count) || count <= 0) {
+            cout << "错误：字段数量必须为正整数" << endl;
+            return false;
+        }
+
+        for (int i = 0; i < count; ++i) {
+            prompt(string("请输入第 ") + to_string(i + 1) + " 个字段的名称：");
+            if (!getline(cin, line)) {
+                return false;
+            }
+            line = trim(line);
+            if (line.empty()) {
+                cout << "错误：字段名称不能为空" << endl;
+                return false;
+            }
+            string fieldName = line;
+
+            prompt(string("请输入字段 ") + fieldName
+                   + " 的类型 (int/int64/double/string/timestamp/bool，末尾加 ? 表示可为空)：");
+            if (!getline(cin, line)) {
+                return false;
+            }
+            line = trim(line);
+            FieldType type;
+            bool nullable = false;
+            if (!parseFieldType(line, type, nullable)) {
+                cout << "错误：字段类型无效" << endl;
+                return false;
+            }
+
+            schema.emplace_back(fieldName, type, nullable);
+        }
+        return true;
+    }
+
+    bool buildRecord(Database* db, map<string, Value>& record) {
+        const vector<Field>& schema = db->getSchema();
+        string line;
+        for (const auto& field : schema) {
+            bool valid = false;
+            while (!valid) {
+                prompt(string("请输入字段 ") + field.name + " 的值：");
+                if (!getline(cin, line)) {
+                    return false;
+                }
+                if (trim(line).empty() && field.type != FIELD_STRING) {
+                    if (field.nullable) {
+                        record[field.name] = DatabaseUtils::makeNullValue(field.type);
+                        valid = true;
+                        continue;
+                    }
+                    cout << "错误：该字段值不能为空" << endl;
+                    continue;
+                }
+                Value value;
+                if (!convertValueByField(field, line, value)) {
+                    cout << "错误：输入的值与字段类型不匹配" << endl;
+                    continue;
+                }
+                record[field.name] = value;
+                valid = true;
+            }
+        }
+        return true;
+    }
+
+    void handleCreateCommand(istringstream& iss) {
+        // create view <视图名> as <查询>：视图只在本地维护，只读副本上也允许创建
+        streampos start = iss.tellg();
+        string first, viewName, asKeyword;
+        if (iss >> first >> viewName >> asKeyword && toLower(first) == "view" && toLower(asKeyword) == "as") {
+            string query;
+            getline(iss, query);
+            handleCreateViewCommand(viewName, trim(query));
+            return;
+        }
+        iss.clear();
+        iss.seekg(start);
+
+        // create index on <字段>：索引同样只在本地维护
+        string onKeyword, fieldName;
+        if (iss >> first >> onKeyword >> fieldName && toLower(first) == "index" && toLower(onKeyword) == "on") {
+            Database* db = dbms.getCurrentDatabase();
+            if (db == nullptr) {
+                cout << "错误：请先使用 open 命令选择数据库" << endl;
+                return;
+            }
+            db->createIndex(fieldName);
+            return;
+        }
+        iss.clear();
+        iss.seekg(start);
+
+        if (rejectIfReadOnly()) {
+            return;
+        }
+
+        string name;
+        if (!(iss >> name)) {
+            prompt("请输入数据库名称：");
+            string line;
+            if (!getline(cin, line)) {
+                return;
+            }
+            name = trim(line);
+        }
+
+        if (name.empty()) {
+            cout << "错误：数据库名称不能为空" << endl;
+            return;
+        }
+
+        // 可选的存储方式：create <name> paged [缓冲池页数] 或 create <name> sharded <键字段> [分片数]
+        StorageOptions options;
+        string storage;
+        if (iss >> storage && toLower(storage) == "sharded") {
+            options.mode = STORAGE_SHARDED;
+            if (!(iss >> options.shardKey)) {
+                cout << "错误：sharded 之后需要指定分片键字段" << endl;
+                return;
+            }
+            string countText;
+            if (iss >> countText) {
+                int count = 0;
+                if (!parseInt(countText, count) || count < 1 || count > 64) {
+                    cout << "错误：分片数必须为 1 到 64 之间的整数" << endl;
+                    return;
+                }
+                options.shardCount = static_cast<size_t>(count);
+            }
+        } else if (!storage.empty()) {
+            if (toLower(storage) != "paged") {
+                cout << "错误：未知的存储方式 " << storage << "，可选 paged 或 sharded" << endl;
+                return;
+            }
+            options.mode = STORAGE_PAGED;
+            string pagesText;
+            if (iss >> pagesText) {
+                int pages = 0;
+                if (!parseInt(pagesText, pages) || pages < 2) {
+                    cout << "错误：缓冲池页数必须为不小于 2 的整数" << endl;
+                    return;
+                }
+                options.bufferPoolPages = static_cast<size_t>(pages);
+            }
+        }
+
+        cout << "[创建] 即将创建数据库 \"" << name << "\"，接下来请依次输入字段数量与字段信息" << endl;
+
+        vector<Field> schema;
+        if (!buildSchema(schema)) {
+            cout << "提示：数据库创建取消" << endl;
+            return;
+        }
+
+        if (dbms.createDatabase(name, schema, options)) {
+            cout << "[创建] 数据库 \"" << name << "\" 已准备就绪，可使用 open " << name
+                 << " 切换并通过 add 添加记录" << endl;
+        }
+    }
+
+    void handleOpenCommand(istringstream& iss) {
+        string name;
+        if (!(iss >> name)) {
+            prompt("请输入要打开的数据库名称：");
+            string line;
+            if (!getline(cin, line)) {
+                return;
+            }
+            name = trim(line);
+        }
+
+        if (name.empty()) {
+            cout << "错误：数据库名称不能为空" << endl;
+            return;
+        }
+
+        cout << "[打开] 正在尝试打开数据库 \"" << name << "\"" << endl;
+        if (dbms.useDatabase(name)) {
+            cout << "[打开] 已切换至 \"" << name << "\"，可执行 add 追加记录或 locate for ... 查询" << endl;
+        }
+    }
+
+    void handleAddCommand() {
+        Database* db = inTransaction ? dbms.findDatabase(transactionDatabase) : dbms.getCurrentDatabase();
+        if (db == nullptr) {
+            cout << "错误：请先使用 open 命令选择数据库" << endl;
+            return;
+        }
+
+        cout << "[追加] 将按当前表结构的字段顺序逐项输入记录值，字符串可直接输入或使用引号" << endl;
+        map<string, Value> record;
+        if (!buildRecord(db, record)) {
+            cout << "提示：追加记录取消" << endl;
+            return;
+        }
+
+        if (inTransaction) {
+            stagedRecords.push_back(std::move(record));
+            cout << "[追加] 已暂存，事务中共 " << stagedRecords.size() << " 条记录，commit 时统一校验并写入" << endl;
+            return;
+        }
+        db->add_element_to_database(record);
+        cout << "[追加] 可继续使用 add 增加更多记录，或 locate for ... 查看符合条件的记录" << endl;
+    }
+
+    // begin | commit | rollback：事务中的 add 只暂存在本地，commit 时整批校验并原子写入
+    void handleTransactionCommand(const string& command) {
+        if (command == "begin") {
+            if (inTransaction) {
+                cout << "错误：已在事务中，请先 commit 或 rollback" << endl;
+                return;
+            }
+            if (rejectIfReadOnly()) {
+                return;
+            }
+            if (dbms.getCurrentDatabase() == nullptr) {
+                cout << "错误：请先使用 open 命令选择数据库" << endl;
+                return;
+            }
+            inTransaction = true;
+            transactionDatabase = dbms.getCurrentDatabaseName();
+            stagedRecords.clear();
+            cout << "事务已开始，之后的 add 将暂存到 commit 时写入数据库 \"" << transactionDatabase << "\"" << endl;
+            return;
+        }
+        if (!inTransaction) {
+            cout << "错误：当前不在事务中" << endl;
+            return;
+        }
+        if (command == "rollback") {
+            cout << "事务已回滚，丢弃 " << stagedRecords.size() << " 条暂存记录" << endl;
+            inTransaction = false;
+            stagedRecords.clear();
+            return;
+        }
+        if (rejectIfReadOnly()) {
+            return;
+        }
+        inTransaction = false;
+        Database* db = dbms.findDatabase(transactionDatabase);
+        if (db == nullptr) {
+            cout << "错误：数据库 \"" << transactionDatabase << "\" 已不存在，事务已回滚" << endl;
+        } else if (db->insertBatch(stagedRecords)) {
+            cout << "事务已提交，写入 " << stagedRecords.size() << " 条记录，数据库 \"" << transactionDatabase
+                 << "\" 目前共 " << db->getRecordCount() << " 条记录" << endl;
+        } else {
+            cout << "事务提交失败，已回滚，数据库未做任何修改" << endl;
+        }
+        stagedRecords.clear();
+    }
+
+    void handleLocateCommand(istringstream& iss, QueryMode mode = QUERY_EXECUTE) {
+        string keyword;
+        if (!(iss >> keyword) || toLower(keyword) != "for") {
+            cout << "错误：locate 命令格式应为 locate for <条件>" << endl;
+            return;
+        }
+
+        string condition;
+        getline(iss, condition);
+        condition = trim(condition);
+        if (condition.empty()) {
+            cout << "错误：缺少定位条件" << endl;
+            return;
+        }
+
+        Database* db = dbms.getCurrentDatabase();
+        if (db == nullptr) {
+            cout << "错误：请先使用 open 命令选择数据库" << endl;
+            return;
+        }
+
+        ScopedTimer parseTimer;
+        vector<Condition> parsed;
+        if (!buildConditions(db, condition, parsed)) {
+            return;
+        }
+
+        if (mode == QUERY_EXPLAIN) {
+            string optimizerNote;
+            QueryProfile plan = db->explainConditions(parsed, optimizerNote);
+            printPlan("locate", condition, plan, PredicateCompiler::describe(parsed), optimizerNote);
+            return;
+        }
+
+        QueryProfile profile;
+        QueryProfile* profilePtr = (mode == QUERY_PROFILE) ? &profile : nullptr;
+        profile.operatorMillis.emplace_back("解析条件", parseTimer.elapsedMillis());
+
+        cout << "[定位] 正在根据条件 \"" << condition << "\" 查找记录" << endl;
+        auto matches = db->locate_elements_with_features(parsed, profilePtr);
+
+        ScopedTimer outputTimer;
+        displayRecords(matches);
+        if (profilePtr != nullptr) {
+            profile.operatorMillis.emplace_back("结果输出", outputTimer.elapsedMillis());
+            printProfile("locate", profile);
+        }
+    }
+
+    // approx_count_distinct <字段> / approx_quantile <字段> <q>：直接读取列摘要，不扫描记录
+    void handleSketchAggregate(Database* db, const string& func, const string& fieldName, istringstream& args,
+                               QueryMode mode) {
+        Field field;
+        if (!findFieldByName(db, fieldName, field)) {
+            cout << "错误：字段 " << fieldName << " 不存在" << endl;
+            return;
+        }
+
+        double q = 0.0;
+        if (func == "approx_quantile") {
+            string qText;
+            if (!(args >> qText) || !parseDoubleValue(qText, q) || q < 0.0 || q > 1.0) {
+                cout << "错误：approx_quantile 需要 0 到 1 之间的分位点，例如 approx_quantile latency 0.99" << endl;
+                return;
+            }
+            if (!ColumnSketches::supportsQuantile(field.type)) {
+                cout << "错误：approx_quantile 仅适用于数值与时间戳字段" << endl;
+                return;
+            }
+        }
+        string extra;
+        if (args >> extra) {
+            cout << "错误：" << func << " 基于全表摘要，不支持 for 条件" << endl;
+            return;
+        }
+
+        if (mode == QUERY_EXPLAIN) {
+            QueryProfile plan;
+            plan.accessPath = ACCESS_SKETCH;
+            printPlan("aggregate", "(全表)", plan);
+            return;
+        }
+
+        ScopedTimer timer;
+        ostringstream result;
+        if (func == "approx_quantile") {
+            Value v;
+            db->approxQuantile(fieldName, q, v);
+            result << func << "(" << fieldName << ", " << q << ") ≈ " << v.toString();
+        } else {
+            double estimate = 0.0;
+            db->approxCountDistinct(fieldName, estimate);
+            result << func << "(" << fieldName << ") ≈ " << llround(estimate);
+        }
+        double millis = timer.elapsedMillis();
+        cout << result.str() << endl;
+        if (mode == QUERY_PROFILE) {
+            QueryProfile profile;
+            profile.accessPath = ACCESS_SKETCH;
+            profile.bytesTouched = db->getSketchBytes();
+            profile.operatorMillis.emplace_back("读取摘要", millis);
+            printProfile("aggregate", profile);
+        }
     }
 
-    bool buildSchema(vector<Field>& schema) {
-        string line;
-    prompt("请输入字段数量：");
-        if (!getline(cin, line)) {
-            return false;
-        }
-        line = trim(line);
-        if (line.empty()) {
-            cout << "错误：字段数量不能为空" << endl;
-            return false;
+    // 函数调用写法（count(*)、approx_quantile(latency, 0.99)）中的括号与逗号换成空格
+    static string normalizeCallSyntax(string text) {
+        size_t close = text.find(')');
+        if (close != string::npos && text.find('(') < close) {
+            for (size_t i = 0; i <= close; i++) {
+                if (text[i] == '(' || text[i] == ')' || text[i] == ',') {
+                    text[i] = ' ';
+                }
+            }
         }
-        int count = 0;
-        if (!parseInt(line, count) || count <= 0) {
-            cout << "错误：字段数量必须为正整数" << endl;
+        return text;
+    }
+
+    // 解析普通聚合的函数名、字段与可选的 for 条件（aggregate 命令与聚合视图共用）
+    // args 指向字段之后的位置；fieldName 为 * 时改为空串，表示 count(*)
+    bool parseAggregateArguments(Database* db, const string& funcText, string& fieldName, istringstream& args,
+                                 AggregateFunction& func, string& condition, vector<Condition>& parsed) {
+        static const map<string, AggregateFunction> functions = {
+            {"count", AGG_COUNT}, {"sum", AGG_SUM}, {"min", AGG_MIN}, {"max", AGG_MAX}, {"avg", AGG_AVG}
+        };
+        auto funcIt = functions.find(toLower(funcText));
+        if (funcIt == functions.end()) {
+            cout << "错误：未知的聚合函数 " << funcText
+                 << "，可选 count/sum/min/max/avg/approx_count_distinct/approx_quantile" << endl;
             return false;
         }
+        func = funcIt->second;
 
-        for (int i = 0; i < count; ++i) {
-            prompt(string("请输入第 ") + to_string(i + 1) + " 个字段的名称：");
-            if (!getline(cin, line)) {
+        if (fieldName == "*") {
+            if (func != AGG_COUNT) {
+                cout << "错误：只有 count 可以使用 *" << endl;
                 return false;
             }
-            line = trim(line);
-            if (line.empty()) {
-                cout << "错误：字段名称不能为空" << endl;
+            fieldName.clear();
+        } else {
+            Field field;
+            if (!findFieldByName(db, fieldName, field)) {
+                cout << "错误：字段 " << fieldName << " 不存在" << endl;
                 return false;
             }
-            string fieldName = line;
+            if ((func == AGG_SUM || func == AGG_AVG) && field.type == FIELD_STRING) {
+                cout << "错误：字符串字段不支持 " << toLower(funcText) << endl;
+                return false;
+            }
+        }
 
-            prompt(string("请输入字段 ") + fieldName + " 的类型 (int/double/string)：");
-            if (!getline(cin, line)) {
+        string keyword;
+        condition.clear();
+        parsed.clear();
+        if (args >> keyword) {
+            if (toLower(keyword) != "for") {
+                cout << "错误：聚合条件应以 for 开头" << endl;
                 return false;
             }
-            line = trim(line);
-            FieldType type;
-            if (!parseFieldType(line, type)) {
-                cout << "错误：字段类型无效" << endl;
+            getline(args, condition);
+            condition = trim(condition);
+            if (condition.empty()) {
+                cout << "错误：缺少聚合条件" << endl;
                 return false;
             }
-
-            schema.emplace_back(fieldName, type);
         }
-        return true;
+        return condition.empty() || buildConditions(db, condition, parsed);
     }
 
-    bool buildRecord(Database* db, map<string, Value>& record) {
-        const vector<Field>& schema = db->getSchema();
-        string line;
-        for (const auto& field : schema) {
-            bool valid = false;
-            while (!valid) {
-                prompt(string("请输入字段 ") + field.name + " 的值：");
-                if (!getline(cin, line)) {
-                    return false;
-                }
-                if (line.empty() && field.type != FIELD_STRING) {
-                    cout << "错误：该字段值不能为空" << endl;
-                    continue;
-                }
-                Value value;
-                if (!convertValueByField(field, line, value)) {
-                    cout << "错误：输入的值与字段类型不匹配" << endl;
-                    continue;
-                }
-                record[field.name] = value;
-                valid = true;
-            }
+    // aggregate <count|sum|min|max|avg> <字段|*> [for <条件>]
+    // aggregate approx_count_distinct <字段> | aggregate approx_quantile <字段> <q>
+    // 也接受函数调用写法，如 count(*)、approx_quantile(latency, 0.99)
+    void handleAggregateCommand(istringstream& iss, QueryMode mode = QUERY_EXECUTE) {
+        string rest;
+        getline(iss, rest);
+        istringstream args(normalizeCallSyntax(rest));
+
+        string funcText, fieldName;
+        if (!(args >> funcText >> fieldName)) {
+            cout << "错误：aggregate 命令格式应为 aggregate <count|sum|min|max|avg> <字段|*> [for <条件>]" << endl;
+            return;
         }
-        return true;
-    }
 
-    void handleCreateCommand(istringstream& iss) {
-        string name;
-        if (!(iss >> name)) {
-            prompt("请输入数据库名称：");
-            string line;
-            if (!getline(cin, line)) {
-                return;
-            }
-            name = trim(line);
+        Database* db = dbms.getCurrentDatabase();
+        if (db == nullptr) {
+            cout << "错误：请先使用 open 命令选择数据库" << endl;
+            return;
         }
 
-        if (name.empty()) {
-            cout << "错误：数据库名称不能为空" << endl;
+        string funcLower = toLower(funcText);
+        if (funcLower == "approx_count_distinct" || funcLower == "approx_quantile") {
+            handleSketchAggregate(db, funcLower, fieldName, args, mode);
             return;
         }
 
-        cout << "[创建] 即将创建数据库 \"" << name << "\"，接下来请依次输入字段数量与字段信息" << endl;
+        ScopedTimer parseTimer;
+        AggregateFunction func;
+        string condition;
+        vector<Condition> parsed;
+        if (!parseAggregateArguments(db, funcText, fieldName, args, func, condition, parsed)) {
+            return;
+        }
 
-        vector<Field> schema;
-        if (!buildSchema(schema)) {
-            cout << "提示：数据库创建取消" << endl;
+        if (mode == QUERY_EXPLAIN) {
+            string optimizerNote;
+            QueryProfile plan = db->explainConditions(parsed, optimizerNote);
+            printPlan("aggregate", condition.empty() ? "(全表)" : condition, plan, PredicateCompiler::describe(parsed),
+                      optimizerNote);
             return;
         }
 
-        if (dbms.createDatabase(name, schema)) {
-            cout << "[创建] 数据库 \"" << name << "\" 已准备就绪，可使用 open " << name
-                 << " 切换并通过 add 添加记录" << endl;
+        QueryProfile profile;
+        QueryProfile* profilePtr = (mode == QUERY_PROFILE) ? &profile : nullptr;
+        profile.operatorMillis.emplace_back("解析条件", parseTimer.elapsedMillis());
+
+        Value result = db->aggregate(func, fieldName, parsed, profilePtr);
+        cout << funcLower << "(" << (fieldName.empty() ? "*" : fieldName) << ") = " << result.toString() << endl;
+        if (profilePtr != nullptr) {
+            printProfile("aggregate", profile);
         }
     }
 
-    void handleOpenCommand(istringstream& iss) {
-        string name;
-        if (!(iss >> name)) {
-            prompt("请输入要打开的数据库名称：");
-            string line;
-            if (!getline(cin, line)) {
-                return;
-            }
-            name = trim(line);
+    // 解析字节数，支持 K/M/G 后缀（1024 进制）
+    static bool parseByteSize(const string& text, long long& outValue) {
+        if (text.empty()) {
+            return false;
+        }
+        long long multiplier = 1;
+        string digits = text;
+        switch (toupper(static_cast<unsigned char>(text.back()))) {
+            case 'K': multiplier = 1LL << 10; break;
+            case 'M': multiplier = 1LL << 20; break;
+            case 'G': multiplier = 1LL << 30; break;
+            default: break;
+        }
+        if (multiplier > 1) {
+            digits.pop_back();
+        }
+        long long value = 0;
+        if (!parseInt64(digits, value) || value < 0) {
+            return false;
         }
+        outValue = value * multiplier;
+        return true;
+    }
 
-        if (name.empty()) {
-            cout << "错误：数据库名称不能为空" << endl;
+    // export <数据库> arrow <文件> | import <数据库> arrow <文件>
+    void handleArrowCommand(istringstream& iss, bool isImport) {
+        if (isImport && rejectIfReadOnly()) {
             return;
         }
-
-        cout << "[打开] 正在尝试打开数据库 \"" << name << "\"" << endl;
-        if (dbms.useDatabase(name)) {
-            cout << "[打开] 已切换至 \"" << name << "\"，可执行 add 追加记录或 locate for ... 查询" << endl;
+        string dbName, format, path;
+        if (!(iss >> dbName >> format >> path) || toLower(format) != "arrow") {
+            cout << "错误：命令格式应为 " << (isImport ? "import" : "export") << " <数据库> arrow <文件>" << endl;
+            return;
+        }
+        if (isImport) {
+            dbms.importArrow(dbName, path);
+        } else {
+            dbms.exportArrow(dbName, path);
         }
     }
 
-    void handleAddCommand() {
+    // memory limit <软限制> <硬限制> | memory limit off：当前数据库的内存限制，只在本进程生效
+    void handleMemoryCommand(istringstream& iss) {
+        string action;
+        if (!(iss >> action) || toLower(action) != "limit") {
+            cout << "错误：memory 命令格式应为 memory limit <软限制> <硬限制> 或 memory limit off" << endl;
+            return;
+        }
         Database* db = dbms.getCurrentDatabase();
         if (db == nullptr) {
             cout << "错误：请先使用 open 命令选择数据库" << endl;
             return;
         }
+        string softText, hardText;
+        if (!(iss >> softText)) {
+            cout << "错误：缺少软限制" << endl;
+            return;
+        }
+        if (toLower(softText) == "off") {
+            db->setMemoryLimits(0, 0);
+            cout << "已取消当前数据库的内存限制" << endl;
+            return;
+        }
+        long long soft = 0;
+        long long hard = 0;
+        if (!parseByteSize(softText, soft) || !(iss >> hardText) || !parseByteSize(hardText, hard)) {
+            cout << "错误：限制必须为非负整数字节数，可带 K/M/G 后缀，例如 memory limit 64M 128M" << endl;
+            return;
+        }
+        if (hard > 0 && soft > hard) {
+            cout << "错误：软限制不能大于硬限制" << endl;
+            return;
+        }
+        db->setMemoryLimits(soft, hard);
+        cout << "已设置内存限制：软 " << soft << " 字节，硬 " << hard << " 字节；当前占用 "
+             << db->memoryUsage().total() << " 字节" << endl;
+    }
 
-        cout << "[追加] 将按当前表结构的字段顺序逐项输入记录值，字符串可直接输入或使用引号" << endl;
-        map<string, Value> record;
-        if (!buildRecord(db, record)) {
-            cout << "提示：追加记录取消" << endl;
+    // ttl <时间戳字段> <秒数> | ttl off：时间戳 + 秒数 早于当前时间的记录在之后的命令执行前被自动删除
+    void handleTtlCommand(istringstream& iss) {
+        if (rejectIfReadOnly()) {
+            return;
+        }
+        Database* db = dbms.getCurrentDatabase();
+        if (db == nullptr) {
+            cout << "错误：请先使用 open 命令选择数据库" << endl;
             return;
         }
 
-        db->add_element_to_database(record);
-        cout << "[追加] 可继续使用 add 增加更多记录，或 locate for ... 查看符合条件的记录" << endl;
+        string fieldName, secondsText;
+        if (!(iss >> fieldName)) {
+            cout << "错误：ttl 命令格式应为 ttl <时间戳字段> <秒数> 或 ttl off" << endl;
+            return;
+        }
+        if (toLower(fieldName) == "off") {
+            db->setTtl("", 0);
+            cout << "已取消当前数据库的 TTL" << endl;
+            return;
+        }
+        long long seconds = 0;
+        if (!(iss >> secondsText) || !parseInt64(secondsText, seconds) || seconds <= 0) {
+            cout << "错误：TTL 秒数必须为正整数" << endl;
+            return;
+        }
+        if (!db->setTtl(fieldName, seconds)) {
+            cout << "错误：字段 " << fieldName << " 不存在或不是 TIMESTAMP 类型" << endl;
+            return;
+        }
+        int removed = dbms.expireDue();
+        cout << "已设置 TTL：" << fieldName << " + " << seconds << " 秒后自动删除";
+        if (removed > 0) {
+            cout << "，已删除 " << removed << " 条到期记录";
+        }
+        cout << endl;
     }
 
-    void handleLocateCommand(istringstream& iss) {
-        string keyword;
-        if (!(iss >> keyword) || toLower(keyword) != "for") {
-            cout << "错误：locate 命令格式应为 locate for <条件>" << endl;
+    // subscribe where <条件>：之后新增或更新的命中记录被推入该订阅的队列，用 poll 取出
+    void handleSubscribeCommand(istringstream& iss) {
+        string keyword, condition;
+        if (!(iss >> keyword) || toLower(keyword) != "where") {
+            cout << "错误：subscribe 命令格式应为 subscribe where <条件>" << endl;
             return;
         }
-
-        string condition;
         getline(iss, condition);
         condition = trim(condition);
-        if (condition.empty()) {
-            cout << "错误：缺少定位条件" << endl;
-            return;
-        }
 
         Database* db = dbms.getCurrentDatabase();
         if (db == nullptr) {
             cout << "错误：请先使用 open 命令选择数据库" << endl;
             return;
         }
+        vector<Condition> parsed;
+        if (!buildConditions(db, condition, parsed)) {
+            return;
+        }
+        int id = dbms.subscribe(condition, parsed);
+        if (id > 0) {
+            cout << "订阅 #" << id << " 已创建，可使用 poll " << id << " 取出命中的新记录" << endl;
+        }
+    }
 
-        string fieldName;
-        Operator op;
-        Value value;
-        if (!buildCondition(db, condition, fieldName, op, value)) {
+    // poll <订阅号> [最多条数]
+    void handlePollCommand(istringstream& iss) {
+        string idText, maxText;
+        int id = 0;
+        if (!(iss >> idText) || !parseInt(idText, id)) {
+            cout << "错误：poll 命令格式应为 poll <订阅号> [最多条数]" << endl;
+            return;
+        }
+        int maxEvents = static_cast<int>(Subscription::QUEUE_CAPACITY);
+        if (iss >> maxText && (!parseInt(maxText, maxEvents) || maxEvents <= 0)) {
+            cout << "错误：最多条数必须为正整数" << endl;
             return;
         }
 
-        cout << "[定位] 正在根据条件 \"" << condition << "\" 查找记录" << endl;
-        auto matches = db->locate_elements_with_features([&](const map<string, Value>& data) {
-            return DatabaseUtils::evaluateCondition(data, fieldName, op, value);
-        });
+        vector<SubscriptionEvent> events;
+        if (!dbms.pollSubscription(id, static_cast<size_t>(maxEvents), events)) {
+            return;
+        }
+        if (events.empty()) {
+            cout << "订阅 #" << id << " 暂无新记录" << endl;
+            return;
+        }
+        cout << "========== 订阅 #" << id << " 的新记录 ==========" << endl;
+        for (const auto& event : events) {
+            cout << (event.isUpdate ? "[更新]" : "[新增]") << " 行号 " << event.rowId << ":";
+            for (const auto& entry : event.record) {
+                cout << " " << entry.first << "=" << entry.second.toString();
+            }
+            cout << endl;
+        }
+        cout << "================================" << endl;
+    }
 
-        displayRecords(matches);
+    // create view <视图名> as locate for <条件>
+    // create view <视图名> as aggregate <func> <字段|*> [for <条件>]
+    void handleCreateViewCommand(const string& viewName, const string& query) {
+        Database* db = dbms.getCurrentDatabase();
+        if (db == nullptr) {
+            cout << "错误：请先使用 open 命令选择视图的源数据库" << endl;
+            return;
+        }
+
+        istringstream args(normalizeCallSyntax(query));
+        string command;
+        args >> command;
+        command = toLower(command);
+        unique_ptr<MaterializedView> view;
+        if (command == "locate") {
+            string keyword, condition;
+            if (!(args >> keyword) || toLower(keyword) != "for") {
+                cout << "错误：视图查询格式应为 locate for <条件>" << endl;
+                return;
+            }
+            getline(args, condition);
+            vector<Condition> parsed;
+            if (!buildConditions(db, condition, parsed)) {
+                return;
+            }
+            view.reset(new MaterializedView(viewName, dbms.getCurrentDatabaseName(), query, parsed,
+                                            MaterializedView::VIEW_LOCATE));
+        } else if (command == "aggregate") {
+            string funcText, fieldName, condition;
+            AggregateFunction func;
+            vector<Condition> parsed;
+            if (!(args >> funcText >> fieldName)) {
+                cout << "错误：视图查询格式应为 aggregate <count|sum|min|max|avg> <字段|*> [for <条件>]" << endl;
+                return;
+            }
+            if (!parseAggregateArguments(db, funcText, fieldName, args, func, condition, parsed)) {
+                return;
+            }
+            view.reset(new MaterializedView(viewName, dbms.getCurrentDatabaseName(), query, parsed,
+                                            MaterializedView::VIEW_AGGREGATE, func, fieldName));
+        } else {
+            cout << "错误：视图只支持 locate 与 aggregate 查询（近似聚合请直接使用 aggregate）" << endl;
+            return;
+        }
+        dbms.createView(viewName, std::move(view));
     }
 
-    void handleDeleteCommand(istringstream& iss) {
+    void handleDeleteCommand(istringstream& iss, QueryMode mode = QUERY_EXECUTE) {
+        if (mode != QUERY_EXPLAIN && rejectIfReadOnly()) {
+            return;
+        }
         string keyword;
         if (!(iss >> keyword) || toLower(keyword) != "for") {
             cout << "错误：delete 命令格式应为 delete for <条件>" << endl;
@@ -1026,22 +7556,33 @@ private:
             return;
         }
 
-        string fieldName;
-        Operator op;
-        Value value;
-        if (!buildCondition(db, condition, fieldName, op, value)) {
+        ScopedTimer parseTimer;
+        vector<Condition> parsed;
+        if (!buildConditions(db, condition, parsed)) {
             return;
         }
 
+        if (mode == QUERY_EXPLAIN) {
+            string optimizerNote;
+            QueryProfile plan = db->explainConditions(parsed, optimizerNote);
+            printPlan("delete", condition, plan, PredicateCompiler::describe(parsed), optimizerNote);
+            return;
+        }
+
+        QueryProfile profile;
+        QueryProfile* profilePtr = (mode == QUERY_PROFILE) ? &profile : nullptr;
+        profile.operatorMillis.emplace_back("解析条件", parseTimer.elapsedMillis());
+
         cout << "[删除] 正在删除满足条件 \"" << condition << "\" 的记录" << endl;
-        db->remove_elements_in_database([&](const map<string, Value>& data) {
-            return DatabaseUtils::evaluateCondition(data, fieldName, op, value);
-        });
+        db->remove_elements_in_database(parsed, profilePtr);
+        if (profilePtr != nullptr) {
+            printProfile("delete", profile);
+        }
         cout << "[删除] 如需确认结果，可使用 locate for ... 或 show current" << endl;
     }
 
 public:
-    explicit CommandParser(DatabaseManagementSystem& system) : dbms(system) {}
+    explicit CommandParser(DatabaseManagementSystem& system) : dbms(system), inTransaction(false) {}
 
     void run() {
         cout << "输入 help 查看命令列表，输入 exit 退出程序" << endl;
@@ -1059,6 +7600,9 @@ public:
 
             string lowered = toLower(line);
             if (lowered == "exit" || lowered == "quit") {
+                if (inTransaction) {
+                    cout << "未提交的事务已回滚，丢弃 " << stagedRecords.size() << " 条暂存记录" << endl;
+                }
                 break;
             }
 
@@ -1066,12 +7610,70 @@ public:
         }
     }
 
-    void handleCommand(const string& commandLine) {
+private:
+    // explain / profile 前缀：后接 locate for ... 或 delete for ...
+    void handleQueryPrefix(istringstream& iss, QueryMode mode) {
+        string command;
+        if (!(iss >> command)) {
+            cout << "错误：explain/profile 之后应接 locate 或 delete 命令" << endl;
+            return;
+        }
+        string lowered = toLower(command);
+        if (lowered == "locate") {
+            handleLocateCommand(iss, mode);
+        } else if (lowered == "delete") {
+            handleDeleteCommand(iss, mode);
+        } else if (lowered == "aggregate") {
+            handleAggregateCommand(iss, mode);
+        } else {
+            cout << "错误：explain/profile 仅支持 locate、delete 与 aggregate 命令" << endl;
+        }
+    }
+
+    // replicate start <file> | replicate stop
+    void handleReplicateCommand(istringstream& iss) {
+        string action;
+        iss >> action;
+        action = toLower(action);
+        if (action == "start") {
+            string path;
+            if (!(iss >> path)) {
+                cout << "错误：replicate start 命令格式应为 replicate start <日志文件>" << endl;
+                return;
+            }
+            dbms.startReplicationLog(path);
+        } else if (action == "stop") {
+            dbms.stopReplicationLog();
+            cout << "已停止写复制日志" << endl;
+        } else {
+            cout << "错误：replicate 命令格式应为 replicate start <日志文件> 或 replicate stop" << endl;
+        }
+    }
+
+    // 写操作在只读副本上被拒绝
+    bool rejectIfReadOnly() const {
+        if (dbms.isReadOnly()) {
+            cout << "错误：当前为只读副本，不接受写操作（可使用 replica stop 退出副本模式）" << endl;
+            return true;
+        }
+        return false;
+    }
+
+    void executeCommand(const string& commandLine) {
         istringstream iss(commandLine);
         string command;
         iss >> command;
         string lowered = toLower(command);
 
+        if (lowered == "add" && rejectIfReadOnly()) {
+            return;
+        }
+        // 事务只覆盖 add，其余写操作会绕过暂存区，在事务中一律拒绝
+        if (inTransaction && (lowered == "delete" || lowered == "import" || lowered == "ttl" || lowered == "expire")) {
+            cout << "错误：事务中只能执行 add 与查询，请先 commit 或 rollback" << endl;
+            return;
+        }
+
         if (lowered == "help") {
             printHelp();
         } else if (lowered == "create") {
@@ -1080,10 +7682,66 @@ public:
             handleOpenCommand(iss);
         } else if (lowered == "add") {
             handleAddCommand();
+        } else if (lowered == "begin" || lowered == "commit" || lowered == "rollback") {
+            handleTransactionCommand(lowered);
         } else if (lowered == "locate") {
             handleLocateCommand(iss);
         } else if (lowered == "delete") {
             handleDeleteCommand(iss);
+        } else if (lowered == "aggregate") {
+            handleAggregateCommand(iss);
+        } else if (lowered == "export" || lowered == "import") {
+            handleArrowCommand(iss, lowered == "import");
+        } else if (lowered == "memory") {
+            handleMemoryCommand(iss);
+        } else if (lowered == "ttl") {
+            handleTtlCommand(iss);
+        } else if (lowered == "expire") {
+            cout << "已删除 " << dbms.expireDue() << " 条到期记录" << endl;
+        } else if (lowered == "subscribe") {
+            handleSubscribeCommand(iss);
+        } else if (lowered == "poll") {
+            handlePollCommand(iss);
+        } else if (lowered == "unsubscribe") {
+            string idText;
+            int id = 0;
+            if (iss >> idText && parseInt(idText, id)) {
+                if (dbms.unsubscribe(id)) {
+                    cout << "订阅 #" << id << " 已取消" << endl;
+                }
+            } else {
+                cout << "错误：unsubscribe 命令格式应为 unsubscribe <订阅号>" << endl;
+            }
+        } else if (lowered == "drop") {
+            string target, viewName, fieldName;
+            iss >> target >> viewName;
+            if (toLower(target) == "view" && !viewName.empty()) {
+                dbms.dropView(viewName);
+            } else if (toLower(target) == "index" && toLower(viewName) == "on" && iss >> fieldName) {
+                Database* db = dbms.getCurrentDatabase();
+                if (db != nullptr) {
+                    if (db->dropIndex(fieldName)) {
+                        cout << "已删除字段 " << fieldName << " 上的索引" << endl;
+                    } else {
+                        cout << "错误：字段 " << fieldName << " 上没有索引" << endl;
+                    }
+                }
+            } else {
+                cout << "错误：drop 命令格式应为 drop view <视图名> 或 drop index on <字段>" << endl;
+            }
+        } else if (lowered == "analyze") {
+            string dbName;
+            if (iss >> dbName) {
+                dbms.analyzeDatabase(dbName);
+            } else {
+                cout << "错误：analyze 命令格式应为 analyze <数据库>" << endl;
+            }
+        } else if (lowered == "replicate") {
+            handleReplicateCommand(iss);
+        } else if (lowered == "explain") {
+            handleQueryPrefix(iss, QUERY_EXPLAIN);
+        } else if (lowered == "profile") {
+            handleQueryPrefix(iss, QUERY_PROFILE);
         } else if (lowered == "show") {
             string target;
             iss >> target;
@@ -1092,6 +7750,23 @@ public:
                 dbms.showAllDatabases();
             } else if (targetLower == "current") {
                 dbms.showCurrentDatabase();
+            } else if (targetLower == "stats") {
+                dbms.showStats();
+            } else if (targetLower == "replication") {
+                dbms.showReplicationStatus();
+            } else if (targetLower == "memory") {
+                dbms.showMemory();
+            } else if (targetLower == "subscriptions") {
+                dbms.showSubscriptions();
+            } else if (targetLower == "views") {
+                dbms.showViews();
+            } else if (targetLower == "view") {
+                string viewName;
+                if (iss >> viewName) {
+                    dbms.showView(viewName);
+                } else {
+                    cout << "错误：show view 命令格式应为 show view <视图名>" << endl;
+                }
             } else {
                 cout << "错误：未知的 show 参数" << endl;
             }
@@ -1099,6 +7774,42 @@ public:
             cout << "错误：未知命令，输入 help 查看帮助" << endl;
         }
     }
+
+public:
+    // 每条命令在持有 dbms 锁的情况下执行，与副本回放线程互斥
+    // replica follow/stop 需要等待回放线程退出，因此先在锁外停止旧线程
+    void handleCommand(const string& commandLine) {
+        istringstream iss(commandLine);
+        string command;
+        string action;
+        iss >> command >> action;
+        if (toLower(command) == "replica") {
+            // 先校验命令，格式错误时不影响正在进行的复制
+            string lowered = toLower(action);
+            string path;
+            if (lowered != "stop" && (lowered != "follow" || !(iss >> path))) {
+                cout << "错误：replica 命令格式应为 replica follow <日志文件> 或 replica stop" << endl;
+                return;
+            }
+            dbms.stopReplica();
+            if (lowered == "stop") {
+                cout << "已退出只读副本模式，本地数据保留为普通数据库" << endl;
+                return;
+            }
+            lock_guard<mutex> lock(dbms.getMutex());
+            dbms.followReplica(path);
+            return;
+        }
+
+        lock_guard<mutex> lock(dbms.getMutex());
+        // 分片线程中的失败（如内存不足）会在之后等待分片时抛出，这里兜底，不让整个进程退出
+        try {
+            dbms.expireDue();
+            executeCommand(commandLine);
+        } catch (const exception& e) {
+            cout << "错误：" << e.what() << endl;
+        }
+    }
 };
 
 int main() {
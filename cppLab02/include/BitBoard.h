@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// 位棋盘辅助函数：第 i 位表示第 i 列，最多支持 64 列
+namespace bitboard {
+
+constexpr int kMaxBoardSize = 64;
+
+// 低 n 位全为 1 的掩码
+constexpr std::uint64_t fullMask(int n) {
+    return n >= 64 ? ~std::uint64_t{0} : ((std::uint64_t{1} << n) - 1);
+}
+
+// 取最低位的 1
+constexpr std::uint64_t lowestBit(std::uint64_t bits) {
+    return bits & (~bits + 1);
+}
+
+// 最低位 1 的下标，bits 不能为 0
+inline int lowestBitIndex(std::uint64_t bits) {
+#if defined(_MSC_VER)
+    unsigned long index = 0;
+    _BitScanForward64(&index, bits);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctzll(bits);
+#endif
+}
+
+// 已放好若干行（占用掩码为 cols/diag1/diag2）时，剩余各行的合法放法数
+inline std::uint64_t countCompletions(std::uint64_t full, std::uint64_t cols, std::uint64_t diag1, std::uint64_t diag2) {
+    if (cols == full) {
+        return 1;
+    }
+    std::uint64_t count = 0;
+    std::uint64_t available = full & ~(cols | diag1 | diag2);
+    while (available != 0) {
+        const std::uint64_t bit = lowestBit(available);
+        available ^= bit;
+        count += countCompletions(full, cols | bit, (diag1 | bit) << 1, (diag2 | bit) >> 1);
+    }
+    return count;
+}
+
+} // namespace bitboard
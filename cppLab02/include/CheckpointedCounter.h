@@ -0,0 +1,76 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "ParallelSolver.h"
+
+struct CheckpointProgress {
+    std::size_t completedTasks{};
+    std::size_t totalTasks{};
+    std::uint64_t countedSoFar{};   // 已完成前缀任务的解数之和
+    double elapsedSeconds{};        // 本次运行已用时间
+    double etaSeconds{-1.0};        // 按本次完成的前缀任务平均耗时估计的剩余时间，尚无法估计时为 -1
+};
+
+using ProgressCallback = std::function<void(const CheckpointProgress&)>;
+
+// 可断点续算的多线程计数：按前缀切分任务，每个工作线程用显式栈搜索并定期发布自己的栈快照，
+// 后台线程按间隔把已完成任务的计数和未完成任务的栈写入检查点文件；再次运行时从文件继续，
+// 已完成的子树不会重算
+class CheckpointedCounter {
+public:
+    // 显式栈的一帧：进入该行时的占用掩码及该行尚未尝试的列
+    struct Frame {
+        std::uint64_t cols{};
+        std::uint64_t diag1{};
+        std::uint64_t diag2{};
+        std::uint64_t available{};
+    };
+
+private:
+    enum class TaskStatus { Pending, Partial, Done };
+
+    struct TaskState {
+        TaskStatus status{TaskStatus::Pending};
+        std::uint64_t count{};       // Done 时为子树解数（未乘权重），Partial 时为快照时已数到的解数
+        std::vector<Frame> frames;   // Partial 时的栈快照
+    };
+
+    int m_boardSize;
+    int m_threadCount;
+    int m_splitDepth;
+    std::string m_path;
+    std::chrono::milliseconds m_interval{std::chrono::seconds(30)};
+    ProgressCallback m_progress;
+    bool m_resumed{false};
+
+    std::vector<PrefixTask> m_tasks;
+    std::vector<TaskState> m_states;
+    std::mutex m_stateMutex;
+    std::condition_variable m_finished;
+    bool m_done{false};
+    std::size_t m_completedAtStart{};
+    std::chrono::steady_clock::time_point m_start;
+
+    bool load();
+    void save();
+    void countTask(std::size_t index);
+    CheckpointProgress snapshotProgress();
+
+public:
+    // threads <= 0 时使用硬件线程数；检查点文件与 n、切分深度不符时 run 抛出 std::runtime_error
+    CheckpointedCounter(int boardSize, std::string checkpointPath, int threads = 0, int splitDepth = 4);
+
+    void setCheckpointInterval(std::chrono::milliseconds interval);
+    // 每次写检查点后及结束时在后台线程调用
+    void setProgressCallback(ProgressCallback callback);
+
+    std::uint64_t run();
+    bool resumed() const;
+};
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// 精确覆盖求解器（Knuth 的 Dancing Links / Algorithm X）。
+// 所有节点放在一组下标数组里（左右上下链接、所属列、所属行），不逐个分配节点；
+// 列分为主列（每个解必须恰好覆盖一次）和次列（至多覆盖一次，如 N 皇后的对角线）。
+class ExactCover {
+private:
+    int m_primaryColumns;
+    int m_columnCount;
+    // 节点 0 为根，节点 1..m_columnCount 为列头，其后为各行的节点
+    std::vector<int> m_left;
+    std::vector<int> m_right;
+    std::vector<int> m_up;
+    std::vector<int> m_down;
+    std::vector<int> m_nodeColumn;
+    std::vector<int> m_nodeRow;
+    std::vector<int> m_size;
+    std::vector<int> m_rowStart;
+    std::vector<bool> m_covered;
+    std::vector<int> m_solution;
+
+    void cover(int column);
+    void uncover(int column);
+    bool search(const std::function<bool(const std::vector<int>&)>& onSolution, std::uint64_t& found);
+
+public:
+    ExactCover(int primaryColumns, int secondaryColumns = 0);
+
+    // columns 为该行覆盖的列号（主列在前 0..primary-1，次列其后），返回行号
+    int addRow(const std::vector<int>& columns);
+    // 预先选中一行（如预置的皇后）；与已选的行冲突时返回 false 且不做任何改动
+    bool select(int row);
+
+    // 依次把每个解（含预选的行）的行号交给 onSolution，回调返回 false 时停止；返回找到的解数
+    std::uint64_t solve(const std::function<bool(const std::vector<int>&)>& onSolution);
+};
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <utility>
+
+#include "BitBoard.h"
+#include "Solution.h"
+
+// 棋盘大小在编译期确定的求解器：行号是模板参数，逐行递归在编译期展开成 N 个函数，
+// 掩码、棋盘都是定长数组，没有运行时的边界计算、堆分配和栈下溢检查。
+// count() 是 constexpr 的，小 N 可在编译期求值
+template <int N>
+class FixedQueen {
+    static_assert(N >= 1 && N <= 32, "FixedQueen supports board sizes 1 to 32");
+
+public:
+    using Board = std::array<int, N>;
+
+    static constexpr std::uint32_t kFull = N == 32 ? ~std::uint32_t{0} : ((std::uint32_t{1} << N) - 1);
+
+    // 第一行只数左半边再乘 2，N 为奇数时加上第一行居中的部分
+    static constexpr std::uint64_t count() {
+        std::uint64_t half = 0;
+        for (int col = 0; col < N / 2; ++col) {
+            half += countFirstColumn(col);
+        }
+        return 2 * half + (N % 2 == 1 ? countFirstColumn(N / 2) : 0);
+    }
+
+    // 运行时计数。与 count() 相同，但列号来自运行时循环，
+    // 编译器不会在编译期尝试把整棵搜索树求值（N 较大时会极大拖慢编译）
+    static std::uint64_t countAll() {
+        std::uint64_t total = 0;
+        for (int col = 0; col < (N + 1) / 2; ++col) {
+            total += (2 * col + 1 == N ? 1 : 2) * countFirstColumn(col);
+        }
+        return total;
+    }
+
+    // 按字典序依次把每个解交给 visit，返回解数
+    template <typename Visitor>
+    static std::uint64_t solve(Visitor&& visit) {
+        Board board{};
+        std::uint64_t found = 0;
+        solveFrom<0>(0, 0, 0, board, visit, found);
+        return found;
+    }
+
+    static std::uint64_t visitAll(const std::function<void(const SolutionView&)>& visitor) {
+        return solve([&visitor](const Board& board) { visitor(SolutionView(board.data(), board.size())); });
+    }
+
+private:
+    static constexpr std::uint64_t countFirstColumn(int col) {
+        const std::uint32_t bit = std::uint32_t{1} << col;
+        return countFrom<1>(bit, bit << 1, bit >> 1);
+    }
+
+    template <int Row>
+    static constexpr std::uint64_t countFrom(std::uint32_t cols, std::uint32_t diag1, std::uint32_t diag2) {
+        if constexpr (Row == N) {
+            return 1;
+        } else {
+            std::uint64_t total = 0;
+            std::uint32_t available = kFull & ~(cols | diag1 | diag2);
+            while (available != 0) {
+                const std::uint32_t bit = available & (~available + 1);
+                available ^= bit;
+                total += countFrom<Row + 1>(cols | bit, (diag1 | bit) << 1, (diag2 | bit) >> 1);
+            }
+            return total;
+        }
+    }
+
+    template <int Row, typename Visitor>
+    static void solveFrom(std::uint32_t cols, std::uint32_t diag1, std::uint32_t diag2, Board& board,
+                          Visitor& visit, std::uint64_t& found) {
+        if constexpr (Row == N) {
+            ++found;
+            visit(static_cast<const Board&>(board));
+        } else {
+            std::uint32_t available = kFull & ~(cols | diag1 | diag2);
+            while (available != 0) {
+                const std::uint32_t bit = available & (~available + 1);
+                available ^= bit;
+                board[Row] = bitboard::lowestBitIndex(bit);
+                solveFrom<Row + 1>(cols | bit, (diag1 | bit) << 1, (diag2 | bit) >> 1, board, visit, found);
+            }
+        }
+    }
+};
+
+// 按运行时的 n 分派到对应的 FixedQueen<n>，n <= kMaxFixedBoardSize 时由 Queen::countSolutions/visitSolutions 自动选用
+namespace fixed_queen {
+
+constexpr int kMaxFixedBoardSize = 16;
+
+using CountFunction = std::uint64_t (*)();
+using VisitFunction = std::uint64_t (*)(const std::function<void(const SolutionView&)>&);
+
+template <std::size_t... Sizes>
+constexpr std::array<CountFunction, sizeof...(Sizes)> makeCountTable(std::index_sequence<Sizes...>) {
+    return {{&FixedQueen<static_cast<int>(Sizes) + 1>::countAll...}};
+}
+
+template <std::size_t... Sizes>
+constexpr std::array<VisitFunction, sizeof...(Sizes)> makeVisitTable(std::index_sequence<Sizes...>) {
+    return {{&FixedQueen<static_cast<int>(Sizes) + 1>::visitAll...}};
+}
+
+inline bool supports(int n) {
+    return n >= 1 && n <= kMaxFixedBoardSize;
+}
+
+inline std::uint64_t count(int n) {
+    static constexpr auto table = makeCountTable(std::make_index_sequence<kMaxFixedBoardSize>{});
+    return table[n - 1]();
+}
+
+inline std::uint64_t visit(int n, const std::function<void(const SolutionView&)>& visitor) {
+    static constexpr auto table = makeVisitTable(std::make_index_sequence<kMaxFixedBoardSize>{});
+    return table[n - 1](visitor);
+}
+
+} // namespace fixed_queen
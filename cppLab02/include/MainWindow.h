@@ -13,6 +13,8 @@ private:
     HWND m_hwnd;
     HWND m_btnSolveRecursive;
     HWND m_btnSolveIterative;
+    HWND m_btnSolveBitboard;
+    HWND m_btnSolveToFile;
     HWND m_btnPrevSolution;
     HWND m_btnNextSolution;
     HWND m_btnReset;
@@ -32,6 +34,8 @@ private:
     void updateStatusLabel();
     void solveRecursive();
     void solveIterative();
+    void solveBitboard();
+    void solveToFile();
     void showPreviousSolution();
     void showNextSolution();
     void reset();
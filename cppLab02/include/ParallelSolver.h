@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// 搜索树前缀：前 depth 行已放好的列号及对应的位掩码
+struct PrefixTask {
+    std::vector<int> columns;
+    std::uint64_t cols{};
+    std::uint64_t diag1{};
+    std::uint64_t diag2{};
+    std::uint64_t weight{1};  // 计数时该子树的解数要乘的倍数（镜像约简时为 2）
+};
+
+// 把搜索树在 splitDepth 行处切成前缀任务，交给工作窃取线程池并行求解；
+// 结果按前缀的字典序合并，与线程数和调度无关，和单线程求解器的顺序一致
+class ParallelSolver {
+private:
+    int m_boardSize;
+    int m_threadCount;
+    int m_splitDepth;
+
+public:
+    // threads <= 0 时使用硬件线程数；splitDepth 会被限制在 [1, n] 内
+    ParallelSolver(int boardSize, int threads = 0, int splitDepth = 3);
+
+    // 按字典序列出前 depth 行的全部合法放置；mirror 为真时只保留镜像约简后的前缀，权重为 2
+    static std::vector<PrefixTask> splitPrefixes(int boardSize, int depth, bool mirror);
+
+    std::uint64_t countSolutions() const;
+    std::vector<std::vector<int>> solveAll() const;
+
+    int getThreadCount() const;
+    int getSplitDepth() const;
+};
@@ -1,21 +1,43 @@
 #pragma once
 
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
 #include <vector>
 
 #include "Solution.h"
+#include "SolutionIndex.h"
+#include "SolutionStore.h"
 #include "Stack.h"
 
+using SolutionVisitor = std::function<void(const SolutionView&)>;
+// 基本解回调：对称类的代表解（8 种变换中字典序最小者）及该类的解数（1、2、4 或 8）
+using FundamentalVisitor = std::function<void(const SolutionView&, int orbitSize)>;
+
 class Queen {
 private:
+    // saveSolution 的去向：保存到 m_solutions、只计数、或交给调用方的回调
+    enum class OutputMode { Store, Count, Visit, Fundamental };
+
     std::vector<int> m_board;
     std::vector<std::vector<int>> m_solutions;
+    std::shared_ptr<const SolutionStore> m_store;  // 非空时当前的解来自映射的解文件，m_solutions 为空
+    std::shared_ptr<const SolutionIndex> m_index;  // 非空时当前的解按序号从索引直接求出
     int m_boardSize;
     std::vector<bool> m_colUsed;
     std::vector<bool> m_diag1Used;
     std::vector<bool> m_diag2Used;
     Stack m_stack;
+    OutputMode m_outputMode;
+    const SolutionVisitor* m_visitor;
+    const FundamentalVisitor* m_fundamentalVisitor;
+    std::vector<int> m_transformed;
+    std::uint64_t m_visitedCount;
+    bool m_fixedQueenEnabled;
 
     void resetState();
+    void clearSolutions();
     bool isValid(int row, int col) const;
     bool isColumnSafe(int col) const;
     bool isDiagonal1Safe(int row, int col) const;
@@ -25,6 +47,12 @@ private:
     void saveSolution();
     void solveRecursiveHelper(int row);
     void solveIterativeHelper();
+    void solveBitboardHelper(int row, std::uint64_t cols, std::uint64_t diag1, std::uint64_t diag2);
+    void runStreaming(OutputMode mode, const SolutionVisitor* visitor);
+    void checkBitboardSize() const;
+    void forEachMirrorPrefix(
+        const std::function<void(int row, std::uint64_t cols, std::uint64_t diag1, std::uint64_t diag2)>& descend);
+    int canonicalOrbitSize();
 
 public:
     explicit Queen(int size = 8);
@@ -32,9 +60,32 @@ public:
 
     void solveRecursive();
     void solveIterative();
+    void solveBitboard();
+
+    // 以下两种模式不保存解，也不影响已保存的解
+    std::uint64_t countSolutions();
+    std::uint64_t visitSolutions(const SolutionVisitor& visitor);
+    // n <= 16 时上面两种模式默认改用编译期展开的 FixedQueen<n>；关闭后总是走运行时的位运算搜索
+    void setFixedQueenEnabled(bool enabled);
+
+    // 利用对称性约简搜索：镜像计数只搜第一行左半边再乘 2；基本解按 D4 对称群每类只给出一个代表
+    std::uint64_t countSolutionsMirror();
+    std::uint64_t visitFundamentalSolutions(const FundamentalVisitor& visitor);
+
+    // 多线程求解：在 splitDepth 行处切分搜索树，threads <= 0 时使用硬件线程数；解的顺序与单线程一致
+    void solveParallel(int threads = 0, int splitDepth = 3);
+    std::uint64_t countSolutionsParallel(int threads = 0, int splitDepth = 3) const;
+
+    // 边求解边把解写入紧凑的解文件，之后的查看都按下标直接读映射的文件，内存占用与解的个数无关
+    std::uint64_t solveToFile(const std::string& path);
+    void openSolutionFile(const std::string& path);
+
+    // 不枚举解，改用缓存前缀解数的序号索引按需求出第 k 个解；cachePath 非空时索引只计算一次并保存
+    void useSolutionIndex(const std::string& cachePath, int cacheDepth = 0);
 
     void displayAllSolutions();
     void displaySolution(int index);
     int getSolutionCount() const;
+    Solution getSolution(int index) const;
     std::vector<Solution> getSolutions() const;
 };
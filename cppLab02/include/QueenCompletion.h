@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "ExactCover.h"
+#include "Queen.h"
+
+// 带预置皇后的 N 皇后补全，化为精确覆盖：每个格子 (r, c) 是一行，
+// 覆盖主列“第 r 行”“第 c 列”和次列“两条对角线”；预置的皇后直接选中
+class QueenCompletion {
+private:
+    int m_boardSize;
+    ExactCover m_cover;
+
+public:
+    // 预置皇后越界或互相攻击时抛出 std::invalid_argument
+    QueenCompletion(int boardSize, const std::vector<std::pair<int, int>>& fixed);
+
+    std::uint64_t count();
+    // 回调拿到的是完整的解（含预置皇后），解的顺序由搜索决定，不保证字典序
+    std::uint64_t visit(const SolutionVisitor& visitor);
+    // 没有补全方案时返回空
+    std::vector<int> findFirst();
+};
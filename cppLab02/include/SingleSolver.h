@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// 只求一个解的大规模求解：显式构造公式 O(n) 直接给出一个解；
+// 有固定皇后时用最小冲突局部搜索，列与两条对角线上的皇后数用计数器维护，每次评估为 O(1)。
+// 结果均为每行皇后的列号，不构造 n×n 棋盘
+class SingleSolver {
+public:
+    // 构造解，n 为 2 或 3 时无解返回空
+    static std::vector<int> findOne(int n);
+    // 不保存整个解，边生成边写入文件；n 为 2 或 3 时返回 false。
+    // 文本格式：第一行为 n，之后每行一个列号（从 0 开始）
+    static bool writeOne(int n, const std::string& path);
+
+    // fixed 为必须保留的 (行, 列)；找不到时返回空。
+    // 固定皇后本身互相攻击或越界时抛出 std::invalid_argument
+    static std::vector<int> minConflicts(int n, const std::vector<std::pair<int, int>>& fixed,
+                                         std::uint64_t seed = 1, std::uint64_t maxSteps = 0);
+};
@@ -1,8 +1,26 @@
 #pragma once
 
+#include <cstddef>
 #include <vector>
 #include <iosfwd>
 
+// 指向求解器内部棋盘的只读视图，不拥有数据，只在回调期间有效；需要保留时调用 toVector
+class SolutionView {
+private:
+    const int* m_data{};
+    std::size_t m_size{};
+
+public:
+    SolutionView(const int* data, std::size_t size) : m_data(data), m_size(size) {}
+    explicit SolutionView(const std::vector<int>& board) : m_data(board.data()), m_size(board.size()) {}
+
+    std::size_t size() const { return m_size; }
+    int operator[](std::size_t row) const { return m_data[row]; }
+    const int* begin() const { return m_data; }
+    const int* end() const { return m_data + m_size; }
+    std::vector<int> toVector() const { return std::vector<int>(begin(), end()); }
+};
+
 class Solution {
 private:
     std::vector<int> m_positions;
@@ -13,6 +31,8 @@ public:
 
     void display() const;
     bool verify() const;
+    // O(n) 检查任意一组列号是否为合法解，不需要先拷贝成 Solution
+    static bool verify(const SolutionView& positions);
     std::vector<int> getPositions() const;
     int getId() const;
 };
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 解的序号索引：缓存前 depth 行每个前缀下的解数（按字典序累加），
+// 据此不枚举全部解即可直接定位第 k 个解（unrank）或求出一个解的序号（rank）。
+// 前缀以下的部分现场用位运算计数，缓存深度越大，单次查询越快、索引越大
+class SolutionIndex {
+private:
+    int m_boardSize;
+    int m_depth;
+    std::vector<std::uint8_t> m_columns;     // 解数非零的前缀，每个 depth 字节，按字典序排列
+    std::vector<std::uint64_t> m_cumulative; // 到每个前缀为止（含）的解数之和
+
+    SolutionIndex(int boardSize, int depth);
+
+    std::size_t prefixCount() const;
+    bool load(const std::string& path);
+    void save(const std::string& path) const;
+
+public:
+    // 默认的前缀条数上限，cacheDepth <= 0 时取不超过该条数的最大深度
+    static const std::size_t kDefaultPrefixBudget = std::size_t{1} << 20;
+
+    // 计算索引；threads <= 0 时使用硬件线程数
+    static SolutionIndex build(int boardSize, int cacheDepth = 0, int threads = 0);
+    // cachePath 中已有匹配的索引时直接读取，否则计算后写入（cachePath 为空则不落盘）
+    static SolutionIndex loadOrBuild(int boardSize, const std::string& cachePath, int cacheDepth = 0,
+                                     int threads = 0);
+
+    int getBoardSize() const;
+    int getDepth() const;
+    std::uint64_t size() const;
+
+    // 字典序第 k 个解（从 0 开始），越界时抛出 std::out_of_range
+    std::vector<int> unrank(std::uint64_t k) const;
+    // 解的字典序序号，不是合法解时抛出 std::invalid_argument
+    std::uint64_t rank(const std::vector<int>& solution) const;
+};
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "Solution.h"
+
+// 紧凑的解文件：32 字节文件头之后是定长记录，每行列号占 ceil(log2 n) 位（至少 1 位），
+// 按行号从低位到高位依次排列，每条记录补齐到整字节。所有整数均为小端序。
+//   0  8 字节 "NQPACK01"
+//   8  uint32 格式版本
+//  12  uint32 棋盘大小 n
+//  16  uint32 每行位数
+//  20  uint32 每条记录字节数
+//  24  uint64 解的个数
+namespace solution_store {
+constexpr std::size_t kHeaderSize = 32;
+
+int bitsPerRow(int boardSize);
+std::size_t strideBytes(int boardSize);
+}
+
+// 逐条追加解并写入文件，finish（或析构）时回填解的个数
+class SolutionStoreWriter {
+private:
+    std::ofstream m_out;
+    std::string m_path;
+    int m_boardSize;
+    std::uint64_t m_count;
+    std::vector<unsigned char> m_record;
+    bool m_finished;
+
+public:
+    SolutionStoreWriter(const std::string& path, int boardSize);
+    ~SolutionStoreWriter();
+
+    SolutionStoreWriter(const SolutionStoreWriter&) = delete;
+    SolutionStoreWriter& operator=(const SolutionStoreWriter&) = delete;
+
+    void append(const SolutionView& solution);
+    void finish();
+    std::uint64_t getCount() const;
+};
+
+// 只读映射整个解文件，按下标 O(1) 定位记录，内存占用与解的个数无关
+class SolutionStore {
+private:
+    const unsigned char* m_data;
+    std::size_t m_size;
+    int m_boardSize;
+    int m_bitsPerRow;
+    std::size_t m_stride;
+    std::uint64_t m_count;
+#ifdef _WIN32
+    void* m_file;
+    void* m_mapping;
+#endif
+
+    void unmap();
+
+public:
+    explicit SolutionStore(const std::string& path);
+    ~SolutionStore();
+
+    SolutionStore(const SolutionStore&) = delete;
+    SolutionStore& operator=(const SolutionStore&) = delete;
+
+    int getBoardSize() const;
+    std::uint64_t size() const;
+
+    // 把第 index 个解解码到 board（长度为 n），越界时抛出 std::out_of_range
+    void read(std::uint64_t index, std::vector<int>& board) const;
+    std::vector<int> get(std::uint64_t index) const;
+};
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// 每个工作线程持有一个任务双端队列：自己从队尾取，空了就从其他线程的队首窃取
+class WorkStealingPool {
+private:
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<std::size_t> tasks;
+    };
+
+    int m_threadCount;
+    std::vector<std::unique_ptr<WorkerQueue>> m_queues;
+
+    bool popLocal(int worker, std::size_t& task);
+    bool steal(int thief, std::size_t& task);
+
+public:
+    // threads <= 0 时使用硬件线程数
+    explicit WorkStealingPool(int threads = 0);
+
+    // 执行编号 0..taskCount-1 的独立任务 task(taskIndex, workerIndex)，全部完成后返回；
+    // 任务抛出的第一个异常在所有线程结束后重新抛出
+    void run(std::size_t taskCount, const std::function<void(std::size_t task, int worker)>& task);
+
+    int getThreadCount() const;
+};
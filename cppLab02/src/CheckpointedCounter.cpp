@@ -0,0 +1,284 @@
+#include "../include/CheckpointedCounter.h"
+#include "../include/BitBoard.h"
+#include "../include/WorkStealingPool.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <exception>
+#include <fstream>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#endif
+
+namespace {
+const char* const kCheckpointMagic = "NQUEENS-CHECKPOINT";
+const int kCheckpointVersion = 1;
+
+// 每搜索这么多步向共享状态发布一次栈快照
+const std::uint64_t kPublishMask = (std::uint64_t{1} << 20) - 1;
+}
+
+CheckpointedCounter::CheckpointedCounter(int boardSize, std::string checkpointPath, int threads, int splitDepth)
+    : m_boardSize(boardSize),
+      m_threadCount(threads > 0 ? threads : std::max(1, static_cast<int>(std::thread::hardware_concurrency()))),
+      m_splitDepth(std::min(std::max(splitDepth, boardSize >= 2 ? 2 : 1), boardSize)),
+      m_path(std::move(checkpointPath)) {
+    if (boardSize < 1 || boardSize > bitboard::kMaxBoardSize) {
+        throw std::out_of_range("checkpointed counter supports board sizes 1 to 64");
+    }
+}
+
+void CheckpointedCounter::setCheckpointInterval(std::chrono::milliseconds interval) {
+    m_interval = interval;
+}
+
+void CheckpointedCounter::setProgressCallback(ProgressCallback callback) {
+    m_progress = std::move(callback);
+}
+
+bool CheckpointedCounter::resumed() const {
+    return m_resumed;
+}
+
+std::uint64_t CheckpointedCounter::run() {
+    m_tasks = ParallelSolver::splitPrefixes(m_boardSize, m_splitDepth, true);
+    m_states.assign(m_tasks.size(), TaskState());
+    m_resumed = load();
+    m_done = false;
+    m_start = std::chrono::steady_clock::now();
+
+    std::vector<std::size_t> pending;
+    for (std::size_t i = 0; i < m_states.size(); ++i) {
+        if (m_states[i].status != TaskStatus::Done) {
+            pending.push_back(i);
+        }
+    }
+    m_completedAtStart = m_states.size() - pending.size();
+
+    std::exception_ptr saveError;
+    std::thread checkpointer([this, &saveError] {
+        std::unique_lock<std::mutex> lock(m_stateMutex);
+        while (!m_finished.wait_for(lock, m_interval, [this] { return m_done; })) {
+            lock.unlock();
+            try {
+                save();
+                if (m_progress) {
+                    m_progress(snapshotProgress());
+                }
+            } catch (...) {
+                saveError = std::current_exception();
+            }
+            lock.lock();
+            if (saveError) {
+                return;
+            }
+        }
+    });
+
+    std::exception_ptr workError;
+    try {
+        WorkStealingPool pool(m_threadCount);
+        pool.run(pending.size(), [this, &pending](std::size_t index, int) {
+            countTask(pending[index]);
+        });
+    } catch (...) {
+        workError = std::current_exception();
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_stateMutex);
+        m_done = true;
+    }
+    m_finished.notify_all();
+    checkpointer.join();
+
+    // 出错时也把已完成的部分写下来，下次从这里继续
+    save();
+    if (workError) {
+        std::rethrow_exception(workError);
+    }
+    if (saveError) {
+        std::rethrow_exception(saveError);
+    }
+    if (m_progress) {
+        m_progress(snapshotProgress());
+    }
+
+    std::uint64_t total = 0;
+    for (std::size_t i = 0; i < m_tasks.size(); ++i) {
+        total += m_tasks[i].weight * m_states[i].count;
+    }
+    return total;
+}
+
+// 用显式栈搜索一个前缀的子树；定期把栈和已数到的解数发布出去，检查点线程据此落盘
+void CheckpointedCounter::countTask(std::size_t index) {
+    const PrefixTask& task = m_tasks[index];
+    const std::uint64_t full = bitboard::fullMask(m_boardSize);
+    std::vector<Frame> frames;
+    std::uint64_t count = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_stateMutex);
+        if (m_states[index].status == TaskStatus::Partial) {
+            frames = m_states[index].frames;
+            count = m_states[index].count;
+        }
+    }
+    if (frames.empty() && count == 0) {
+        if (task.cols == full) {
+            count = 1;
+        } else {
+            frames.push_back({task.cols, task.diag1, task.diag2, full & ~(task.cols | task.diag1 | task.diag2)});
+        }
+    }
+
+    std::uint64_t steps = 0;
+    while (!frames.empty()) {
+        Frame& top = frames.back();
+        if (top.available == 0) {
+            frames.pop_back();
+            continue;
+        }
+        const std::uint64_t bit = bitboard::lowestBit(top.available);
+        top.available ^= bit;
+        Frame next{top.cols | bit, (top.diag1 | bit) << 1, (top.diag2 | bit) >> 1, 0};
+        if (next.cols == full) {
+            ++count;
+        } else {
+            next.available = full & ~(next.cols | next.diag1 | next.diag2);
+            if (next.available != 0) {
+                frames.push_back(next);
+            }
+        }
+
+        if ((++steps & kPublishMask) == 0) {
+            std::lock_guard<std::mutex> lock(m_stateMutex);
+            m_states[index].status = TaskStatus::Partial;
+            m_states[index].count = count;
+            m_states[index].frames = frames;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m_stateMutex);
+    m_states[index].status = TaskStatus::Done;
+    m_states[index].count = count;
+    m_states[index].frames.clear();
+}
+
+CheckpointProgress CheckpointedCounter::snapshotProgress() {
+    CheckpointProgress progress;
+    progress.totalTasks = m_tasks.size();
+    {
+        std::lock_guard<std::mutex> lock(m_stateMutex);
+        for (std::size_t i = 0; i < m_states.size(); ++i) {
+            if (m_states[i].status == TaskStatus::Done) {
+                ++progress.completedTasks;
+                progress.countedSoFar += m_tasks[i].weight * m_states[i].count;
+            }
+        }
+    }
+    progress.elapsedSeconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+    const std::size_t completedThisRun = progress.completedTasks - m_completedAtStart;
+    if (completedThisRun > 0) {
+        progress.etaSeconds = progress.elapsedSeconds / static_cast<double>(completedThisRun)
+                              * static_cast<double>(progress.totalTasks - progress.completedTasks);
+    }
+    return progress;
+}
+
+// 文本格式：
+//   NQUEENS-CHECKPOINT <版本>
+//   <n> <切分深度> <任务数>
+//   D <任务号> <解数>                              已完成
+//   P <任务号> <已数到的解数> <帧数> <cols diag1 diag2 available>...  未完成的栈快照
+// 先写临时文件再原子地替换，写到一半或替换时被中断，磁盘上仍是完整的上一个检查点
+void CheckpointedCounter::save() {
+    std::vector<TaskState> states;
+    {
+        std::lock_guard<std::mutex> lock(m_stateMutex);
+        states = m_states;
+    }
+
+    const std::string temporary = m_path + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::trunc);
+        out << kCheckpointMagic << ' ' << kCheckpointVersion << '\n'
+            << m_boardSize << ' ' << m_splitDepth << ' ' << m_tasks.size() << '\n';
+        for (std::size_t i = 0; i < states.size(); ++i) {
+            const TaskState& state = states[i];
+            if (state.status == TaskStatus::Done) {
+                out << "D " << i << ' ' << state.count << '\n';
+            } else if (state.status == TaskStatus::Partial) {
+                out << "P " << i << ' ' << state.count << ' ' << state.frames.size();
+                for (const Frame& frame : state.frames) {
+                    out << ' ' << frame.cols << ' ' << frame.diag1 << ' ' << frame.diag2 << ' ' << frame.available;
+                }
+                out << '\n';
+            }
+        }
+        out.flush();
+        if (!out) {
+            throw std::runtime_error("failed to write checkpoint file: " + temporary);
+        }
+    }
+    // POSIX 的 rename 会原子地覆盖目标；Windows 上 rename 不覆盖已有文件，改用 MoveFileEx
+#ifdef _WIN32
+    const bool replaced = MoveFileExA(temporary.c_str(), m_path.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    const bool replaced = std::rename(temporary.c_str(), m_path.c_str()) == 0;
+#endif
+    if (!replaced) {
+        throw std::runtime_error("failed to replace checkpoint file: " + m_path);
+    }
+}
+
+bool CheckpointedCounter::load() {
+    std::ifstream in(m_path);
+    if (!in) {
+        return false;
+    }
+
+    std::string magic;
+    int version = 0;
+    int boardSize = 0;
+    int splitDepth = 0;
+    std::size_t taskCount = 0;
+    if (!(in >> magic >> version >> boardSize >> splitDepth >> taskCount) || magic != kCheckpointMagic
+        || version != kCheckpointVersion) {
+        throw std::runtime_error("corrupt checkpoint file: " + m_path);
+    }
+    if (boardSize != m_boardSize || splitDepth != m_splitDepth || taskCount != m_tasks.size()) {
+        throw std::runtime_error("checkpoint file was written for a different board size or split depth: " + m_path);
+    }
+
+    char kind = 0;
+    while (in >> kind) {
+        std::size_t index = 0;
+        TaskState state;
+        if (!(in >> index >> state.count) || index >= taskCount || (kind != 'D' && kind != 'P')) {
+            throw std::runtime_error("corrupt checkpoint file: " + m_path);
+        }
+        state.status = kind == 'D' ? TaskStatus::Done : TaskStatus::Partial;
+        if (kind == 'P') {
+            std::size_t frameCount = 0;
+            if (!(in >> frameCount) || frameCount > static_cast<std::size_t>(m_boardSize)) {
+                throw std::runtime_error("corrupt checkpoint file: " + m_path);
+            }
+            state.frames.resize(frameCount);
+            for (Frame& frame : state.frames) {
+                if (!(in >> frame.cols >> frame.diag1 >> frame.diag2 >> frame.available)) {
+                    throw std::runtime_error("corrupt checkpoint file: " + m_path);
+                }
+            }
+        }
+        m_states[index] = std::move(state);
+    }
+    return true;
+}
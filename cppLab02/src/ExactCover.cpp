@@ -0,0 +1,139 @@
+#include "../include/ExactCover.h"
+
+#include <stdexcept>
+
+ExactCover::ExactCover(int primaryColumns, int secondaryColumns)
+    : m_primaryColumns(primaryColumns),
+      m_columnCount(primaryColumns + secondaryColumns),
+      m_size(primaryColumns + secondaryColumns, 0),
+      m_covered(primaryColumns + secondaryColumns, false) {
+    if (primaryColumns < 0 || secondaryColumns < 0) {
+        throw std::invalid_argument("column counts must not be negative");
+    }
+    // 只有主列挂在根的横向链表上，搜索时不会选中次列
+    for (int node = 0; node <= m_columnCount; ++node) {
+        const bool linked = node <= m_primaryColumns;
+        m_left.push_back(linked ? (node == 0 ? m_primaryColumns : node - 1) : node);
+        m_right.push_back(linked ? (node == m_primaryColumns ? 0 : node + 1) : node);
+        m_up.push_back(node);
+        m_down.push_back(node);
+        m_nodeColumn.push_back(node - 1);
+        m_nodeRow.push_back(-1);
+    }
+}
+
+int ExactCover::addRow(const std::vector<int>& columns) {
+    if (columns.empty()) {
+        throw std::invalid_argument("row must cover at least one column");
+    }
+    const int row = static_cast<int>(m_rowStart.size());
+    const int first = static_cast<int>(m_left.size());
+    m_rowStart.push_back(first);
+    for (std::size_t i = 0; i < columns.size(); ++i) {
+        const int column = columns[i];
+        if (column < 0 || column >= m_columnCount) {
+            throw std::out_of_range("column index out of range");
+        }
+        const int node = first + static_cast<int>(i);
+        const int header = column + 1;
+        m_left.push_back(i == 0 ? first + static_cast<int>(columns.size()) - 1 : node - 1);
+        m_right.push_back(i + 1 == columns.size() ? first : node + 1);
+        m_up.push_back(m_up[header]);
+        m_down.push_back(header);
+        m_down[m_up[header]] = node;
+        m_up[header] = node;
+        m_nodeColumn.push_back(column);
+        m_nodeRow.push_back(row);
+        ++m_size[column];
+    }
+    return row;
+}
+
+bool ExactCover::select(int row) {
+    if (row < 0 || row >= static_cast<int>(m_rowStart.size())) {
+        throw std::out_of_range("row index out of range");
+    }
+    const int first = m_rowStart[row];
+    int node = first;
+    do {
+        if (m_covered[m_nodeColumn[node]]) {
+            return false;
+        }
+        node = m_right[node];
+    } while (node != first);
+    do {
+        cover(m_nodeColumn[node]);
+        node = m_right[node];
+    } while (node != first);
+    m_solution.push_back(row);
+    return true;
+}
+
+void ExactCover::cover(int column) {
+    const int header = column + 1;
+    m_covered[column] = true;
+    m_left[m_right[header]] = m_left[header];
+    m_right[m_left[header]] = m_right[header];
+    for (int i = m_down[header]; i != header; i = m_down[i]) {
+        for (int j = m_right[i]; j != i; j = m_right[j]) {
+            m_up[m_down[j]] = m_up[j];
+            m_down[m_up[j]] = m_down[j];
+            --m_size[m_nodeColumn[j]];
+        }
+    }
+}
+
+void ExactCover::uncover(int column) {
+    const int header = column + 1;
+    for (int i = m_up[header]; i != header; i = m_up[i]) {
+        for (int j = m_left[i]; j != i; j = m_left[j]) {
+            ++m_size[m_nodeColumn[j]];
+            m_up[m_down[j]] = j;
+            m_down[m_up[j]] = j;
+        }
+    }
+    m_left[m_right[header]] = header;
+    m_right[m_left[header]] = header;
+    m_covered[column] = false;
+}
+
+std::uint64_t ExactCover::solve(const std::function<bool(const std::vector<int>&)>& onSolution) {
+    std::uint64_t found = 0;
+    search(onSolution, found);
+    return found;
+}
+
+// 每层选候选行最少的主列，依次尝试覆盖它的每一行；返回 false 表示调用方要求停止
+bool ExactCover::search(const std::function<bool(const std::vector<int>&)>& onSolution, std::uint64_t& found) {
+    if (m_right[0] == 0) {
+        ++found;
+        return onSolution(m_solution);
+    }
+
+    int best = m_right[0];
+    for (int header = m_right[best]; header != 0; header = m_right[header]) {
+        if (m_size[header - 1] < m_size[best - 1]) {
+            best = header;
+        }
+    }
+    if (m_size[best - 1] == 0) {
+        return true;
+    }
+
+    const int column = best - 1;
+    bool keepGoing = true;
+    cover(column);
+    for (int node = m_down[best]; node != best && keepGoing; node = m_down[node]) {
+        m_solution.push_back(m_nodeRow[node]);
+        for (int j = m_right[node]; j != node; j = m_right[j]) {
+            cover(m_nodeColumn[j]);
+        }
+        keepGoing = search(onSolution, found);
+        for (int j = m_left[node]; j != node; j = m_left[j]) {
+            uncover(m_nodeColumn[j]);
+        }
+        m_solution.pop_back();
+    }
+    uncover(column);
+    return keepGoing;
+}
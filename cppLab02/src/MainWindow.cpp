@@ -3,17 +3,23 @@
 #include "../include/ChessBoardWidget.h"
 #include <sstream>
 #include <iomanip>
+#include <stdexcept>
+#include <string>
 
 #define ID_BTN_SOLVE_RECURSIVE 101
 #define ID_BTN_SOLVE_ITERATIVE 102
 #define ID_BTN_PREV_SOLUTION 103
 #define ID_BTN_NEXT_SOLUTION 104
 #define ID_BTN_RESET 105
+#define ID_BTN_SOLVE_BITBOARD 106
+#define ID_BTN_SOLVE_TO_FILE 107
 
 MainWindow::MainWindow()
     : m_hwnd(nullptr)
     , m_btnSolveRecursive(nullptr)
     , m_btnSolveIterative(nullptr)
+    , m_btnSolveBitboard(nullptr)
+    , m_btnSolveToFile(nullptr)
     , m_btnPrevSolution(nullptr)
     , m_btnNextSolution(nullptr)
     , m_btnReset(nullptr)
@@ -117,6 +123,20 @@ void MainWindow::onCreate() {
         m_hwnd, reinterpret_cast<HMENU>(ID_BTN_SOLVE_ITERATIVE), hInstance, nullptr
     );
 
+    m_btnSolveBitboard = CreateWindowW(
+        L"BUTTON", L"位运算求解",
+        WS_TABSTOP | WS_VISIBLE | WS_CHILD | BS_PUSHBUTTON,
+        420, 520, 120, 35,
+        m_hwnd, reinterpret_cast<HMENU>(ID_BTN_SOLVE_BITBOARD), hInstance, nullptr
+    );
+
+    m_btnSolveToFile = CreateWindowW(
+        L"BUTTON", L"求解到文件",
+        WS_TABSTOP | WS_VISIBLE | WS_CHILD | BS_PUSHBUTTON,
+        420, 570, 120, 35,
+        m_hwnd, reinterpret_cast<HMENU>(ID_BTN_SOLVE_TO_FILE), hInstance, nullptr
+    );
+
     m_btnPrevSolution = CreateWindowW(
         L"BUTTON", L"← 上一个",
         WS_TABSTOP | WS_VISIBLE | WS_CHILD | BS_PUSHBUTTON,
@@ -166,6 +186,8 @@ void MainWindow::onCreate() {
 
     SendMessage(m_btnSolveRecursive, WM_SETFONT, reinterpret_cast<WPARAM>(hFont), TRUE);
     SendMessage(m_btnSolveIterative, WM_SETFONT, reinterpret_cast<WPARAM>(hFont), TRUE);
+    SendMessage(m_btnSolveBitboard, WM_SETFONT, reinterpret_cast<WPARAM>(hFont), TRUE);
+    SendMessage(m_btnSolveToFile, WM_SETFONT, reinterpret_cast<WPARAM>(hFont), TRUE);
     SendMessage(m_btnPrevSolution, WM_SETFONT, reinterpret_cast<WPARAM>(hFont), TRUE);
     SendMessage(m_btnNextSolution, WM_SETFONT, reinterpret_cast<WPARAM>(hFont), TRUE);
     SendMessage(m_btnReset, WM_SETFONT, reinterpret_cast<WPARAM>(hFont), TRUE);
@@ -185,6 +207,12 @@ void MainWindow::onCommand(WPARAM wParam) {
     case ID_BTN_SOLVE_ITERATIVE:
         solveIterative();
         break;
+    case ID_BTN_SOLVE_BITBOARD:
+        solveBitboard();
+        break;
+    case ID_BTN_SOLVE_TO_FILE:
+        solveToFile();
+        break;
     case ID_BTN_PREV_SOLUTION:
         showPreviousSolution();
         break;
@@ -248,6 +276,46 @@ void MainWindow::solveIterative() {
     EnableWindow(m_btnNextSolution, m_queen->getSolutionCount() > 1);
 }
 
+void MainWindow::solveBitboard() {
+    SetWindowTextW(m_lblStatus, L"状态: 正在使用位运算算法求解...");
+    UpdateWindow(m_hwnd);
+
+    m_queen->solveBitboard();
+    m_currentSolutionIndex = 0;
+
+    updateDisplay();
+    updateStatusLabel();
+
+    std::wstringstream ss;
+    ss << L"状态: 位运算算法求解完成，共找到 " << m_queen->getSolutionCount() << L" 个解";
+    SetWindowTextW(m_lblStatus, ss.str().c_str());
+
+    EnableWindow(m_btnPrevSolution, m_queen->getSolutionCount() > 1);
+    EnableWindow(m_btnNextSolution, m_queen->getSolutionCount() > 1);
+}
+
+// 解写入文件后，上一个/下一个按下标直接读映射的文件
+void MainWindow::solveToFile() {
+    SetWindowTextW(m_lblStatus, L"状态: 正在求解并写入解文件...");
+    UpdateWindow(m_hwnd);
+
+    std::wstringstream ss;
+    try {
+        m_queen->solveToFile("queens_" + std::to_string(m_boardSize) + ".bin");
+        ss << L"状态: 求解完成，共 " << m_queen->getSolutionCount() << L" 个解已写入文件";
+    } catch (const std::exception&) {
+        ss << L"状态: 写入解文件失败";
+    }
+    m_currentSolutionIndex = 0;
+
+    updateDisplay();
+    updateStatusLabel();
+    SetWindowTextW(m_lblStatus, ss.str().c_str());
+
+    EnableWindow(m_btnPrevSolution, m_queen->getSolutionCount() > 1);
+    EnableWindow(m_btnNextSolution, m_queen->getSolutionCount() > 1);
+}
+
 void MainWindow::showPreviousSolution() {
     if (m_currentSolutionIndex > 0) {
         m_currentSolutionIndex--;
@@ -279,12 +347,9 @@ void MainWindow::reset() {
 }
 
 void MainWindow::updateDisplay() {
-    if (m_queen->getSolutionCount() > 0) {
-        auto solutions = m_queen->getSolutions();
-        if (m_currentSolutionIndex < static_cast<int>(solutions.size())) {
-            m_chessBoard->setBoard(solutions[m_currentSolutionIndex].getPositions());
-            InvalidateRect(m_hwnd, nullptr, TRUE);
-        }
+    if (m_currentSolutionIndex < m_queen->getSolutionCount()) {
+        m_chessBoard->setBoard(m_queen->getSolution(m_currentSolutionIndex).getPositions());
+        InvalidateRect(m_hwnd, nullptr, TRUE);
     }
 }
 
@@ -0,0 +1,131 @@
+#include "../include/ParallelSolver.h"
+#include "../include/BitBoard.h"
+#include "../include/WorkStealingPool.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+void collectPrefixes(int depth, std::uint64_t full, std::uint64_t cols, std::uint64_t diag1, std::uint64_t diag2,
+                     std::vector<int>& columns, std::vector<PrefixTask>& out) {
+    if (static_cast<int>(columns.size()) == depth) {
+        out.push_back({columns, cols, diag1, diag2, 1});
+        return;
+    }
+    std::uint64_t available = full & ~(cols | diag1 | diag2);
+    while (available != 0) {
+        const std::uint64_t bit = bitboard::lowestBit(available);
+        available ^= bit;
+        columns.push_back(bitboard::lowestBitIndex(bit));
+        collectPrefixes(depth, full, cols | bit, (diag1 | bit) << 1, (diag2 | bit) >> 1, columns, out);
+        columns.pop_back();
+    }
+}
+
+// 从第 row 行起枚举，每得到一个解就把整块棋盘追加到 out（每 n 个数一个解）
+void enumerateFrom(int row, std::uint64_t full, std::uint64_t cols, std::uint64_t diag1, std::uint64_t diag2,
+                   std::vector<int>& board, std::vector<int>& out) {
+    if (cols == full) {
+        out.insert(out.end(), board.begin(), board.end());
+        return;
+    }
+    std::uint64_t available = full & ~(cols | diag1 | diag2);
+    while (available != 0) {
+        const std::uint64_t bit = bitboard::lowestBit(available);
+        available ^= bit;
+        board[row] = bitboard::lowestBitIndex(bit);
+        enumerateFrom(row + 1, full, cols | bit, (diag1 | bit) << 1, (diag2 | bit) >> 1, board, out);
+    }
+}
+}
+
+ParallelSolver::ParallelSolver(int boardSize, int threads, int splitDepth)
+    : m_boardSize(boardSize),
+      m_threadCount(threads > 0 ? threads : std::max(1, static_cast<int>(std::thread::hardware_concurrency()))),
+      m_splitDepth(std::min(std::max(splitDepth, 1), std::max(boardSize, 1))) {
+    if (boardSize < 1 || boardSize > bitboard::kMaxBoardSize) {
+        throw std::out_of_range("parallel solver supports board sizes 1 to 64");
+    }
+}
+
+// 镜像约简与 Queen::countSolutionsMirror 相同：第一行取左半边；n 为奇数且第一行居中时第二行取左半边，
+// 因此这种情况下至少要切两行
+std::vector<PrefixTask> ParallelSolver::splitPrefixes(int boardSize, int depth, bool mirror) {
+    mirror = mirror && boardSize >= 2;
+    depth = std::min(std::max(depth, mirror ? 2 : 1), boardSize);
+
+    std::vector<PrefixTask> prefixes;
+    std::vector<int> columns;
+    collectPrefixes(depth, bitboard::fullMask(boardSize), 0, 0, 0, columns, prefixes);
+    if (!mirror) {
+        return prefixes;
+    }
+
+    const int half = boardSize / 2;
+    std::vector<PrefixTask> reduced;
+    for (PrefixTask& prefix : prefixes) {
+        const bool leftHalf = prefix.columns[0] < half;
+        const bool middle = boardSize % 2 == 1 && prefix.columns[0] == half && prefix.columns[1] < half;
+        if (leftHalf || middle) {
+            prefix.weight = 2;
+            reduced.push_back(std::move(prefix));
+        }
+    }
+    return reduced;
+}
+
+std::uint64_t ParallelSolver::countSolutions() const {
+    const std::vector<PrefixTask> tasks = splitPrefixes(m_boardSize, m_splitDepth, true);
+    const std::uint64_t full = bitboard::fullMask(m_boardSize);
+    std::vector<std::uint64_t> counts(tasks.size(), 0);
+
+    WorkStealingPool pool(m_threadCount);
+    pool.run(tasks.size(), [&](std::size_t index, int) {
+        const PrefixTask& task = tasks[index];
+        counts[index] = task.weight * bitboard::countCompletions(full, task.cols, task.diag1, task.diag2);
+    });
+
+    std::uint64_t total = 0;
+    for (std::uint64_t count : counts) {
+        total += count;
+    }
+    return total;
+}
+
+std::vector<std::vector<int>> ParallelSolver::solveAll() const {
+    const std::vector<PrefixTask> tasks = splitPrefixes(m_boardSize, m_splitDepth, false);
+    const std::uint64_t full = bitboard::fullMask(m_boardSize);
+    std::vector<std::vector<int>> buffers(tasks.size());
+    std::vector<std::vector<int>> boards(m_threadCount, std::vector<int>(m_boardSize, -1));
+
+    WorkStealingPool pool(m_threadCount);
+    pool.run(tasks.size(), [&](std::size_t index, int worker) {
+        const PrefixTask& task = tasks[index];
+        std::vector<int>& board = boards[worker];
+        std::copy(task.columns.begin(), task.columns.end(), board.begin());
+        enumerateFrom(static_cast<int>(task.columns.size()), full, task.cols, task.diag1, task.diag2, board,
+                      buffers[index]);
+    });
+
+    std::size_t total = 0;
+    for (const std::vector<int>& buffer : buffers) {
+        total += buffer.size() / m_boardSize;
+    }
+    std::vector<std::vector<int>> solutions;
+    solutions.reserve(total);
+    for (const std::vector<int>& buffer : buffers) {
+        for (std::size_t offset = 0; offset < buffer.size(); offset += m_boardSize) {
+            solutions.emplace_back(buffer.begin() + offset, buffer.begin() + offset + m_boardSize);
+        }
+    }
+    return solutions;
+}
+
+int ParallelSolver::getThreadCount() const {
+    return m_threadCount;
+}
+
+int ParallelSolver::getSplitDepth() const {
+    return m_splitDepth;
+}
@@ -1,7 +1,11 @@
 #include "../include/Queen.h"
+#include "../include/BitBoard.h"
+#include "../include/FixedQueen.h"
+#include "../include/ParallelSolver.h"
 
 #include <algorithm>
 #include <iostream>
+#include <limits>
 #include <stdexcept>
 
 Queen::Queen(int size)
@@ -9,51 +13,183 @@ Queen::Queen(int size)
       m_boardSize(size),
       m_colUsed(size, false),
     m_diag1Used(2 * size - 1, false),
-    m_diag2Used(2 * size - 1, false) {}
+    m_diag2Used(2 * size - 1, false),
+    m_outputMode(OutputMode::Store),
+    m_visitor(nullptr),
+    m_fundamentalVisitor(nullptr),
+    m_visitedCount(0),
+    m_fixedQueenEnabled(true) {}
 
 Queen::~Queen() = default;
 
 void Queen::solveRecursive() {
-    m_solutions.clear();
+    clearSolutions();
     resetState();
     solveRecursiveHelper(0);
 }
 
 void Queen::solveIterative() {
-    m_solutions.clear();
+    clearSolutions();
     resetState();
     solveIterativeHelper();
 }
 
+void Queen::solveBitboard() {
+    checkBitboardSize();
+    clearSolutions();
+    resetState();
+    solveBitboardHelper(0, 0, 0, 0);
+}
+
+// 小棋盘自动改用编译期展开的 FixedQueen<n>
+std::uint64_t Queen::countSolutions() {
+    if (m_fixedQueenEnabled && fixed_queen::supports(m_boardSize)) {
+        return fixed_queen::count(m_boardSize);
+    }
+    if (m_boardSize <= bitboard::kMaxBoardSize) {
+        return bitboard::countCompletions(bitboard::fullMask(m_boardSize), 0, 0, 0);
+    }
+    runStreaming(OutputMode::Count, nullptr);
+    return m_visitedCount;
+}
+
+std::uint64_t Queen::visitSolutions(const SolutionVisitor& visitor) {
+    if (m_fixedQueenEnabled && fixed_queen::supports(m_boardSize)) {
+        return fixed_queen::visit(m_boardSize, visitor);
+    }
+    runStreaming(OutputMode::Visit, &visitor);
+    return m_visitedCount;
+}
+
+void Queen::setFixedQueenEnabled(bool enabled) {
+    m_fixedQueenEnabled = enabled;
+}
+
+// 镜像 (c -> n-1-c) 把第一行在左半边的解与右半边的解一一对应；
+// n 为奇数且第一行居中时，两者的区别落到第二行，第二行同样只取左半边
+std::uint64_t Queen::countSolutionsMirror() {
+    checkBitboardSize();
+    if (m_boardSize == 1) {
+        return 1;
+    }
+    std::uint64_t half = 0;
+    forEachMirrorPrefix([this, &half](int, std::uint64_t cols, std::uint64_t diag1, std::uint64_t diag2) {
+        half += bitboard::countCompletions(bitboard::fullMask(m_boardSize), cols, diag1, diag2);
+    });
+    return 2 * half;
+}
+
+std::uint64_t Queen::visitFundamentalSolutions(const FundamentalVisitor& visitor) {
+    checkBitboardSize();
+    struct ModeGuard {
+        Queen& queen;
+        ~ModeGuard() {
+            queen.m_outputMode = OutputMode::Store;
+            queen.m_fundamentalVisitor = nullptr;
+        }
+    } guard{*this};
+
+    m_outputMode = OutputMode::Fundamental;
+    m_fundamentalVisitor = &visitor;
+    m_visitedCount = 0;
+    m_transformed.assign(m_boardSize, 0);
+    resetState();
+    forEachMirrorPrefix([this](int row, std::uint64_t cols, std::uint64_t diag1, std::uint64_t diag2) {
+        solveBitboardHelper(row, cols, diag1, diag2);
+    });
+    return m_visitedCount;
+}
+
+void Queen::solveParallel(int threads, int splitDepth) {
+    checkBitboardSize();
+    clearSolutions();
+    m_solutions = ParallelSolver(m_boardSize, threads, splitDepth).solveAll();
+    resetState();
+}
+
+std::uint64_t Queen::countSolutionsParallel(int threads, int splitDepth) const {
+    checkBitboardSize();
+    return ParallelSolver(m_boardSize, threads, splitDepth).countSolutions();
+}
+
+std::uint64_t Queen::solveToFile(const std::string& path) {
+    clearSolutions();
+    {
+        SolutionStoreWriter writer(path, m_boardSize);
+        visitSolutions([&writer](const SolutionView& solution) { writer.append(solution); });
+        writer.finish();
+    }
+    openSolutionFile(path);
+    return m_store->size();
+}
+
+void Queen::openSolutionFile(const std::string& path) {
+    auto store = std::make_shared<const SolutionStore>(path);
+    if (store->getBoardSize() != m_boardSize) {
+        throw std::invalid_argument("solution file was written for a different board size");
+    }
+    clearSolutions();
+    m_store = std::move(store);
+}
+
+void Queen::useSolutionIndex(const std::string& cachePath, int cacheDepth) {
+    checkBitboardSize();
+    auto index = std::make_shared<const SolutionIndex>(SolutionIndex::loadOrBuild(m_boardSize, cachePath, cacheDepth));
+    clearSolutions();
+    m_index = std::move(index);
+}
+
 void Queen::displayAllSolutions() {
-    const int count = static_cast<int>(m_solutions.size());
+    const int count = getSolutionCount();
     for (int i = 0; i < count; ++i) {
-        Solution sol(m_solutions[i], i + 1);
-        sol.display();
+        getSolution(i).display();
     }
 }
 
 void Queen::displaySolution(int index) {
-    if (index < 0 || index >= static_cast<int>(m_solutions.size())) {
-        throw std::out_of_range("solution index out of range");
-    }
-    Solution sol(m_solutions[index], index + 1);
-    sol.display();
+    getSolution(index).display();
 }
 
+// 序号索引下的解数可能超出 int，超出部分无法按下标访问
 int Queen::getSolutionCount() const {
+    if (m_index) {
+        return static_cast<int>(std::min<std::uint64_t>(m_index->size(), std::numeric_limits<int>::max()));
+    }
+    if (m_store) {
+        return static_cast<int>(std::min<std::uint64_t>(m_store->size(), std::numeric_limits<int>::max()));
+    }
     return static_cast<int>(m_solutions.size());
 }
 
+Solution Queen::getSolution(int index) const {
+    if (index < 0 || index >= getSolutionCount()) {
+        throw std::out_of_range("solution index out of range");
+    }
+    if (m_index) {
+        return Solution(m_index->unrank(static_cast<std::uint64_t>(index)), index + 1);
+    }
+    if (m_store) {
+        return Solution(m_store->get(static_cast<std::uint64_t>(index)), index + 1);
+    }
+    return Solution(m_solutions[index], index + 1);
+}
+
 std::vector<Solution> Queen::getSolutions() const {
+    const int count = getSolutionCount();
     std::vector<Solution> result;
-    result.reserve(m_solutions.size());
-    for (std::size_t i = 0; i < m_solutions.size(); ++i) {
-        result.emplace_back(m_solutions[i], static_cast<int>(i) + 1);
+    result.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        result.push_back(getSolution(i));
     }
     return result;
 }
 
+void Queen::clearSolutions() {
+    m_solutions.clear();
+    m_store.reset();
+    m_index.reset();
+}
+
 void Queen::resetState() {
     std::fill(m_board.begin(), m_board.end(), -1);
     std::fill(m_colUsed.begin(), m_colUsed.end(), false);
@@ -93,7 +229,111 @@ void Queen::removeQueen(int row, int col) {
 }
 
 void Queen::saveSolution() {
-    m_solutions.push_back(m_board);
+    switch (m_outputMode) {
+    case OutputMode::Store:
+        m_solutions.push_back(m_board);
+        break;
+    case OutputMode::Count:
+        ++m_visitedCount;
+        break;
+    case OutputMode::Visit:
+        ++m_visitedCount;
+        (*m_visitor)(SolutionView(m_board));
+        break;
+    case OutputMode::Fundamental:
+        if (const int orbitSize = canonicalOrbitSize()) {
+            ++m_visitedCount;
+            (*m_fundamentalVisitor)(SolutionView(m_board), orbitSize);
+        }
+        break;
+    }
+}
+
+void Queen::checkBitboardSize() const {
+    if (m_boardSize > bitboard::kMaxBoardSize) {
+        throw std::out_of_range("bitboard solver supports at most 64 columns");
+    }
+}
+
+// 依次给出镜像约简后的搜索起点（已放好的行数及占用掩码），前缀行写入 m_board；
+// 每个对称类中字典序最小的解都落在这些起点之下
+void Queen::forEachMirrorPrefix(
+    const std::function<void(int row, std::uint64_t cols, std::uint64_t diag1, std::uint64_t diag2)>& descend) {
+    if (m_boardSize == 1) {
+        descend(0, 0, 0, 0);
+        return;
+    }
+
+    const int half = m_boardSize / 2;
+    const std::uint64_t leftHalf = bitboard::fullMask(half);
+    for (std::uint64_t first = leftHalf; first != 0; first &= first - 1) {
+        const std::uint64_t bit = bitboard::lowestBit(first);
+        m_board[0] = bitboard::lowestBitIndex(bit);
+        descend(1, bit, bit << 1, bit >> 1);
+    }
+
+    if (m_boardSize % 2 == 1) {
+        const std::uint64_t mid = std::uint64_t{1} << half;
+        m_board[0] = half;
+        std::uint64_t second = leftHalf & ~(mid | mid << 1 | mid >> 1);
+        for (; second != 0; second &= second - 1) {
+            const std::uint64_t bit = bitboard::lowestBit(second);
+            m_board[1] = bitboard::lowestBitIndex(bit);
+            descend(2, mid | bit, (mid << 1 | bit) << 1, (mid >> 1 | bit) >> 1);
+        }
+    }
+    m_board[0] = -1;
+    m_board[1] = -1;
+}
+
+// 依次比较当前解在其余 7 种对称变换（镜像、翻转、旋转、转置）下的像：
+// 有更小者则不是代表返回 0，否则返回对称类大小 8 / 稳定子个数
+int Queen::canonicalOrbitSize() {
+    const int n = m_boardSize;
+    const int last = n - 1;
+    int stabilizer = 1;
+    for (int transform = 1; transform < 8; ++transform) {
+        for (int row = 0; row < n; ++row) {
+            const int col = m_board[row];
+            switch (transform) {
+            case 1: m_transformed[row] = last - col; break;
+            case 2: m_transformed[last - row] = col; break;
+            case 3: m_transformed[last - row] = last - col; break;
+            case 4: m_transformed[col] = row; break;
+            case 5: m_transformed[col] = last - row; break;
+            case 6: m_transformed[last - col] = row; break;
+            case 7: m_transformed[last - col] = last - row; break;
+            }
+        }
+        const auto cmp = std::mismatch(m_transformed.begin(), m_transformed.end(), m_board.begin());
+        if (cmp.first == m_transformed.end()) {
+            ++stabilizer;
+        } else if (*cmp.first < *cmp.second) {
+            return 0;
+        }
+    }
+    return 8 / stabilizer;
+}
+
+// 回调抛出异常时也要恢复为保存模式，否则之后的求解会丢解
+void Queen::runStreaming(OutputMode mode, const SolutionVisitor* visitor) {
+    struct ModeGuard {
+        Queen& queen;
+        ~ModeGuard() {
+            queen.m_outputMode = OutputMode::Store;
+            queen.m_visitor = nullptr;
+        }
+    } guard{*this};
+
+    m_outputMode = mode;
+    m_visitor = visitor;
+    m_visitedCount = 0;
+    resetState();
+    if (m_boardSize <= bitboard::kMaxBoardSize) {
+        solveBitboardHelper(0, 0, 0, 0);
+    } else {
+        solveRecursiveHelper(0);
+    }
 }
 
 void Queen::solveRecursiveHelper(int row) {
@@ -154,3 +394,21 @@ void Queen::solveIterativeHelper() {
         col = backtrack.nextCol;
     }
 }
+
+// cols/diag1/diag2 为当前行已被占用的列：diag1 对应 row - col 相同的对角线（下一行左移一位），
+// diag2 对应 row + col 相同的对角线（下一行右移一位）；按列号从小到大取可用位，解的顺序与另外两种算法一致
+void Queen::solveBitboardHelper(int row, std::uint64_t cols, std::uint64_t diag1, std::uint64_t diag2) {
+    if (row == m_boardSize) {
+        saveSolution();
+        return;
+    }
+
+    std::uint64_t available = bitboard::fullMask(m_boardSize) & ~(cols | diag1 | diag2);
+    while (available != 0) {
+        const std::uint64_t bit = bitboard::lowestBit(available);
+        available ^= bit;
+        m_board[row] = bitboard::lowestBitIndex(bit);
+        solveBitboardHelper(row + 1, cols | bit, (diag1 | bit) << 1, (diag2 | bit) >> 1);
+    }
+    m_board[row] = -1;
+}
@@ -0,0 +1,51 @@
+#include "../include/QueenCompletion.h"
+
+#include <stdexcept>
+
+QueenCompletion::QueenCompletion(int boardSize, const std::vector<std::pair<int, int>>& fixed)
+    : m_boardSize(boardSize), m_cover(2 * boardSize, boardSize >= 1 ? 2 * (2 * boardSize - 1) : 0) {
+    if (boardSize < 1) {
+        throw std::invalid_argument("board size must be positive");
+    }
+    const int n = boardSize;
+    const int diag1Base = 2 * n;
+    const int diag2Base = 2 * n + 2 * n - 1;
+    for (int row = 0; row < n; ++row) {
+        for (int col = 0; col < n; ++col) {
+            m_cover.addRow({row, n + col, diag1Base + row - col + n - 1, diag2Base + row + col});
+        }
+    }
+    for (const auto& queen : fixed) {
+        if (queen.first < 0 || queen.first >= n || queen.second < 0 || queen.second >= n
+            || !m_cover.select(queen.first * n + queen.second)) {
+            throw std::invalid_argument("fixed queens are out of range or attack each other");
+        }
+    }
+}
+
+std::uint64_t QueenCompletion::count() {
+    return m_cover.solve([](const std::vector<int>&) { return true; });
+}
+
+std::uint64_t QueenCompletion::visit(const SolutionVisitor& visitor) {
+    std::vector<int> board(m_boardSize, -1);
+    return m_cover.solve([this, &board, &visitor](const std::vector<int>& rows) {
+        for (int cell : rows) {
+            board[cell / m_boardSize] = cell % m_boardSize;
+        }
+        visitor(SolutionView(board));
+        return true;
+    });
+}
+
+std::vector<int> QueenCompletion::findFirst() {
+    std::vector<int> board;
+    m_cover.solve([this, &board](const std::vector<int>& rows) {
+        board.assign(m_boardSize, -1);
+        for (int cell : rows) {
+            board[cell / m_boardSize] = cell % m_boardSize;
+        }
+        return false;
+    });
+    return board;
+}
@@ -0,0 +1,200 @@
+#include "../include/SingleSolver.h"
+
+#include <algorithm>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+
+namespace {
+// 经典的显式构造（Hoffman、Loessi、Moser）：按顺序给出每行的列号（此处从 1 开始计），
+//   n mod 6 不为 2、3：先全部偶数，再全部奇数
+//   n mod 6 == 2：偶数；奇数中交换 1 与 3，并把 5 移到最后
+//   n mod 6 == 3：偶数中把 2 移到最后；奇数中把 1、3 移到最后
+// 得到的排列使任意两个皇后都不在同一条对角线上
+template <typename Emit>
+void construct(int n, Emit emit) {
+    const int remainder = n % 6;
+    if (remainder == 3) {
+        for (int even = 4; even <= n; even += 2) emit(even - 1);
+        emit(2 - 1);
+        for (int odd = 5; odd <= n; odd += 2) emit(odd - 1);
+        emit(1 - 1);
+        emit(3 - 1);
+        return;
+    }
+    for (int even = 2; even <= n; even += 2) emit(even - 1);
+    if (remainder == 2) {
+        emit(3 - 1);
+        emit(1 - 1);
+        for (int odd = 7; odd <= n; odd += 2) emit(odd - 1);
+        emit(5 - 1);
+        return;
+    }
+    for (int odd = 1; odd <= n; odd += 2) emit(odd - 1);
+}
+
+bool solvable(int n) {
+    return n >= 1 && n != 2 && n != 3;
+}
+}
+
+std::vector<int> SingleSolver::findOne(int n) {
+    std::vector<int> columns;
+    if (!solvable(n)) {
+        return columns;
+    }
+    columns.reserve(n);
+    construct(n, [&columns](int col) { columns.push_back(col); });
+    return columns;
+}
+
+bool SingleSolver::writeOne(int n, const std::string& path) {
+    if (!solvable(n)) {
+        return false;
+    }
+    std::ofstream out(path, std::ios::trunc);
+    out << n << '\n';
+    construct(n, [&out](int col) { out << col << '\n'; });
+    out.close();
+    if (!out) {
+        throw std::runtime_error("failed to write solution file: " + path);
+    }
+    return true;
+}
+
+// 每行恰好一个皇后、各行列号构成排列，因此列冲突始终为零，只需处理对角线。
+// 冲突总数为每条对角线上皇后对数之和；交换两行的列号只影响四条对角线上的计数，增量 O(1) 可得。
+//   1. 贪心初始化：逐行在尚未使用的列中随机试探，优先放在两条对角线都空的位置
+//   2. 反复扫描仍有冲突的行，与随机一行交换列号，只接受使冲突总数下降的交换
+//   3. 连续 4n + 1000 次尝试都没有进展则重新随机初始化，总步数超过上限时放弃
+std::vector<int> SingleSolver::minConflicts(int n, const std::vector<std::pair<int, int>>& fixed, std::uint64_t seed,
+                                            std::uint64_t maxSteps) {
+    if (n < 1) {
+        throw std::invalid_argument("board size must be positive");
+    }
+    std::vector<bool> rowFixed(n, false);
+    std::vector<bool> colFixed(n, false);
+    std::vector<int> diag1(2 * n - 1, 0);
+    std::vector<int> diag2(2 * n - 1, 0);
+    std::vector<int> columns(n, -1);
+    for (const auto& queen : fixed) {
+        const int row = queen.first;
+        const int col = queen.second;
+        if (row < 0 || row >= n || col < 0 || col >= n || rowFixed[row] || colFixed[col]
+            || diag1[row - col + n - 1] != 0 || diag2[row + col] != 0) {
+            throw std::invalid_argument("fixed queens are out of range or attack each other");
+        }
+        rowFixed[row] = true;
+        colFixed[col] = true;
+        ++diag1[row - col + n - 1];
+        ++diag2[row + col];
+        columns[row] = col;
+    }
+    const std::vector<int> fixedDiag1 = diag1;
+    const std::vector<int> fixedDiag2 = diag2;
+
+    std::vector<int> freeRows;
+    std::vector<int> freeCols;
+    for (int i = 0; i < n; ++i) {
+        if (!rowFixed[i]) freeRows.push_back(i);
+        if (!colFixed[i]) freeCols.push_back(i);
+    }
+    if (freeRows.empty()) {
+        return columns;
+    }
+    if (maxSteps == 0) {
+        maxSteps = 100 * static_cast<std::uint64_t>(n) + 100000;
+    }
+
+    auto removeQueen = [&](int row, int col) {
+        int& a = diag1[row - col + n - 1];
+        int& b = diag2[row + col];
+        const long long before = (a - 1) + (b - 1);
+        --a;
+        --b;
+        return -before;
+    };
+    auto addQueen = [&](int row, int col) {
+        int& a = diag1[row - col + n - 1];
+        int& b = diag2[row + col];
+        const long long added = a + b;
+        ++a;
+        ++b;
+        return added;
+    };
+    auto attacks = [&](int row) {
+        const int col = columns[row];
+        return diag1[row - col + n - 1] - 1 + diag2[row + col] - 1;
+    };
+
+    const std::uint64_t stallLimit = 4 * static_cast<std::uint64_t>(n) + 1000;
+    std::mt19937_64 random(seed);
+    const std::size_t freeCount = freeRows.size();
+    std::uint64_t steps = 0;
+    while (steps < maxSteps) {
+        diag1 = fixedDiag1;
+        diag2 = fixedDiag2;
+        std::shuffle(freeCols.begin(), freeCols.end(), random);
+        for (std::size_t i = 0; i < freeCount; ++i) {
+            columns[freeRows[i]] = freeCols[i];
+        }
+
+        std::uint64_t attempts = 3 * static_cast<std::uint64_t>(freeCount) + freeCount / 10;
+        std::size_t placed = 0;
+        for (; placed < freeCount && attempts > 0; ++placed) {
+            const int row = freeRows[placed];
+            while (attempts > 0) {
+                --attempts;
+                const std::size_t pick = placed + random() % (freeCount - placed);
+                const int col = columns[freeRows[pick]];
+                if (diag1[row - col + n - 1] == 0 && diag2[row + col] == 0) {
+                    std::swap(columns[row], columns[freeRows[pick]]);
+                    break;
+                }
+            }
+            addQueen(row, columns[row]);
+        }
+        for (; placed < freeCount; ++placed) {
+            addQueen(freeRows[placed], columns[freeRows[placed]]);
+        }
+
+        long long total = 0;
+        for (int count : diag1) total += static_cast<long long>(count) * (count - 1) / 2;
+        for (int count : diag2) total += static_cast<long long>(count) * (count - 1) / 2;
+
+        std::uint64_t sinceImprovement = 0;
+        while (total > 0 && steps < maxSteps && sinceImprovement < stallLimit) {
+            for (std::size_t i = 0; i < freeCount && total > 0; ++i) {
+                const int row = freeRows[i];
+                if (attacks(row) == 0) {
+                    continue;
+                }
+                ++steps;
+                const int other = freeRows[random() % freeCount];
+                if (other == row) {
+                    continue;
+                }
+                const int colRow = columns[row];
+                const int colOther = columns[other];
+                long long delta = removeQueen(row, colRow) + removeQueen(other, colOther);
+                delta += addQueen(row, colOther) + addQueen(other, colRow);
+                if (delta < 0) {
+                    std::swap(columns[row], columns[other]);
+                    total += delta;
+                    sinceImprovement = 0;
+                } else {
+                    ++sinceImprovement;
+                    removeQueen(row, colOther);
+                    removeQueen(other, colRow);
+                    addQueen(row, colRow);
+                    addQueen(other, colOther);
+                }
+            }
+        }
+        if (total == 0) {
+            return columns;
+        }
+        ++steps;
+    }
+    return std::vector<int>();
+}
@@ -47,7 +47,11 @@ void Solution::display() const {
 }
 
 bool Solution::verify() const {
-    const int size = static_cast<int>(m_positions.size());
+    return verify(SolutionView(m_positions));
+}
+
+bool Solution::verify(const SolutionView& positions) {
+    const int size = static_cast<int>(positions.size());
     if (size == 0) {
         return false;
     }
@@ -57,7 +61,7 @@ bool Solution::verify() const {
     std::vector<bool> diag2(2 * size - 1, false);
 
     for (int row = 0; row < size; ++row) {
-        const int col = m_positions[row];
+        const int col = positions[row];
         if (col < 0 || col >= size) {
             return false;
         }
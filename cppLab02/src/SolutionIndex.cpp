@@ -0,0 +1,297 @@
+#include "../include/SolutionIndex.h"
+#include "../include/BitBoard.h"
+#include "../include/WorkStealingPool.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+const char kMagic[8] = {'N', 'Q', 'R', 'A', 'N', 'K', '0', '1'};
+
+// 每个线程池任务计算这么多个前缀的解数
+const std::size_t kPrefixesPerTask = 256;
+
+// 某一深度的全部合法前缀：列号按字节平铺，每个前缀另存三个占用掩码
+struct Frontier {
+    std::vector<std::uint8_t> columns;
+    std::vector<std::uint64_t> masks;
+
+    std::size_t size() const { return masks.size() / 3; }
+};
+
+Frontier expand(const Frontier& frontier, int depth, std::uint64_t full) {
+    Frontier next;
+    for (std::size_t i = 0; i < frontier.size(); ++i) {
+        const std::uint64_t cols = frontier.masks[3 * i];
+        const std::uint64_t diag1 = frontier.masks[3 * i + 1];
+        const std::uint64_t diag2 = frontier.masks[3 * i + 2];
+        std::uint64_t available = full & ~(cols | diag1 | diag2);
+        while (available != 0) {
+            const std::uint64_t bit = bitboard::lowestBit(available);
+            available ^= bit;
+            next.columns.insert(next.columns.end(), frontier.columns.begin() + i * depth,
+                                frontier.columns.begin() + (i + 1) * depth);
+            next.columns.push_back(static_cast<std::uint8_t>(bitboard::lowestBitIndex(bit)));
+            next.masks.push_back(cols | bit);
+            next.masks.push_back((diag1 | bit) << 1);
+            next.masks.push_back((diag2 | bit) >> 1);
+        }
+    }
+    return next;
+}
+
+void writeLittleEndian(std::ostream& out, std::uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; ++i) {
+        out.put(static_cast<char>(value >> (8 * i)));
+    }
+}
+
+bool readLittleEndian(std::istream& in, std::uint64_t& value, int bytes) {
+    unsigned char buffer[8];
+    if (!in.read(reinterpret_cast<char*>(buffer), bytes)) {
+        return false;
+    }
+    value = 0;
+    for (int i = 0; i < bytes; ++i) {
+        value |= static_cast<std::uint64_t>(buffer[i]) << (8 * i);
+    }
+    return true;
+}
+}
+
+SolutionIndex::SolutionIndex(int boardSize, int depth) : m_boardSize(boardSize), m_depth(depth) {}
+
+SolutionIndex SolutionIndex::build(int boardSize, int cacheDepth, int threads) {
+    if (boardSize < 1 || boardSize > bitboard::kMaxBoardSize) {
+        throw std::out_of_range("solution index supports board sizes 1 to 64");
+    }
+    const std::uint64_t full = bitboard::fullMask(boardSize);
+    const int target = cacheDepth > 0 ? std::min(cacheDepth, boardSize) : boardSize;
+
+    Frontier frontier;
+    frontier.masks.assign(3, 0);
+    int depth = 0;
+    while (depth < target) {
+        Frontier next = expand(frontier, depth, full);
+        if (cacheDepth <= 0 && depth > 0 && next.size() > kDefaultPrefixBudget) {
+            break;
+        }
+        frontier = std::move(next);
+        ++depth;
+    }
+
+    const std::size_t prefixes = frontier.size();
+    std::vector<std::uint64_t> counts(prefixes, 0);
+    WorkStealingPool pool(threads);
+    pool.run((prefixes + kPrefixesPerTask - 1) / kPrefixesPerTask, [&](std::size_t task, int) {
+        const std::size_t end = std::min(prefixes, (task + 1) * kPrefixesPerTask);
+        for (std::size_t i = task * kPrefixesPerTask; i < end; ++i) {
+            counts[i] = bitboard::countCompletions(full, frontier.masks[3 * i], frontier.masks[3 * i + 1],
+                                                   frontier.masks[3 * i + 2]);
+        }
+    });
+
+    // 解数为零的前缀不会出现在任何解里，不必保留
+    SolutionIndex index(boardSize, depth);
+    std::uint64_t total = 0;
+    for (std::size_t i = 0; i < prefixes; ++i) {
+        if (counts[i] == 0) {
+            continue;
+        }
+        total += counts[i];
+        index.m_columns.insert(index.m_columns.end(), frontier.columns.begin() + i * depth,
+                               frontier.columns.begin() + (i + 1) * depth);
+        index.m_cumulative.push_back(total);
+    }
+    return index;
+}
+
+SolutionIndex SolutionIndex::loadOrBuild(int boardSize, const std::string& cachePath, int cacheDepth, int threads) {
+    if (!cachePath.empty()) {
+        SolutionIndex cached(boardSize, cacheDepth > 0 ? std::min(cacheDepth, boardSize) : 0);
+        if (cached.load(cachePath)) {
+            return cached;
+        }
+    }
+    SolutionIndex index = build(boardSize, cacheDepth, threads);
+    if (!cachePath.empty()) {
+        index.save(cachePath);
+    }
+    return index;
+}
+
+// 二进制格式（小端序）：8 字节 "NQRANK01"，uint32 n，uint32 深度，uint64 前缀数，
+// 然后是全部前缀的列号（每个前缀 depth 字节），最后是各前缀的解数（uint64）
+void SolutionIndex::save(const std::string& path) const {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(kMagic, sizeof(kMagic));
+    writeLittleEndian(out, static_cast<std::uint64_t>(m_boardSize), 4);
+    writeLittleEndian(out, static_cast<std::uint64_t>(m_depth), 4);
+    writeLittleEndian(out, prefixCount(), 8);
+    out.write(reinterpret_cast<const char*>(m_columns.data()), static_cast<std::streamsize>(m_columns.size()));
+    std::uint64_t previous = 0;
+    for (std::uint64_t cumulative : m_cumulative) {
+        writeLittleEndian(out, cumulative - previous, 8);
+        previous = cumulative;
+    }
+    out.close();
+    if (!out) {
+        throw std::runtime_error("failed to write solution index: " + path);
+    }
+}
+
+// 文件不存在或与棋盘大小、要求的深度不符时返回 false，由调用方重新计算
+bool SolutionIndex::load(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    char magic[sizeof(kMagic)];
+    std::uint64_t boardSize = 0;
+    std::uint64_t depth = 0;
+    std::uint64_t prefixes = 0;
+    if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, kMagic, sizeof(kMagic)) != 0
+        || !readLittleEndian(in, boardSize, 4) || !readLittleEndian(in, depth, 4)
+        || !readLittleEndian(in, prefixes, 8)) {
+        throw std::runtime_error("corrupt solution index: " + path);
+    }
+    if (boardSize != static_cast<std::uint64_t>(m_boardSize) || depth == 0 || depth > boardSize
+        || (m_depth > 0 && depth != static_cast<std::uint64_t>(m_depth))) {
+        return false;
+    }
+
+    const std::streampos dataStart = in.tellg();
+    in.seekg(0, std::ios::end);
+    const std::uint64_t dataBytes = static_cast<std::uint64_t>(in.tellg() - dataStart);
+    in.seekg(dataStart);
+    if (prefixes > dataBytes / (depth + 8) || prefixes * (depth + 8) != dataBytes) {
+        throw std::runtime_error("corrupt solution index: " + path);
+    }
+
+    m_depth = static_cast<int>(depth);
+    m_columns.resize(static_cast<std::size_t>(prefixes * depth));
+    if (!in.read(reinterpret_cast<char*>(m_columns.data()), static_cast<std::streamsize>(m_columns.size()))
+        || std::any_of(m_columns.begin(), m_columns.end(), [this](std::uint8_t col) { return col >= m_boardSize; })) {
+        throw std::runtime_error("corrupt solution index: " + path);
+    }
+    m_cumulative.resize(static_cast<std::size_t>(prefixes));
+    std::uint64_t total = 0;
+    for (std::uint64_t& cumulative : m_cumulative) {
+        std::uint64_t count = 0;
+        if (!readLittleEndian(in, count, 8)) {
+            throw std::runtime_error("corrupt solution index: " + path);
+        }
+        total += count;
+        cumulative = total;
+    }
+    return true;
+}
+
+int SolutionIndex::getBoardSize() const {
+    return m_boardSize;
+}
+
+int SolutionIndex::getDepth() const {
+    return m_depth;
+}
+
+std::size_t SolutionIndex::prefixCount() const {
+    return m_cumulative.size();
+}
+
+std::uint64_t SolutionIndex::size() const {
+    return m_cumulative.empty() ? 0 : m_cumulative.back();
+}
+
+// 先在累计解数上二分找到第 k 个解所在的前缀，再逐行按列号从小到大跳过整棵兄弟子树
+std::vector<int> SolutionIndex::unrank(std::uint64_t k) const {
+    if (k >= size()) {
+        throw std::out_of_range("solution rank out of range");
+    }
+    const std::size_t prefix = static_cast<std::size_t>(
+        std::upper_bound(m_cumulative.begin(), m_cumulative.end(), k) - m_cumulative.begin());
+    std::uint64_t remaining = k - (prefix == 0 ? 0 : m_cumulative[prefix - 1]);
+
+    const std::uint64_t full = bitboard::fullMask(m_boardSize);
+    std::vector<int> board(m_boardSize, -1);
+    std::uint64_t cols = 0;
+    std::uint64_t diag1 = 0;
+    std::uint64_t diag2 = 0;
+    for (int row = 0; row < m_depth; ++row) {
+        const std::uint64_t bit = std::uint64_t{1} << m_columns[prefix * m_depth + row];
+        board[row] = m_columns[prefix * m_depth + row];
+        cols |= bit;
+        diag1 = (diag1 | bit) << 1;
+        diag2 = (diag2 | bit) >> 1;
+    }
+
+    for (int row = m_depth; row < m_boardSize; ++row) {
+        std::uint64_t available = full & ~(cols | diag1 | diag2);
+        while (available != 0) {
+            const std::uint64_t bit = bitboard::lowestBit(available);
+            available ^= bit;
+            const std::uint64_t subtree =
+                bitboard::countCompletions(full, cols | bit, (diag1 | bit) << 1, (diag2 | bit) >> 1);
+            if (remaining < subtree) {
+                board[row] = bitboard::lowestBitIndex(bit);
+                cols |= bit;
+                diag1 = (diag1 | bit) << 1;
+                diag2 = (diag2 | bit) >> 1;
+                break;
+            }
+            remaining -= subtree;
+        }
+    }
+    return board;
+}
+
+std::uint64_t SolutionIndex::rank(const std::vector<int>& solution) const {
+    if (static_cast<int>(solution.size()) != m_boardSize) {
+        throw std::invalid_argument("solution size does not match the board size");
+    }
+    const std::uint64_t full = bitboard::fullMask(m_boardSize);
+    std::uint64_t cols = 0;
+    std::uint64_t diag1 = 0;
+    std::uint64_t diag2 = 0;
+    std::uint64_t before = 0;
+    for (int row = 0; row < m_boardSize; ++row) {
+        const int col = solution[row];
+        const std::uint64_t available = full & ~(cols | diag1 | diag2);
+        if (col < 0 || col >= m_boardSize || (available & (std::uint64_t{1} << col)) == 0) {
+            throw std::invalid_argument("not a valid solution");
+        }
+        const std::uint64_t bit = std::uint64_t{1} << col;
+
+        if (row == m_depth - 1) {
+            // 前缀在缓存中按字典序排列，二分找到它前面的解数
+            std::vector<std::uint8_t> key(solution.begin(), solution.begin() + m_depth);
+            std::size_t low = 0;
+            std::size_t high = prefixCount();
+            while (low < high) {
+                const std::size_t mid = low + (high - low) / 2;
+                if (std::memcmp(&m_columns[mid * m_depth], key.data(), m_depth) < 0) {
+                    low = mid + 1;
+                } else {
+                    high = mid;
+                }
+            }
+            if (low == prefixCount() || std::memcmp(&m_columns[low * m_depth], key.data(), m_depth) != 0) {
+                throw std::invalid_argument("not a valid solution");
+            }
+            before = low == 0 ? 0 : m_cumulative[low - 1];
+        } else if (row >= m_depth) {
+            for (std::uint64_t smaller = available & (bit - 1); smaller != 0; smaller &= smaller - 1) {
+                const std::uint64_t sibling = bitboard::lowestBit(smaller);
+                before += bitboard::countCompletions(full, cols | sibling, (diag1 | sibling) << 1,
+                                                     (diag2 | sibling) >> 1);
+            }
+        }
+
+        cols |= bit;
+        diag1 = (diag1 | bit) << 1;
+        diag2 = (diag2 | bit) >> 1;
+    }
+    return before;
+}
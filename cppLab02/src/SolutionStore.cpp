@@ -0,0 +1,251 @@
+#include "../include/SolutionStore.h"
+
+#include <cstring>
+#include <stdexcept>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+const char kMagic[8] = {'N', 'Q', 'P', 'A', 'C', 'K', '0', '1'};
+const std::uint32_t kFormatVersion = 1;
+const std::size_t kCountOffset = 24;
+
+void putLittleEndian(unsigned char* out, std::uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; ++i) {
+        out[i] = static_cast<unsigned char>(value >> (8 * i));
+    }
+}
+
+std::uint64_t getLittleEndian(const unsigned char* in, int bytes) {
+    std::uint64_t value = 0;
+    for (int i = 0; i < bytes; ++i) {
+        value |= static_cast<std::uint64_t>(in[i]) << (8 * i);
+    }
+    return value;
+}
+}
+
+int solution_store::bitsPerRow(int boardSize) {
+    int bits = 1;
+    while ((1LL << bits) < boardSize) {
+        ++bits;
+    }
+    return bits;
+}
+
+std::size_t solution_store::strideBytes(int boardSize) {
+    return (static_cast<std::size_t>(boardSize) * bitsPerRow(boardSize) + 7) / 8;
+}
+
+SolutionStoreWriter::SolutionStoreWriter(const std::string& path, int boardSize)
+    : m_out(path, std::ios::binary | std::ios::trunc),
+      m_path(path),
+      m_boardSize(boardSize),
+      m_count(0),
+      m_record(solution_store::strideBytes(boardSize)),
+      m_finished(false) {
+    if (boardSize < 1) {
+        throw std::invalid_argument("board size must be positive");
+    }
+    if (!m_out) {
+        throw std::runtime_error("failed to create solution file: " + path);
+    }
+    unsigned char header[solution_store::kHeaderSize] = {};
+    std::memcpy(header, kMagic, sizeof(kMagic));
+    putLittleEndian(header + 8, kFormatVersion, 4);
+    putLittleEndian(header + 12, static_cast<std::uint64_t>(boardSize), 4);
+    putLittleEndian(header + 16, static_cast<std::uint64_t>(solution_store::bitsPerRow(boardSize)), 4);
+    putLittleEndian(header + 20, m_record.size(), 4);
+    m_out.write(reinterpret_cast<const char*>(header), sizeof(header));
+}
+
+SolutionStoreWriter::~SolutionStoreWriter() {
+    try {
+        finish();
+    } catch (...) {
+    }
+}
+
+void SolutionStoreWriter::append(const SolutionView& solution) {
+    if (static_cast<int>(solution.size()) != m_boardSize) {
+        throw std::invalid_argument("solution size does not match the solution file");
+    }
+    const int bits = solution_store::bitsPerRow(m_boardSize);
+    std::fill(m_record.begin(), m_record.end(), 0);
+    std::size_t byte = 0;
+    std::uint64_t pending = 0;
+    int pendingBits = 0;
+    for (int col : solution) {
+        pending |= static_cast<std::uint64_t>(col) << pendingBits;
+        pendingBits += bits;
+        while (pendingBits >= 8) {
+            m_record[byte++] = static_cast<unsigned char>(pending);
+            pending >>= 8;
+            pendingBits -= 8;
+        }
+    }
+    if (pendingBits > 0) {
+        m_record[byte] = static_cast<unsigned char>(pending);
+    }
+    m_out.write(reinterpret_cast<const char*>(m_record.data()), static_cast<std::streamsize>(m_record.size()));
+    ++m_count;
+}
+
+void SolutionStoreWriter::finish() {
+    if (m_finished) {
+        return;
+    }
+    m_finished = true;
+    unsigned char count[8];
+    putLittleEndian(count, m_count, 8);
+    m_out.seekp(static_cast<std::streamoff>(kCountOffset));
+    m_out.write(reinterpret_cast<const char*>(count), sizeof(count));
+    m_out.close();
+    if (!m_out) {
+        throw std::runtime_error("failed to write solution file: " + m_path);
+    }
+}
+
+std::uint64_t SolutionStoreWriter::getCount() const {
+    return m_count;
+}
+
+SolutionStore::SolutionStore(const std::string& path)
+    : m_data(nullptr),
+      m_size(0),
+      m_boardSize(0),
+      m_bitsPerRow(0),
+      m_stride(0),
+      m_count(0)
+#ifdef _WIN32
+      , m_file(INVALID_HANDLE_VALUE),
+      m_mapping(nullptr)
+#endif
+{
+#ifdef _WIN32
+    m_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                         FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (m_file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("failed to open solution file: " + path);
+    }
+    LARGE_INTEGER fileSize{};
+    GetFileSizeEx(m_file, &fileSize);
+    m_size = static_cast<std::size_t>(fileSize.QuadPart);
+    if (m_size > 0) {
+        m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (m_mapping != nullptr) {
+            m_data = static_cast<const unsigned char*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+        }
+        if (m_data == nullptr) {
+            unmap();
+            throw std::runtime_error("failed to map solution file: " + path);
+        }
+    }
+#else
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("failed to open solution file: " + path);
+    }
+    struct stat info {};
+    if (::fstat(fd, &info) != 0) {
+        ::close(fd);
+        throw std::runtime_error("failed to open solution file: " + path);
+    }
+    m_size = static_cast<std::size_t>(info.st_size);
+    if (m_size > 0) {
+        void* mapped = ::mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (mapped == MAP_FAILED) {
+            ::close(fd);
+            throw std::runtime_error("failed to map solution file: " + path);
+        }
+        m_data = static_cast<const unsigned char*>(mapped);
+    }
+    ::close(fd);
+#endif
+
+    if (m_size < solution_store::kHeaderSize || std::memcmp(m_data, kMagic, sizeof(kMagic)) != 0
+        || getLittleEndian(m_data + 8, 4) != kFormatVersion) {
+        unmap();
+        throw std::runtime_error("not a packed solution file: " + path);
+    }
+    m_boardSize = static_cast<int>(getLittleEndian(m_data + 12, 4));
+    m_bitsPerRow = static_cast<int>(getLittleEndian(m_data + 16, 4));
+    m_stride = static_cast<std::size_t>(getLittleEndian(m_data + 20, 4));
+    m_count = getLittleEndian(m_data + kCountOffset, 8);
+    if (m_boardSize < 1 || m_bitsPerRow != solution_store::bitsPerRow(m_boardSize)
+        || m_stride != solution_store::strideBytes(m_boardSize)
+        || m_count > (m_size - solution_store::kHeaderSize) / m_stride
+        || solution_store::kHeaderSize + m_count * m_stride != m_size) {
+        unmap();
+        throw std::runtime_error("corrupt packed solution file: " + path);
+    }
+}
+
+SolutionStore::~SolutionStore() {
+    unmap();
+}
+
+void SolutionStore::unmap() {
+#ifdef _WIN32
+    if (m_data != nullptr) {
+        UnmapViewOfFile(m_data);
+    }
+    if (m_mapping != nullptr) {
+        CloseHandle(m_mapping);
+    }
+    if (m_file != INVALID_HANDLE_VALUE) {
+        CloseHandle(m_file);
+    }
+    m_mapping = nullptr;
+    m_file = INVALID_HANDLE_VALUE;
+#else
+    if (m_data != nullptr) {
+        ::munmap(const_cast<unsigned char*>(m_data), m_size);
+    }
+#endif
+    m_data = nullptr;
+}
+
+int SolutionStore::getBoardSize() const {
+    return m_boardSize;
+}
+
+std::uint64_t SolutionStore::size() const {
+    return m_count;
+}
+
+void SolutionStore::read(std::uint64_t index, std::vector<int>& board) const {
+    if (index >= m_count) {
+        throw std::out_of_range("solution index out of range");
+    }
+    const unsigned char* record = m_data + solution_store::kHeaderSize + index * m_stride;
+    const std::uint64_t mask = (std::uint64_t{1} << m_bitsPerRow) - 1;
+    board.resize(m_boardSize);
+    std::uint64_t pending = 0;
+    int pendingBits = 0;
+    for (int row = 0; row < m_boardSize; ++row) {
+        while (pendingBits < m_bitsPerRow) {
+            pending |= static_cast<std::uint64_t>(*record++) << pendingBits;
+            pendingBits += 8;
+        }
+        board[row] = static_cast<int>(pending & mask);
+        pending >>= m_bitsPerRow;
+        pendingBits -= m_bitsPerRow;
+    }
+}
+
+std::vector<int> SolutionStore::get(std::uint64_t index) const {
+    std::vector<int> board;
+    read(index, board);
+    return board;
+}
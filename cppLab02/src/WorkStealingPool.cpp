@@ -0,0 +1,80 @@
+#include "../include/WorkStealingPool.h"
+
+#include <algorithm>
+#include <exception>
+#include <thread>
+
+WorkStealingPool::WorkStealingPool(int threads)
+    : m_threadCount(threads > 0 ? threads : std::max(1, static_cast<int>(std::thread::hardware_concurrency()))) {
+    for (int i = 0; i < m_threadCount; ++i) {
+        m_queues.push_back(std::make_unique<WorkerQueue>());
+    }
+}
+
+int WorkStealingPool::getThreadCount() const {
+    return m_threadCount;
+}
+
+bool WorkStealingPool::popLocal(int worker, std::size_t& task) {
+    WorkerQueue& queue = *m_queues[worker];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty()) {
+        return false;
+    }
+    task = queue.tasks.back();
+    queue.tasks.pop_back();
+    return true;
+}
+
+bool WorkStealingPool::steal(int thief, std::size_t& task) {
+    for (int offset = 1; offset < m_threadCount; ++offset) {
+        WorkerQueue& victim = *m_queues[(thief + offset) % m_threadCount];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = victim.tasks.front();
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::run(std::size_t taskCount, const std::function<void(std::size_t task, int worker)>& task) {
+    // 任务不会再派生新任务，所有队列都空时即可退出
+    const std::size_t threads = static_cast<std::size_t>(m_threadCount);
+    for (std::size_t w = 0; w < threads; ++w) {
+        m_queues[w]->tasks.clear();
+        for (std::size_t i = w * taskCount / threads; i < (w + 1) * taskCount / threads; ++i) {
+            m_queues[w]->tasks.push_back(i);
+        }
+    }
+
+    std::mutex errorMutex;
+    std::exception_ptr firstError;
+    auto workerLoop = [&](int worker) {
+        std::size_t index = 0;
+        while (popLocal(worker, index) || steal(worker, index)) {
+            try {
+                task(index, worker);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(errorMutex);
+                if (!firstError) {
+                    firstError = std::current_exception();
+                }
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (int w = 1; w < m_threadCount; ++w) {
+        workers.emplace_back(workerLoop, w);
+    }
+    workerLoop(0);
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+
+    if (firstError) {
+        std::rethrow_exception(firstError);
+    }
+}
@@ -1,10 +1,15 @@
 #include <algorithm>
 #include <cassert>
 #include <clocale>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
 #include <exception>
 #include <iostream>
 #include <limits>
 #include <locale>
+#include <memory>
+#include <string>
 #include <vector>
 
 #ifdef _WIN32
@@ -16,11 +21,23 @@
 #include <io.h>
 #endif
 
+#include "../include/BitBoard.h"
+#include "../include/CheckpointedCounter.h"
+#include "../include/FixedQueen.h"
 #include "../include/Queen.h"
+#include "../include/QueenCompletion.h"
+#include "../include/SingleSolver.h"
 #include "../include/Solution.h"
+#include "../include/SolutionIndex.h"
 
 namespace {
 
+// 菜单中统计补全方案数时允许的最多空行数：空行更多时方案数随 n 指数增长，计数可能要跑几天
+const int kMaxCountedFreeRows = 16;
+// 菜单中需要数出全部解的选项（计数、序号索引）允许的最大棋盘：每加一行耗时约增长 6~7 倍，
+// 更大的棋盘请用可断点续算的计数
+const int kMaxCountedBoardSize = 18;
+
 int getValidInput(int min, int max) {
     int value{};
     while (true) {
@@ -40,13 +57,21 @@ void displayMenu() {
                  L"├─────────────────────────────────┤\n"
                  L"│  1. 使用递归算法求解           │\n"
                  L"│  2. 使用非递归算法求解         │\n"
-                 L"│  3. 显示第N个解                 │\n"
-                 L"│  4. 显示所有解                  │\n"
-                 L"│  5. 查看解的总数                │\n"
-                 L"│  6. 重置程序                    │\n"
-                 L"│  7. 退出程序                    │\n"
+                 L"│  3. 使用位运算算法求解         │\n"
+                 L"│  4. 求解并写入解文件           │\n"
+                 L"│  5. 仅统计N皇后解数(不保存解)  │\n"
+                 L"│  6. 可断点续算的N皇后计数      │\n"
+                 L"│  7. 求N皇后基本解(对称类)      │\n"
+                 L"│  8. 按序号直接求N皇后的第k个解 │\n"
+                 L"│  9. 大规模N皇后求一个解并写入文件│\n"
+                 L"│ 10. 预置皇后的N皇后补全        │\n"
+                 L"│ 11. 显示第N个解                 │\n"
+                 L"│ 12. 显示所有解                  │\n"
+                 L"│ 13. 查看解的总数                │\n"
+                 L"│ 14. 重置程序                    │\n"
+                 L"│ 15. 退出程序                    │\n"
                  L"├─────────────────────────────────┤\n"
-                 L"│  请选择操作 (1-7):              │\n"
+                 L"│  请选择操作 (1-15):             │\n"
                  L"└─────────────────────────────────┘\n";
 }
 
@@ -61,7 +86,132 @@ void handleUserChoice(int choice, Queen& queen, int boardSize) {
             queen.solveIterative();
             std::wcout << L"非递归算法求解完成，共找到" << queen.getSolutionCount() << L"个解。\n";
             break;
-        case 3: {
+        case 3:
+            queen.solveBitboard();
+            std::wcout << L"位运算算法求解完成，共找到" << queen.getSolutionCount() << L"个解。\n";
+            break;
+        case 4: {
+            std::wcout << L"请输入解文件名: ";
+            std::string path;
+            std::getline(std::cin, path);
+            if (path.empty()) {
+                path = "queens_" + std::to_string(boardSize) + ".bin";
+            }
+            const std::uint64_t count = queen.solveToFile(path);
+            std::wcout << L"求解完成，共" << count << L"个解已写入解文件。\n";
+            break;
+        }
+        case 5: {
+            std::wcout << L"请输入棋盘大小 (1-" << kMaxCountedBoardSize << L"，更大的棋盘请用选项6): ";
+            const int n = getValidInput(1, kMaxCountedBoardSize);
+            Queen counter(n);
+            std::wcout << n << L"皇后问题共有" << counter.countSolutionsParallel() << L"个解。\n";
+            break;
+        }
+        case 6: {
+            std::wcout << L"请输入棋盘大小 (1-64): ";
+            const int n = getValidInput(1, 64);
+            std::wcout << L"请输入检查点文件名: ";
+            std::string path;
+            std::getline(std::cin, path);
+            if (path.empty()) {
+                path = "nqueens_" + std::to_string(n) + ".ckpt";
+            }
+            CheckpointedCounter counter(n, path);
+            counter.setProgressCallback([](const CheckpointProgress& progress) {
+                std::wcout << L"进度: " << progress.completedTasks << L"/" << progress.totalTasks
+                           << L" 个子任务，已用 " << static_cast<long long>(progress.elapsedSeconds) << L" 秒";
+                if (progress.etaSeconds >= 0) {
+                    std::wcout << L"，预计还需 " << static_cast<long long>(progress.etaSeconds) << L" 秒";
+                }
+                std::wcout << L'\n';
+            });
+            const std::uint64_t total = counter.run();
+            if (counter.resumed()) {
+                std::wcout << L"已从检查点继续计算。\n";
+            }
+            std::wcout << n << L"皇后问题共有" << total << L"个解。\n";
+            break;
+        }
+        case 7: {
+            std::wcout << L"请输入棋盘大小 (1-64): ";
+            const int n = getValidInput(1, 64);
+            Queen fundamental(n);
+            std::uint64_t total = 0;
+            const std::uint64_t classes = fundamental.visitFundamentalSolutions(
+                [&total](const SolutionView& view, int orbitSize) {
+                    total += static_cast<std::uint64_t>(orbitSize);
+                    std::wcout << L"\n基本解 (对称类含" << orbitSize << L"个解):\n";
+                    displayBoard(view.toVector());
+                });
+            std::wcout << n << L"皇后问题共有" << classes << L"个基本解，对应" << total << L"个解。\n";
+            break;
+        }
+        case 8: {
+            std::wcout << L"请输入棋盘大小 (1-" << kMaxCountedBoardSize << L"): ";
+            const int n = getValidInput(1, kMaxCountedBoardSize);
+            const SolutionIndex index =
+                SolutionIndex::loadOrBuild(n, "nqueens_" + std::to_string(n) + ".rank");
+            if (index.size() == 0) {
+                std::wcout << n << L"皇后问题无解。\n";
+                break;
+            }
+            std::wcout << n << L"皇后问题共有" << index.size() << L"个解，请输入序号 (1-" << index.size() << L"): ";
+            std::uint64_t k = 0;
+            while (!(std::cin >> k) || k < 1 || k > index.size()) {
+                std::wcout << L"输入无效，请重新输入: ";
+                std::cin.clear();
+                std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+            }
+            std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+            Solution(index.unrank(k - 1), static_cast<int>(std::min<std::uint64_t>(
+                                               k, std::numeric_limits<int>::max()))).display();
+            break;
+        }
+        case 9: {
+            std::wcout << L"请输入棋盘大小 (1-100000000): ";
+            const int n = getValidInput(1, 100000000);
+            std::wcout << L"请输入输出文件名: ";
+            std::string path;
+            std::getline(std::cin, path);
+            if (path.empty()) {
+                path = "queens_one_" + std::to_string(n) + ".txt";
+            }
+            if (!SingleSolver::writeOne(n, path)) {
+                std::wcout << n << L"皇后问题无解。\n";
+                break;
+            }
+            std::wcout << L"已写入一个解。\n";
+            break;
+        }
+        case 10: {
+            std::wcout << L"请输入棋盘大小 (1-32): ";
+            const int n = getValidInput(1, 32);
+            std::wcout << L"请输入预置皇后的个数 (0-" << n << L"): ";
+            const int fixedCount = getValidInput(0, n);
+            std::vector<std::pair<int, int>> fixed;
+            for (int i = 0; i < fixedCount; ++i) {
+                std::wcout << L"第" << (i + 1) << L"个皇后的行号 (0-" << (n - 1) << L"): ";
+                const int row = getValidInput(0, n - 1);
+                std::wcout << L"第" << (i + 1) << L"个皇后的列号 (0-" << (n - 1) << L"): ";
+                const int col = getValidInput(0, n - 1);
+                fixed.emplace_back(row, col);
+            }
+            QueenCompletion completion(n, fixed);
+            const std::vector<int> first = completion.findFirst();
+            if (first.empty()) {
+                std::wcout << L"预置的皇后无法补全为一个解。\n";
+                break;
+            }
+            Solution(first, 1).display();
+            if (n - fixedCount > kMaxCountedFreeRows) {
+                std::wcout << L"待补全的行超过" << kMaxCountedFreeRows << L"行，方案数过多，不做统计。\n";
+                break;
+            }
+            std::wcout << L"共有" << completion.count() << L"种补全方案。\n";
+            break;
+        }
+        case 11: {
             const int count = queen.getSolutionCount();
             if (count == 0) {
                 std::wcout << L"请先选择求解算法以生成解。\n";
@@ -72,17 +222,17 @@ void handleUserChoice(int choice, Queen& queen, int boardSize) {
             queen.displaySolution(index - 1);
             break;
         }
-        case 4:
+        case 12:
             if (queen.getSolutionCount() == 0) {
                 std::wcout << L"请先选择求解算法以生成解。\n";
                 break;
             }
             queen.displayAllSolutions();
             break;
-        case 5:
+        case 13:
             std::wcout << L"当前解的总数为: " << queen.getSolutionCount() << L'\n';
             break;
-        case 6:
+        case 14:
             queen = Queen(boardSize);
             std::wcout << L"程序已重置。\n";
             break;
@@ -96,6 +246,11 @@ void handleUserChoice(int choice, Queen& queen, int boardSize) {
 }
 
 #if !defined(NDEBUG)
+static_assert(FixedQueen<1>::count() == 1, "FixedQueen<1>");
+static_assert(FixedQueen<3>::count() == 0, "FixedQueen<3>");
+static_assert(FixedQueen<8>::count() == 92, "FixedQueen<8>");
+static_assert(FixedQueen<9>::count() == 352, "FixedQueen<9>");
+
 void runTests() {
     Queen queen;
     queen.solveRecursive();
@@ -116,6 +271,251 @@ void runTests() {
         assert(solutionsIter[i].verify());
         assert(solutions[i].getPositions() == solutionsIter[i].getPositions());
     }
+
+    Queen queen3;
+    queen3.solveBitboard();
+    const auto solutionsBit = queen3.getSolutions();
+    assert(solutionsBit.size() == solutions.size());
+    for (std::size_t i = 0; i < solutions.size() && i < solutionsBit.size(); ++i) {
+        assert(solutions[i].getPositions() == solutionsBit[i].getPositions());
+    }
+
+    for (int n = 1; n <= 10; ++n) {
+        Queen small(n);
+        small.solveRecursive();
+        const int expected = small.getSolutionCount();
+        small.solveBitboard();
+        assert(small.getSolutionCount() == expected);
+        assert(small.countSolutions() == static_cast<std::uint64_t>(expected));
+        assert(small.countSolutionsMirror() == static_cast<std::uint64_t>(expected));
+    }
+
+    const std::uint64_t fundamentalCounts[] = {1, 0, 0, 1, 2, 1, 6, 12, 46, 92};
+    for (int n = 1; n <= 10; ++n) {
+        Queen small(n);
+        std::uint64_t total = 0;
+        const std::uint64_t classes = small.visitFundamentalSolutions([&total](const SolutionView&, int orbitSize) {
+            total += static_cast<std::uint64_t>(orbitSize);
+        });
+        assert(classes == fundamentalCounts[n - 1]);
+        assert(total == small.countSolutions());
+    }
+
+    Queen visited;
+    std::vector<std::vector<int>> streamed;
+    const std::uint64_t visitedCount = visited.visitSolutions([&streamed](const SolutionView& view) {
+        streamed.push_back(view.toVector());
+    });
+    assert(visitedCount == 92);
+    assert(visited.getSolutionCount() == 0);
+    for (std::size_t i = 0; i < solutions.size() && i < streamed.size(); ++i) {
+        assert(solutions[i].getPositions() == streamed[i]);
+    }
+    assert(Queen(12).countSolutions() == 14200);
+
+    for (int threads = 1; threads <= 4; threads += 3) {
+        for (int depth = 1; depth <= 8; depth += 3) {
+            Queen parallel;
+            parallel.solveParallel(threads, depth);
+            const auto solutionsPar = parallel.getSolutions();
+            assert(solutionsPar.size() == solutions.size());
+            for (std::size_t i = 0; i < solutions.size() && i < solutionsPar.size(); ++i) {
+                assert(solutions[i].getPositions() == solutionsPar[i].getPositions());
+            }
+            for (int n = 1; n <= 10; ++n) {
+                Queen small(n);
+                assert(small.countSolutionsParallel(threads, depth) == small.countSolutions());
+            }
+        }
+    }
+
+    const std::string checkpoint = "nqueens_selftest.ckpt";
+    std::remove(checkpoint.c_str());
+    {
+        CheckpointedCounter fresh(10, checkpoint, 2, 3);
+        assert(fresh.run() == 724);
+        assert(!fresh.resumed());
+        CheckpointedCounter again(10, checkpoint, 2, 3);
+        assert(again.run() == 724);
+        assert(again.resumed());
+    }
+    {
+        // 已完成的子任务直接采用检查点中的计数，未完成的从保存的栈继续
+        const auto prefixes = ParallelSolver::splitPrefixes(8, 2, true);
+        const PrefixTask& first = prefixes[0];
+        const std::uint64_t full = bitboard::fullMask(8);
+        const std::uint64_t firstCount = bitboard::countCompletions(full, first.cols, first.diag1, first.diag2);
+        std::ofstream out(checkpoint, std::ios::trunc);
+        out << "NQUEENS-CHECKPOINT 1\n8 2 " << prefixes.size() << "\n"
+            << "D 0 " << firstCount + 1000 << "\n"
+            << "P 1 0 1 " << prefixes[1].cols << ' ' << prefixes[1].diag1 << ' ' << prefixes[1].diag2 << ' '
+            << (full & ~(prefixes[1].cols | prefixes[1].diag1 | prefixes[1].diag2)) << "\n";
+        out.close();
+        CheckpointedCounter resumed(8, checkpoint, 1, 2);
+        assert(resumed.run() == 92 + 2 * 1000);
+        assert(resumed.resumed());
+    }
+    std::remove(checkpoint.c_str());
+
+    const std::string solutionFile = "nqueens_selftest.bin";
+    for (int n = 1; n <= 10; ++n) {
+        Queen stored(n);
+        stored.solveRecursive();
+        const auto expected = stored.getSolutions();
+        assert(stored.solveToFile(solutionFile) == expected.size());
+        assert(stored.getSolutionCount() == static_cast<int>(expected.size()));
+        for (std::size_t i = 0; i < expected.size(); ++i) {
+            assert(stored.getSolution(static_cast<int>(i)).getPositions() == expected[i].getPositions());
+        }
+        Queen reopened(n);
+        reopened.openSolutionFile(solutionFile);
+        assert(reopened.getSolutionCount() == static_cast<int>(expected.size()));
+        if (!expected.empty()) {
+            assert(reopened.getSolution(reopened.getSolutionCount() - 1).getPositions()
+                   == expected.back().getPositions());
+        }
+    }
+    std::remove(solutionFile.c_str());
+
+    const std::string indexFile = "nqueens_selftest.rank";
+    for (int n = 1; n <= 10; ++n) {
+        Queen reference(n);
+        reference.solveBitboard();
+        const auto expected = reference.getSolutions();
+        for (int depth = 0; depth <= n; depth += 3) {
+            const SolutionIndex index = SolutionIndex::build(n, depth, 2);
+            assert(index.size() == expected.size());
+            for (std::size_t k = 0; k < expected.size(); ++k) {
+                assert(index.unrank(k) == expected[k].getPositions());
+                assert(index.rank(expected[k].getPositions()) == k);
+            }
+        }
+        std::remove(indexFile.c_str());
+        Queen indexed(n);
+        indexed.useSolutionIndex(indexFile);
+        Queen reloaded(n);
+        reloaded.useSolutionIndex(indexFile);
+        assert(reloaded.getSolutionCount() == static_cast<int>(expected.size()));
+        for (std::size_t k = 0; k < expected.size(); ++k) {
+            assert(reloaded.getSolution(static_cast<int>(k)).getPositions() == expected[k].getPositions());
+        }
+    }
+    std::remove(indexFile.c_str());
+
+    for (int n = 1; n <= 300; ++n) {
+        const std::vector<int> one = SingleSolver::findOne(n);
+        assert(one.empty() == (n == 2 || n == 3));
+        assert(one.empty() || Solution::verify(SolutionView(one)));
+    }
+    assert(Solution::verify(SolutionView(SingleSolver::findOne(1000000))));
+    const std::string oneFile = "nqueens_selftest_one.txt";
+    for (int n : {1, 2, 3, 4, 8, 9, 14, 15, 1000}) {
+        const std::vector<int> expected = SingleSolver::findOne(n);
+        assert(SingleSolver::writeOne(n, oneFile) == !expected.empty());
+        if (expected.empty()) {
+            continue;
+        }
+        std::ifstream in(oneFile);
+        int size = 0;
+        assert(in >> size && size == n);
+        std::vector<int> written;
+        int col = 0;
+        while (in >> col) {
+            written.push_back(col);
+        }
+        assert(written == expected);
+    }
+    std::remove(oneFile.c_str());
+    assert(!Solution::verify(SolutionView(std::vector<int>{0, 1, 2, 3})));
+
+    for (int n = 4; n <= 200; n += 7) {
+        const std::vector<std::pair<int, int>> fixed{{0, 1}, {n - 1, n - 2}};
+        const std::vector<int> constrained = SingleSolver::minConflicts(n, fixed, static_cast<std::uint64_t>(n));
+        if (n >= 8) {
+            assert(!constrained.empty());
+        }
+        if (!constrained.empty()) {
+            assert(Solution::verify(SolutionView(constrained)));
+            assert(constrained[0] == 1 && constrained[n - 1] == n - 2);
+        }
+    }
+    assert(SingleSolver::minConflicts(3, {}).empty());
+
+    for (int n = 1; n <= 9; ++n) {
+        Queen all(n);
+        all.solveBitboard();
+        const auto allSolutions = all.getSolutions();
+        assert(QueenCompletion(n, {}).count() == allSolutions.size());
+        const std::vector<std::vector<std::pair<int, int>>> presets{
+            {{0, 0}}, {{n / 2, n / 3}}, {{0, 1}, {n - 1, n - 2}}, {{1, 3}, {4, 2}}};
+        for (const auto& preset : presets) {
+            bool inRange = true;
+            for (const auto& queen : preset) {
+                inRange = inRange && queen.first < n && queen.second < n;
+            }
+            if (!inRange) {
+                continue;
+            }
+            std::uint64_t expected = 0;
+            for (const Solution& solution : allSolutions) {
+                const auto positions = solution.getPositions();
+                bool matches = true;
+                for (const auto& queen : preset) {
+                    matches = matches && positions[queen.first] == queen.second;
+                }
+                expected += matches ? 1 : 0;
+            }
+            std::unique_ptr<QueenCompletion> completionPtr;
+            try {
+                completionPtr = std::make_unique<QueenCompletion>(n, preset);
+            } catch (const std::invalid_argument&) {
+                assert(expected == 0);
+                continue;
+            }
+            QueenCompletion& completion = *completionPtr;
+            assert(completion.count() == expected);
+            completion.visit([&preset](const SolutionView& view) {
+                assert(Solution::verify(view));
+                for (const auto& queen : preset) {
+                    assert(view[queen.first] == queen.second);
+                }
+            });
+            assert(completion.findFirst().empty() == (expected == 0));
+        }
+    }
+    bool rejected = false;
+    try {
+        QueenCompletion(8, {{0, 0}, {1, 1}});
+    } catch (const std::invalid_argument&) {
+        rejected = true;
+    }
+    assert(rejected);
+
+    for (int n = 1; n <= fixed_queen::kMaxFixedBoardSize && n <= 12; ++n) {
+        Queen generic(n);
+        generic.solveRecursive();
+        const auto expected = generic.getSolutions();
+        assert(fixed_queen::count(n) == expected.size());
+        std::size_t next = 0;
+        fixed_queen::visit(n, [&expected, &next](const SolutionView& view) {
+            assert(next < expected.size() && view.toVector() == expected[next].getPositions());
+            ++next;
+        });
+        assert(next == expected.size());
+
+        // 关闭 FixedQueen 后走运行时的位运算搜索，结果与顺序都应一致
+        Queen runtime(n);
+        runtime.setFixedQueenEnabled(false);
+        assert(runtime.countSolutions() == expected.size());
+        next = 0;
+        const std::uint64_t visitedRuntime = runtime.visitSolutions([&expected, &next](const SolutionView& view) {
+            assert(next < expected.size() && view.toVector() == expected[next].getPositions());
+            ++next;
+        });
+        assert(visitedRuntime == expected.size() && next == expected.size());
+        runtime.solveBitboard();
+        assert(runtime.getSolutionCount() == static_cast<int>(expected.size()));
+    }
 }
 #endif
 
@@ -126,8 +526,8 @@ void mainMenu() {
     bool running = true;
     while (running) {
         displayMenu();
-        const int choice = getValidInput(1, 7);
-        if (choice == 7) {
+        const int choice = getValidInput(1, 15);
+        if (choice == 15) {
             running = false;
             std::wcout << L"感谢使用，再见！\n";
         } else {